@@ -10,10 +10,14 @@ void FileReader::setup(AAssetManager* assetManager)
 std::vector<char> FileReader::readData(const char *relativePath)
 {
 	AAsset* asset = AAssetManager_open(FileReader::m_assetManager, relativePath, AASSET_MODE_BUFFER);
+	if (asset == nullptr)
+	{
+		return std::vector<char>();
+	}
+
 	std::vector<char> data(static_cast<size_t>(AAsset_getLength(asset)));
 	AAsset_read(asset, data.data(), data.size());
 	AAsset_close(asset);
 
 	return data;
 }
-
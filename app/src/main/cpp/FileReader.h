@@ -10,6 +10,7 @@ class FileReader
 {
 public:
 	static void setup(AAssetManager* assetManager);
+	// Empty when the asset is missing
 	static std::vector<char> readData(const char* relativePath);
 
 private:
@@ -0,0 +1,35 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// World space, lights nothing beyond radius
+struct PointLight
+{
+	glm::vec3 position;
+	float radius;
+	glm::vec3 color;
+};
+
+// Lights the whole scene from infinitely far away
+struct DirectionalLight
+{
+	// World space, the way the light travels
+	glm::vec3 direction;
+	glm::vec3 color;
+};
+
+// Everything the render thread needs from the simulation to draw one frame
+struct FrameState
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+
+	std::vector<glm::mat4> models;
+	std::vector<PointLight> lights;
+	DirectionalLight sun;
+};
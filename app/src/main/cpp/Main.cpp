@@ -9,17 +9,49 @@
 #include <android_native_app_glue.h>
 #include "FileReader.h"
 
+#include "Simulation.h"
+#include "thread/RenderThread.h"
+#include "jobs/JobSystem.h"
+#include "input/InputQueue.h"
+
+#include <algorithm>
+#include <chrono>
+
+
+// Simulation and events stay on the android_main thread, drawing happens on the render thread
+struct Engine
+{
+	VulkanMain vulkanMain;
+	JobSystem jobSystem;
+	Simulation simulation;
+	RenderThread renderThread;
+	InputQueue inputQueue;
+
+	Engine(const RendererSettings& rendererSettings) :
+			vulkanMain(rendererSettings, &jobSystem),
+			simulation(&jobSystem),
+			renderThread(&vulkanMain)
+	{
+		// Projection and depth test have to agree
+		simulation.getCamera().setReverseDepth(rendererSettings.reverseDepth);
+	}
+};
 
 void handle_cmd(android_app* app, int32_t cmd)
 {
+	Engine* pEngine = static_cast<Engine*>(app->userData);
+
 	switch (cmd)
 	{
 		case APP_CMD_INIT_WINDOW:
-			static_cast<VulkanMain*>(app->userData)->init(app);
+			pEngine->vulkanMain.init(app);
+			pEngine->renderThread.start();
 			break;
 
 		case APP_CMD_TERM_WINDOW:
-			static_cast<VulkanMain*>(app->userData)->destroy();
+			// The render thread owns the queue, it has to be gone before the device is
+			pEngine->renderThread.stop();
+			pEngine->vulkanMain.destroy();
 			break;
 
 		default:
@@ -29,15 +61,20 @@ void handle_cmd(android_app* app, int32_t cmd)
 
 int32_t handle_input(android_app* app, AInputEvent* inputEvent)
 {
-	return 0;
+	return static_cast<Engine*>(app->userData)->inputQueue.onInputEvent(inputEvent) ? 1 : 0;
 }
 
 void android_main(struct android_app* app)
 {
 	FileReader::setup(app->activity->assetManager);
 
-	VulkanMain vulkanMain;
-	app->userData = &vulkanMain;
+	RendererSettings rendererSettings;
+	Engine engine(rendererSettings);
+	app->userData = &engine;
+
+	JobSystemSettings jobSystemSettings;
+	jobSystemSettings.affinity = CoreAffinity::BIG_CORES;
+	engine.jobSystem.start(jobSystemSettings);
 
 	app->onAppCmd = handle_cmd;
 	app->onInputEvent = handle_input;
@@ -45,17 +82,36 @@ void android_main(struct android_app* app)
 	int events;
 	android_poll_source* pollSource;
 
+	std::chrono::steady_clock::time_point lastUpdate = std::chrono::steady_clock::now();
+
 	do
 	{
-		if (ALooper_pollAll(vulkanMain.m_isReady ? 1 : 0, nullptr, &events, (void**)&pollSource) >= 0)
+		int timeoutMillis = -1;
+		if (engine.renderThread.isRunning())
+		{
+			// Keep handling events until the render thread wants the next state
+			timeoutMillis = std::max(1, (int) (engine.renderThread.getTimeUntilNextFrame() * 1000.0f));
+		}
+
+		if (ALooper_pollAll(timeoutMillis, nullptr, &events, (void**)&pollSource) >= 0)
 		{
 			if (pollSource != nullptr)
 				pollSource->process(app, pollSource);
 		}
 
-		if (vulkanMain.m_isReady)
+		if (engine.renderThread.isRunning() && engine.renderThread.needsFrameState())
 		{
-			vulkanMain.draw();
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			std::chrono::duration<float> deltaTime = now - lastUpdate;
+			lastUpdate = now;
+
+			engine.simulation.setViewport(ANativeWindow_getWidth(app->window), ANativeWindow_getHeight(app->window));
+			engine.simulation.applyInput(engine.inputQueue.consume());
+			engine.simulation.update(deltaTime.count(), engine.renderThread.getFrameState());
+			engine.renderThread.publishFrameState();
 		}
 	} while (app->destroyRequested == 0);
-}
\ No newline at end of file
+
+	engine.renderThread.stop();
+	engine.jobSystem.stop();
+}
@@ -0,0 +1,94 @@
+#include "Simulation.h"
+
+// Same speed as the old per frame rotation at 60 fps
+const float ROTATION_SPEED = glm::pi<float>() / 30.0f;
+
+// Rings of small colored lights circling the objects, alternating in front of
+// and behind them. Each one only reaches the few clusters around it.
+const uint32_t LIGHT_COUNT = 256;
+const uint32_t LIGHT_RINGS = 4;
+const float LIGHT_ORBIT_RADIUS = 0.5f;
+const float LIGHT_RING_SPACING = 0.5f;
+const float LIGHT_ORBIT_SPEED = glm::pi<float>() / 8.0f;
+const float LIGHT_HEIGHT = 0.5f;
+const float LIGHT_RADIUS = 0.6f;
+
+// Low and from the side, the rotating quad's shadow falls across the one behind it
+const glm::vec3 SUN_DIRECTION = glm::normalize(glm::vec3(0.7f, 1.4f, -1.0f));
+const glm::vec3 SUN_COLOR = glm::vec3(0.9f, 0.8f, 0.6f);
+
+Simulation::Simulation(JobSystem* pJobSystem) :
+		m_width(0.0f),
+		m_height(0.0f),
+		m_pJobSystem(pJobSystem),
+		m_rotationAngle(0.0f),
+		m_lightAngle(0.0f)
+{
+	m_objects.push_back(m_transforms.create());
+
+	TransformId translated = m_transforms.create();
+	m_transforms.setTranslation(translated, {1, 2, -1});
+	m_objects.push_back(translated);
+}
+
+void Simulation::setViewport(float width, float height)
+{
+	if (width == m_width && height == m_height)
+	{
+		return;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_camera.setSize(width, height);
+}
+
+void Simulation::applyInput(const TouchDelta& touchDelta)
+{
+	if ((touchDelta.x == 0.0f && touchDelta.y == 0.0f) || m_height <= 0.0f)
+	{
+		return;
+	}
+
+	// A drag over the screen height turns the camera half way around
+	float radiansPerPixel = glm::pi<float>() / m_height;
+	m_camera.rotate(touchDelta.x * radiansPerPixel, touchDelta.y * radiansPerPixel);
+}
+
+void Simulation::update(float deltaSeconds, FrameState& frameState)
+{
+	m_rotationAngle = glm::mod(m_rotationAngle + ROTATION_SPEED * deltaSeconds, 2.0f * glm::pi<float>());
+	m_transforms.setRotation(m_objects[0], glm::angleAxis(m_rotationAngle, glm::vec3(0, 0, 1)));
+
+	m_transforms.update(m_pJobSystem);
+
+	frameState.view = m_camera.getView();
+	frameState.projection = m_camera.getProjection();
+	frameState.viewProjection = m_camera.getViewProjection();
+
+	frameState.models.resize(m_objects.size());
+	for (size_t i = 0; i < m_objects.size(); ++i)
+	{
+		frameState.models[i] = m_transforms.getWorld(m_objects[i]);
+	}
+
+	m_lightAngle = glm::mod(m_lightAngle + LIGHT_ORBIT_SPEED * deltaSeconds, 2.0f * glm::pi<float>());
+
+	frameState.lights.resize(LIGHT_COUNT);
+	for (uint32_t i = 0; i < LIGHT_COUNT; ++i)
+	{
+		uint32_t ring = i % LIGHT_RINGS;
+		float hue = 2.0f * glm::pi<float>() * (i / LIGHT_RINGS) / (LIGHT_COUNT / LIGHT_RINGS);
+		// Neighboring rings turn in opposite directions
+		float angle = (ring % 2 == 0 ? m_lightAngle : -m_lightAngle) + hue;
+		float orbitRadius = LIGHT_ORBIT_RADIUS + ring * LIGHT_RING_SPACING;
+
+		PointLight& light = frameState.lights[i];
+		light.position = glm::vec3(glm::cos(angle) * orbitRadius, glm::sin(angle) * orbitRadius, (i / LIGHT_RINGS) % 2 == 0 ? LIGHT_HEIGHT : -LIGHT_HEIGHT);
+		light.radius = LIGHT_RADIUS;
+		light.color = 0.5f + 0.5f * glm::cos(glm::vec3(hue, hue + 2.0f * glm::pi<float>() / 3.0f, hue + 4.0f * glm::pi<float>() / 3.0f));
+	}
+
+	frameState.sun.direction = SUN_DIRECTION;
+	frameState.sun.color = SUN_COLOR;
+}
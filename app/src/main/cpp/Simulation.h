@@ -0,0 +1,39 @@
+#pragma once
+
+#include "camera/FocusedCamera.h"
+#include "FrameState.h"
+#include "input/InputQueue.h"
+#include "scene/TransformHierarchy.h"
+
+class JobSystem;
+
+// Game side of a frame: runs on the android_main thread and fills FrameStates.
+class Simulation
+{
+public:
+	Simulation(JobSystem* pJobSystem);
+
+	void setViewport(float width, float height);
+	// Orbits the camera with the drag of the whole frame
+	void applyInput(const TouchDelta& touchDelta);
+	void update(float deltaSeconds, FrameState& frameState);
+
+	FocusedCamera& getCamera()
+	{
+		return m_camera;
+	}
+
+private:
+	FocusedCamera m_camera;
+
+	float m_width;
+	float m_height;
+
+	JobSystem* m_pJobSystem;
+
+	TransformHierarchy m_transforms;
+	std::vector<TransformId> m_objects;
+
+	float m_rotationAngle;
+	float m_lightAngle;
+};
@@ -5,7 +5,6 @@
 
 #include "VulkanMain.h"
 
-#include "FileReader.h"
 
 #include <string>
 
@@ -13,17 +12,105 @@
 
 #include <android/log.h>
 #include <exception>
+#include <cstring>
 #include <vector>
 #include <set>
+#include <chrono>
+#include <algorithm>
 
+// Number of frame slots (semaphore pairs), upper bound of the frames in flight
 const uint32_t MAX_FRAMES_IN_FLIGHT = 5;
 
-#define CALL_VK(result)                                               \
-    if (VK_SUCCESS != (result)) {                                     \
-        __android_log_print(ANDROID_LOG_ERROR, "Test ",             \
-        "Vulkan error. File[%s], line[%d]", __FILE__, __LINE__);    \
-        assert(false);                                              \
-        }
+// Objects drawn per frame, sizes the per frame uniform buffers
+const uint32_t MAX_OBJECTS = 256;
+
+// Capacity of the bindless arrays, clamped to the device limits
+const uint32_t MAX_BINDLESS_BUFFERS = 1024;
+const uint32_t MAX_BINDLESS_IMAGES = 4096;
+
+// Every SPIR-V module, packed by the CMake build
+const char SHADER_BUNDLE_FILE[] = "shaders.bundle";
+
+// Saved in the app's internal storage between runs
+const char PIPELINE_CACHE_FILE[] = "pipeline_cache.bin";
+
+// Reads its object data from the bindless buffer array instead of a UBO binding
+const char BINDLESS_VERTEX_SHADER[] = "triangle_bindless.vert.spv";
+
+// constant_id in triangle.frag
+const uint32_t TRIANGLE_IS_TARGET_SRGB = 0;
+
+// Unlit, drawn with until triangle.frag is compiled
+const char FALLBACK_FRAGMENT_SHADER[] = "fallback.frag.spv";
+
+// constant_id in fallback.frag
+const uint32_t FALLBACK_IS_TARGET_SRGB = 0;
+
+// Replaces triangle.frag when shading is deferred
+const char GBUFFER_FRAGMENT_SHADER[] = "gbuffer.frag.spv";
+
+// constant_id in lighting.frag
+const uint32_t LIGHTING_IS_TARGET_SRGB = 0;
+
+// Bins the lights into the clusters, once per frame
+const char CLUSTER_SHADER[] = "cluster_lights.comp.spv";
+
+// Set and bindings of the lights and clusters in clusters.glsl, the G-buffer of
+// lighting.frag is in the same set. Set 0 may be the bindless table.
+const uint32_t LIGHT_SET = 1;
+const uint32_t LIGHT_BUFFER_BINDING = 3;
+const uint32_t CLUSTER_BUFFER_BINDING = 4;
+// shadowMaps in shadows.glsl
+const uint32_t SHADOW_MAP_BINDING = 5;
+
+// Depth only, from the sun
+const char SHADOW_VERTEX_SHADER[] = "shadow.vert.spv";
+const char SHADOW_FRAGMENT_SHADER[] = "shadow.frag.spv";
+
+// Needs no features, it is sampled with linear filtering where supported
+const VkFormat SHADOW_MAP_FORMAT = VK_FORMAT_D16_UNORM;
+
+// Pushes the casters' depth away from the sun, the constant factor in units of
+// the format and the slope factor for surfaces lit at grazing angles
+const float SHADOW_DEPTH_BIAS_CONSTANT = 1.25f;
+const float SHADOW_DEPTH_BIAS_SLOPE = 1.75f;
+
+// Passes of the render graph
+const char CLUSTER_PASS[] = "light clusters";
+const char SCENE_PASS[] = "scene";
+const char LIGHTING_PASS[] = "lighting";
+const char UPSCALE_PASS[] = "upscale";
+const char* const SHADOW_PASSES[] = {"shadow cascade 0", "shadow cascade 1", "shadow cascade 2"};
+const char* const SHADOW_MAPS[] = {"shadow map 0", "shadow map 1", "shadow map 2"};
+static_assert(sizeof(SHADOW_PASSES) / sizeof(SHADOW_PASSES[0]) == SHADOW_CASCADE_COUNT, "A pass per cascade");
+static_assert(sizeof(SHADOW_MAPS) / sizeof(SHADOW_MAPS[0]) == SHADOW_CASCADE_COUNT, "A map per cascade");
+
+// Target of the scene with dynamic resolution, always allocated at the full
+// swapchain extent. Filtered in linear space when it is upscaled.
+const char SCENE_COLOR[] = "scene color";
+const VkFormat SCENE_COLOR_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
+const char UPSCALE_FRAGMENT_SHADER[] = "upscale.frag.spv";
+
+// constant_id in upscale.frag
+const uint32_t UPSCALE_IS_TARGET_SRGB = 0;
+
+// Set of the scene color in upscale.frag
+const uint32_t UPSCALE_SET = 1;
+
+// Push constants of triangle_bindless.vert
+struct DrawConstants
+{
+	uint32_t bufferIndex;
+	uint32_t objectIndex;
+};
+
+// Push constants of upscale.frag
+struct UpscaleConstants
+{
+	glm::vec2 uvPerPixel;
+	glm::vec2 maxUv;
+};
 
 #ifdef VALIDATION
 
@@ -109,15 +196,29 @@ const std::vector<const char *> VALIDATION_LAYERS = {
 #endif // !VALIDATION
 
 
-std::vector<const char *> INSTANCE_EXTENSIONS({VK_KHR_SURFACE_EXTENSION_NAME, VK_KHR_ANDROID_SURFACE_EXTENSION_NAME});
+const std::vector<const char *> INSTANCE_EXTENSIONS({VK_KHR_SURFACE_EXTENSION_NAME, VK_KHR_ANDROID_SURFACE_EXTENSION_NAME});
 const std::vector<const char *> DEVICE_EXTENSIONS({VK_KHR_SWAPCHAIN_EXTENSION_NAME});
 
 
-VulkanMain::VulkanMain() :
+VulkanMain::VulkanMain(const RendererSettings& settings, JobSystem* pJobSystem) :
+		m_settings(settings),
+		m_pJobSystem(pJobSystem),
+		m_supportsPhysicalDeviceProperties2(false),
+		m_supportsTimelineSemaphore(false),
+		m_supportsDescriptorUpdateTemplate(false),
+		m_renderPassHash(0),
+		m_nDrawnObjects(0),
 		m_semaphoresImageAvailable(MAX_FRAMES_IN_FLIGHT),
 		m_semaphoresRenderFinished(MAX_FRAMES_IN_FLIGHT),
-		m_inFlightFences(MAX_FRAMES_IN_FLIGHT),
+		m_frameTimelineValues(MAX_FRAMES_IN_FLIGHT, 0),
+		m_framesInFlightController(settings.framesInFlight, settings.adaptiveFramesInFlight),
 		m_currentFrameIndex(0),
+		m_renderScaleController(settings.gpuFrameBudget, settings.minRenderScale, settings.dynamicResolution),
+		m_useDynamicResolution(false),
+		m_renderExtent({0, 0}),
+		m_upscaleSampler(VK_NULL_HANDLE),
+		m_supportsDisplayTiming(false),
+		m_presentId(0),
 		m_vertices({
 				           {{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
 				           {{0.5f,  -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}},
@@ -125,7 +226,13 @@ VulkanMain::VulkanMain() :
 				           {{-0.5f, 0.5f,  0.0f}, {1.0f, 1.0f, 1.0f}},
 		           }),
 
-		m_indexes({0, 1, 2, 0, 2, 3})
+		m_indexes({0, 1, 2, 0, 2, 3}),
+		m_useBindless(false),
+		m_maxBindlessBuffers(0),
+		m_maxBindlessImages(0),
+		m_shadows(settings.shadowMapSize, settings.shadowDistance),
+		m_shadowSampler(VK_NULL_HANDLE),
+		m_pDrawnModels(nullptr)
 {
 
 }
@@ -161,35 +268,81 @@ void VulkanMain::init(android_app *pApp)
 
 	m_pApp = pApp;
 
+	// Needed to pick the device's features already
+	if (!m_shaderBundle.load(SHADER_BUNDLE_FILE))
+	{
+		__android_log_assert("Invalid shader bundle.", nullptr, "%s", SHADER_BUNDLE_FILE);
+	}
+
 	createInstance();
 	createSurface();
 	createDevice();
-	createSwapChain();
+	createSwapChain(VK_NULL_HANDLE);
 	m_imageViews = createImageViews(m_logicalDevice, m_images, m_swapchainSupportDetails);
-	createRenderPass();
-	createDescriptorSetLayout();
-	createGraphicsPipeline("triangle.vert.spv", "triangle.frag.spv");
+	m_depthFormat = findDepthFormat();
+	// Before the graph, which imports the cluster buffer
+	createLightBuffers();
+	createRenderGraph();
+	createDescriptorAllocators();
+	createPipelines();
+	createSamplers();
 
-	createFramebuffers();
 	createCommandPool();
+	createStagingRing();
 
 	createVertexBuffer();
 	createIndexBuffer();
+	m_stagingRing.flush();
+
 	createUniformBuffers();
-	createDescriptorPool();
-	createDescriptorSets();
 
 	createCommandBuffers();
 	createSyncObjects();
 
+	m_lastFrameStart = std::chrono::steady_clock::now();
+	m_framePacer.setEnabled(m_settings.lowLatencyPacing);
 	m_isReady = true;
 }
 
 void VulkanMain::destroy()
 {
+	vkDeviceWaitIdle(m_logicalDevice);
+
 	cleanupSwapChain();
+	m_deletionQueue.destroy();
+
+	m_stagingRing.destroy();
+
+	m_bindlessTable.destroy();
+	m_descriptorCache.destroy();
+	m_descriptorUpdateTemplates.destroy();
+	for (DescriptorAllocator& allocator : m_frameDescriptorAllocators)
+	{
+		allocator.destroy();
+	}
+	m_pipelineManager.destroy();
+	m_shaderCache.destroy();
+	m_layoutCache.destroy();
+
+	for (int i = 0; i < m_uniformBuffers.size(); ++i)
+	{
+		vkUnmapMemory(m_logicalDevice, m_uniformBuffersMemory[i]);
+		vkDestroyBuffer(m_logicalDevice, m_uniformBuffers[i], nullptr);
+		vkFreeMemory(m_logicalDevice, m_uniformBuffersMemory[i], nullptr);
+	}
+
+	for (int i = 0; i < m_lightBuffers.size(); ++i)
+	{
+		vkUnmapMemory(m_logicalDevice, m_lightBuffersMemory[i]);
+		vkDestroyBuffer(m_logicalDevice, m_lightBuffers[i], nullptr);
+		vkFreeMemory(m_logicalDevice, m_lightBuffersMemory[i], nullptr);
+	}
 
-	vkDestroyDescriptorSetLayout(m_logicalDevice, m_uboDescriptorSetLayout, nullptr);
+	vkDestroyBuffer(m_logicalDevice, m_clusterBuffer, nullptr);
+	vkFreeMemory(m_logicalDevice, m_clusterBufferMemory, nullptr);
+
+	vkDestroySampler(m_logicalDevice, m_shadowSampler, nullptr);
+	vkDestroySampler(m_logicalDevice, m_upscaleSampler, nullptr);
 
 	vkDestroyBuffer(m_logicalDevice, m_vertexBuffer, nullptr);
 	vkFreeMemory(m_logicalDevice, m_vertexBufferMemory, nullptr);
@@ -201,9 +354,11 @@ void VulkanMain::destroy()
 	{
 		vkDestroySemaphore(m_logicalDevice, m_semaphoresImageAvailable[i], nullptr);
 		vkDestroySemaphore(m_logicalDevice, m_semaphoresRenderFinished[i], nullptr);
-		vkDestroyFence(m_logicalDevice, m_inFlightFences[i], nullptr);
 	}
 
+	m_gpuFrameTimer.destroy();
+	m_timeline.destroy();
+
 	vkDestroyCommandPool(m_logicalDevice, m_commandPool, nullptr);
 	vkDestroyDevice(m_logicalDevice, nullptr);
 
@@ -215,16 +370,42 @@ void VulkanMain::destroy()
 	vkDestroyInstance(m_instance, nullptr);
 }
 
-static glm::mat4 mooodel = glm::mat4(1);
+void VulkanMain::setFramesInFlight(uint32_t framesInFlight, bool isAdaptive)
+{
+	m_framesInFlightController.setFramesInFlight(framesInFlight, isAdaptive);
+}
+
+float VulkanMain::getTimeUntilNextFrame() const
+{
+	return m_framePacer.getTimeUntilFrame();
+}
 
-void VulkanMain::draw()
+float VulkanMain::getFrameInterval() const
 {
-	vkWaitForFences(m_logicalDevice, 1, &m_inFlightFences[m_currentFrameIndex], VK_TRUE, UINT64_MAX);
+	return m_framePacer.getFrameInterval();
+}
+
+void VulkanMain::draw(const FrameState& frameState)
+{
+	std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+
+	// The frame N frames back has to be done before this one starts. The slot
+	// reused below belongs to an even older frame, so it is free as well.
+	uint32_t framesInFlight = m_framesInFlightController.getFramesInFlight();
+	m_timeline.wait(m_frameTimelineValues[(m_currentFrameIndex + MAX_FRAMES_IN_FLIGHT - framesInFlight) % MAX_FRAMES_IN_FLIGHT]);
+
+	std::chrono::duration<float> waitTime = std::chrono::steady_clock::now() - frameStart;
+
+	m_deletionQueue.flush();
+
+	std::chrono::steady_clock::time_point acquireStart = std::chrono::steady_clock::now();
 
 	uint32_t imageIndex;
 	VkResult imageResult = vkAcquireNextImageKHR(m_logicalDevice, m_swapchain, UINT64_MAX,
 	                                             m_semaphoresImageAvailable[m_currentFrameIndex], VK_NULL_HANDLE, &imageIndex);
 
+	std::chrono::duration<float> acquireTime = std::chrono::steady_clock::now() - acquireStart;
+
 	if (imageResult == VK_ERROR_OUT_OF_DATE_KHR)
 	{
 		recreateSwapChain();
@@ -235,34 +416,74 @@ void VulkanMain::draw()
 	}
 
 
-	if (m_imagesInFlight[imageIndex] != VK_NULL_HANDLE)
+	// Usually already complete, wait() then returns without a driver call
+	std::chrono::steady_clock::time_point imageWaitStart = std::chrono::steady_clock::now();
+	m_timeline.wait(m_imageTimelineValues[imageIndex]);
+	waitTime += std::chrono::steady_clock::now() - imageWaitStart;
+
+	std::chrono::duration<float> frameTime = frameStart - m_lastFrameStart;
+	m_lastFrameStart = frameStart;
+	m_framesInFlightController.update(waitTime.count(), frameTime.count());
+	m_framePacer.onFrameBlocked(waitTime.count() + acquireTime.count());
+
+	// Everything of this frame slot is free again
+	m_frameDescriptorAllocators[m_currentFrameIndex].reset();
+
+	// Measured a few frames back, the scale reacts with that delay
+	float gpuTime;
+	if (m_gpuFrameTimer.read(m_currentFrameIndex, &gpuTime) && m_useDynamicResolution)
 	{
-		vkWaitForFences(m_logicalDevice, 1, &m_imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+		m_renderScaleController.update(gpuTime);
 	}
 
-	m_imagesInFlight[imageIndex] = m_inFlightFences[m_currentFrameIndex];
+	// Only the render area changes, the attachments and the swapchain stay
+	VkExtent2D extent = m_swapchainSupportDetails.extent;
+	float renderScale = m_useDynamicResolution ? m_renderScaleController.getScale() : 1.0f;
+	m_renderExtent.width = std::max(1u, (uint32_t) (extent.width * renderScale + 0.5f));
+	m_renderExtent.height = std::max(1u, (uint32_t) (extent.height * renderScale + 0.5f));
+
+	uint32_t nObjects = std::min((uint32_t) frameState.models.size(), MAX_OBJECTS);
 
-	/////////////////////////////////
 	UniformBufferObject ubo = {};
-	mooodel = glm::rotate_slow(mooodel, glm::pi<float>() / 1800, glm::vec3(0, 0, 1));
-	ubo.model = mooodel;
-	ubo.view = m_camera.getView();
-	ubo.projection = m_camera.getProjection();
-	ubo.projection[1][1] *= -1;
-
-	void *data;
-	vkMapMemory(m_logicalDevice, m_uniformBuffersMemory[(imageIndex * 2)], 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(m_logicalDevice, m_uniformBuffersMemory[(imageIndex * 2)]);
-	/////////////////////////////////
-	/////////////////////////////////
-	ubo.model = glm::mat4(1);
-	ubo.model = glm::translate(ubo.model, {1, 2, -1});
-
-	vkMapMemory(m_logicalDevice, m_uniformBuffersMemory[(imageIndex * 2) + 1], 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(m_logicalDevice, m_uniformBuffersMemory[(imageIndex * 2) + 1]);
-	/////////////////////////////////
+	ubo.view = frameState.view;
+	ubo.projection = frameState.projection;
+	for (uint32_t i = 0; i < nObjects; ++i)
+	{
+		ubo.model = frameState.models[i];
+		memcpy(m_uniformBufferMappings[m_currentFrameIndex] + i * m_uniformStride, &ubo, sizeof(ubo));
+	}
+
+	// Decides which shadow passes run, the matrices below are those of the maps after this frame
+	m_shadows.update(frameState);
+
+	// The cluster pass unprojects its tiles with the same projection the scene is drawn with
+	LightBufferObject* pLights = m_lightBufferMappings[m_currentFrameIndex];
+	pLights->inverseProjection = glm::inverse(frameState.projection);
+
+	// Clip space xy to texture coordinates, the depth range already is 0 to 1
+	glm::mat4 shadowBias = glm::mat4(0.5f, 0.0f, 0.0f, 0.0f,
+	                                 0.0f, 0.5f, 0.0f, 0.0f,
+	                                 0.0f, 0.0f, 1.0f, 0.0f,
+	                                 0.5f, 0.5f, 0.0f, 1.0f);
+	glm::mat4 inverseView = glm::inverse(frameState.view);
+	for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		pLights->shadowMatrices[i] = shadowBias * m_shadows.getViewProjection(i) * inverseView;
+	}
+	pLights->sunDirection = glm::vec4(glm::normalize(glm::mat3(frameState.view) * -frameState.sun.direction), 0.0f);
+	pLights->sunColor = glm::vec4(frameState.sun.color, 0.0f);
+	pLights->viewportSize = glm::vec2(m_renderExtent.width, m_renderExtent.height);
+	pLights->lightCount = std::min((uint32_t) frameState.lights.size(), MAX_LIGHTS);
+	for (uint32_t i = 0; i < pLights->lightCount; ++i)
+	{
+		const PointLight& light = frameState.lights[i];
+		pLights->lights[i].positionRadius = glm::vec4(glm::vec3(frameState.view * glm::vec4(light.position, 1.0f)), light.radius);
+		pLights->lights[i].color = glm::vec4(light.color, 0.0f);
+	}
+
+	VkCommandBuffer commandBuffer = m_commandBuffers[m_currentFrameIndex];
+	m_pDrawnModels = &frameState.models;
+	recordCommandBuffer(commandBuffer, imageIndex, nObjects);
 
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -272,13 +493,14 @@ void VulkanMain::draw()
 	submitInfo.pWaitDstStageMask = &waitFlag;
 
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &m_commandBuffers[imageIndex];
+	submitInfo.pCommandBuffers = &commandBuffer;
 
 	submitInfo.signalSemaphoreCount = 1;
 	submitInfo.pSignalSemaphores = &m_semaphoresRenderFinished[m_currentFrameIndex];
 
-	vkResetFences(m_logicalDevice, 1, &m_inFlightFences[m_currentFrameIndex]);
-	CALL_VK(vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_inFlightFences[m_currentFrameIndex]));
+	uint64_t timelineValue = m_timeline.submit(m_graphicsQueue, submitInfo);
+	m_frameTimelineValues[m_currentFrameIndex] = timelineValue;
+	m_imageTimelineValues[imageIndex] = timelineValue;
 
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -289,7 +511,23 @@ void VulkanMain::draw()
 	presentInfo.pSwapchains = &m_swapchain;
 	presentInfo.pImageIndices = &imageIndex;
 
+	// Only identifies the present for the timing feedback, no target time
+	VkPresentTimeGOOGLE presentTime = {};
+	presentTime.presentID = ++m_presentId;
+	presentTime.desiredPresentTime = 0;
+
+	VkPresentTimesInfoGOOGLE presentTimesInfo = {};
+	presentTimesInfo.sType = VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE;
+	presentTimesInfo.swapchainCount = 1;
+	presentTimesInfo.pTimes = &presentTime;
+
+	if (m_supportsDisplayTiming && m_framePacer.isEnabled())
+	{
+		presentInfo.pNext = &presentTimesInfo;
+	}
+
 	imageResult = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+	m_framePacer.onFrameSubmitted();
 
 	if (imageResult == VK_ERROR_OUT_OF_DATE_KHR || imageResult == VK_SUBOPTIMAL_KHR || m_framebufferResized)
 	{
@@ -298,11 +536,34 @@ void VulkanMain::draw()
 	} else
 	{
 		CALL_VK(imageResult);
+
+		if (m_supportsDisplayTiming && m_framePacer.isEnabled())
+		{
+			readPresentationTiming();
+		}
 	}
 
 	m_currentFrameIndex = (m_currentFrameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
+void VulkanMain::readPresentationTiming()
+{
+	uint32_t nTimings = 0;
+	m_pfnGetPastPresentationTiming(m_logicalDevice, m_swapchain, &nTimings, nullptr);
+	if (nTimings == 0)
+	{
+		return;
+	}
+
+	std::vector<VkPastPresentationTimingGOOGLE> timings(nTimings);
+	m_pfnGetPastPresentationTiming(m_logicalDevice, m_swapchain, &nTimings, timings.data());
+
+	for (uint32_t i = 0; i < nTimings; ++i)
+	{
+		m_framePacer.onPresentMargin(timings[i].presentMargin * 1e-9f);
+	}
+}
+
 
 void VulkanMain::createInstance()
 {
@@ -338,13 +599,22 @@ void VulkanMain::createInstance()
 	applicationInfo.applicationVersion = VK_MAKE_VERSION(0, 0, 1);
 
 
+	std::vector<const char*> instanceExtensions(INSTANCE_EXTENSIONS);
+
+	// Needed by VK_KHR_timeline_semaphore and VK_EXT_descriptor_indexing on 1.0 instances
+	m_supportsPhysicalDeviceProperties2 = isInstanceExtensionSupported(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	if (m_supportsPhysicalDeviceProperties2)
+	{
+		instanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	}
+
 	VkInstanceCreateInfo instanceCreateInfo = {};
 	instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	instanceCreateInfo.pNext = nullptr;
 	instanceCreateInfo.flags = 0;
 
 #ifdef VALIDATION
-	INSTANCE_EXTENSIONS.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+	instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 
 	instanceCreateInfo.enabledLayerCount = static_cast<uint32_t>(VALIDATION_LAYERS.size());
 	instanceCreateInfo.ppEnabledLayerNames = VALIDATION_LAYERS.data();
@@ -355,8 +625,8 @@ void VulkanMain::createInstance()
 	instanceCreateInfo.ppEnabledLayerNames = nullptr;
 #endif // !VALIDATION
 
-	instanceCreateInfo.enabledExtensionCount = INSTANCE_EXTENSIONS.size();
-	instanceCreateInfo.ppEnabledExtensionNames = INSTANCE_EXTENSIONS.data();
+	instanceCreateInfo.enabledExtensionCount = instanceExtensions.size();
+	instanceCreateInfo.ppEnabledExtensionNames = instanceExtensions.data();
 
 	instanceCreateInfo.pApplicationInfo = &applicationInfo;
 
@@ -446,8 +716,59 @@ void VulkanMain::createDevice()
 	VkPhysicalDeviceFeatures physicalDeviceFeatures = {};
 	deviceCreateInfo.pEnabledFeatures = &physicalDeviceFeatures;
 
-	deviceCreateInfo.ppEnabledExtensionNames = DEVICE_EXTENSIONS.data();
-	deviceCreateInfo.enabledExtensionCount = (uint32_t) DEVICE_EXTENSIONS.size();
+	std::vector<const char*> deviceExtensions(DEVICE_EXTENSIONS);
+
+#ifdef VK_KHR_timeline_semaphore
+	// Supporting the extension implies supporting the feature
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures = {};
+	timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+
+	m_supportsTimelineSemaphore = m_settings.preferTimelineSemaphore &&
+	                              isDeviceExtensionSupported(physicalDevice, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+	if (m_supportsTimelineSemaphore)
+	{
+		deviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		timelineSemaphoreFeatures.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+		deviceCreateInfo.pNext = &timelineSemaphoreFeatures;
+	}
+#endif // VK_KHR_timeline_semaphore
+
+#ifdef VK_EXT_descriptor_indexing
+	// Only the features BindlessTable relies on
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures = {};
+	descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+	descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+	descriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+	descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+
+	m_useBindless = m_settings.preferBindless && isBindlessSupported(physicalDevice);
+	if (m_useBindless)
+	{
+		deviceExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+		deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		descriptorIndexingFeatures.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+		deviceCreateInfo.pNext = &descriptorIndexingFeatures;
+	}
+#endif // VK_EXT_descriptor_indexing
+
+#ifdef VK_KHR_descriptor_update_template
+	m_supportsDescriptorUpdateTemplate = isDeviceExtensionSupported(physicalDevice, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+	if (m_supportsDescriptorUpdateTemplate)
+	{
+		deviceExtensions.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+	}
+#endif // VK_KHR_descriptor_update_template
+
+	m_supportsDisplayTiming = isDeviceExtensionSupported(physicalDevice, VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME);
+	if (m_supportsDisplayTiming)
+	{
+		deviceExtensions.push_back(VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME);
+	}
+
+	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	deviceCreateInfo.enabledExtensionCount = (uint32_t) deviceExtensions.size();
 
 	deviceCreateInfo.enabledLayerCount = 0;
 	deviceCreateInfo.ppEnabledLayerNames = nullptr;
@@ -457,21 +778,51 @@ void VulkanMain::createDevice()
 	// Queues
 	vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndexes.graphical, 0, &m_graphicsQueue);
 	vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndexes.present, 0, &m_presentQueue);
+
+	if (m_supportsDisplayTiming)
+	{
+		m_pfnGetRefreshCycleDuration = (PFN_vkGetRefreshCycleDurationGOOGLE) vkGetDeviceProcAddr(m_logicalDevice, "vkGetRefreshCycleDurationGOOGLE");
+		m_pfnGetPastPresentationTiming = (PFN_vkGetPastPresentationTimingGOOGLE) vkGetDeviceProcAddr(m_logicalDevice, "vkGetPastPresentationTimingGOOGLE");
+
+		m_supportsDisplayTiming = m_pfnGetRefreshCycleDuration != nullptr && m_pfnGetPastPresentationTiming != nullptr;
+	}
+
+	m_timeline.create(m_logicalDevice, m_supportsTimelineSemaphore);
+	m_deletionQueue.create(m_logicalDevice, &m_timeline);
+
+	// Without timestamps there is nothing to adapt to, the scene is then drawn at full resolution directly
+	m_gpuFrameTimer.create(m_logicalDevice, physicalDevice, m_queueFamilyIndexes.graphical, MAX_FRAMES_IN_FLIGHT);
+	m_useDynamicResolution = m_settings.dynamicResolution && m_gpuFrameTimer.isSupported();
+
+	m_renderGraph.create(m_logicalDevice, m_physicalDevice, &m_deletionQueue);
 }
 
-void VulkanMain::createSwapChain()
+void VulkanMain::createSwapChain(VkSwapchainKHR oldSwapchain)
 {
 	// Swapchain
 	m_swapchainSupportDetails = getSwapChainSupportDetails(m_physicalDevice, m_surface, ANativeWindow_getWidth(m_pApp->window), ANativeWindow_getHeight(m_pApp->window));
-	m_camera.setSize(ANativeWindow_getWidth(m_pApp->window), ANativeWindow_getHeight(m_pApp->window));
 
-	m_swapchain = createSwapchain(VK_NULL_HANDLE, m_swapchainSupportDetails, m_logicalDevice, m_surface, m_queueFamilyIndexes);
+	m_swapchain = createSwapchain(oldSwapchain, m_swapchainSupportDetails, m_logicalDevice, m_surface, m_queueFamilyIndexes);
 
 	// Images TODO
 	uint32_t nImages = 0;
 	vkGetSwapchainImagesKHR(m_logicalDevice, m_swapchain, &nImages, nullptr);
 	m_images.resize(nImages);
 	vkGetSwapchainImagesKHR(m_logicalDevice, m_swapchain, &nImages, m_images.data());
+
+	m_imageTimelineValues.assign(nImages, 0);
+
+	// More frames than images can't be in flight, acquire would block first
+	m_framesInFlightController.setLimits(1, std::min(MAX_FRAMES_IN_FLIGHT, nImages));
+
+	if (m_supportsDisplayTiming)
+	{
+		VkRefreshCycleDurationGOOGLE refreshCycleDuration = {};
+		if (m_pfnGetRefreshCycleDuration(m_logicalDevice, m_swapchain, &refreshCycleDuration) == VK_SUCCESS)
+		{
+			m_framePacer.setRefreshDuration(refreshCycleDuration.refreshDuration * 1e-9f);
+		}
+	}
 }
 
 std::vector<VkImageView> VulkanMain::createImageViews(VkDevice logicalDevice, std::vector<VkImage> &images, SwapChainSupportDetails &swapchainSupportDetails) const
@@ -507,162 +858,252 @@ std::vector<VkImageView> VulkanMain::createImageViews(VkDevice logicalDevice, st
 	return imageViews;
 }
 
-void VulkanMain::createGraphicsPipeline(const char *vertexPath, const char *fragmentPath)
+void VulkanMain::createPipelines()
 {
-	VkShaderModule vertexModule = createShaderModule(vertexPath);
-	VkShaderModule fragmentModule = createShaderModule(fragmentPath);
+	std::string cachePath;
+	if (m_pApp->activity->internalDataPath != nullptr)
+	{
+		cachePath = std::string(m_pApp->activity->internalDataPath) + "/" + PIPELINE_CACHE_FILE;
+	}
 
-	std::vector<VkPipelineShaderStageCreateInfo> shaderStages = {
-			getCreateShaderPipelineInfo(vertexModule, VK_SHADER_STAGE_VERTEX_BIT),
-			getCreateShaderPipelineInfo(fragmentModule, VK_SHADER_STAGE_FRAGMENT_BIT)
-	};
+	m_shaderCache.create(m_logicalDevice, &m_shaderBundle);
+	m_pipelineManager.create(m_logicalDevice, m_physicalDevice, &m_layoutCache, &m_shaderCache, m_pJobSystem, cachePath);
+	if (m_useBindless)
+	{
+		m_pipelineManager.setSetLayoutOverride(0, m_bindlessTable.getLayout());
+	}
+
+	m_trianglePipelineKey.vertexShader = m_pipelineManager.getShaderId(m_useBindless ? BINDLESS_VERTEX_SHADER : "triangle.vert.spv");
+	m_trianglePipelineKey.fragmentShader = m_pipelineManager.getShaderId("triangle.frag.spv");
+	m_trianglePipelineKey.vertexStride = sizeof(Vertex);
+	// Reverse-Z: the near plane is at 1 and the (infinite) far plane at 0
+	m_trianglePipelineKey.depthCompareOp = m_settings.reverseDepth ? VK_COMPARE_OP_GREATER_OR_EQUAL : VK_COMPARE_OP_LESS;
+
+	if (m_settings.deferredShading)
+	{
+		// Writes the G-buffer, there is nothing to blend with
+		m_trianglePipelineKey.fragmentShader = m_pipelineManager.getShaderId(GBUFFER_FRAGMENT_SHADER);
+		m_trianglePipelineKey.colorAttachmentCount = 2;
+		m_trianglePipelineKey.blendMode = BlendMode::OPAQUE;
+
+		m_lightingPipelineKey.vertexShader = m_pipelineManager.getShaderId("fullscreen.vert.spv");
+		m_lightingPipelineKey.fragmentShader = m_pipelineManager.getShaderId("lighting.frag.spv");
+		m_lightingPipelineKey.cullMode = VK_CULL_MODE_NONE;
+		m_lightingPipelineKey.isDepthTestEnabled = VK_FALSE;
+		m_lightingPipelineKey.isDepthWriteEnabled = VK_FALSE;
+		m_lightingPipelineKey.blendMode = BlendMode::OPAQUE;
+	}
+	else
+	{
+		// Same vertex input and object data, but none of the lights and shadows
+		m_triangleFallbackKey.vertexShader = m_trianglePipelineKey.vertexShader;
+		m_triangleFallbackKey.fragmentShader = m_pipelineManager.getShaderId(FALLBACK_FRAGMENT_SHADER);
+		m_triangleFallbackKey.vertexStride = sizeof(Vertex);
+		m_triangleFallbackKey.depthCompareOp = m_trianglePipelineKey.depthCompareOp;
+		m_triangleFallbackKey.blendMode = BlendMode::OPAQUE;
+	}
 
-	///////////////////////////////
-	////// VERTEX ATTRIBUTES //////
-	///////////////////////////////
+	// Conventional depth, the orthographic cascades gain nothing from reverse-Z.
+	// Both faces cast, the quads are single sided.
+	m_shadowPipelineKey.vertexShader = m_pipelineManager.getShaderId(SHADOW_VERTEX_SHADER);
+	m_shadowPipelineKey.fragmentShader = m_pipelineManager.getShaderId(SHADOW_FRAGMENT_SHADER);
+	m_shadowPipelineKey.vertexStride = sizeof(Vertex);
+	m_shadowPipelineKey.cullMode = VK_CULL_MODE_NONE;
+	m_shadowPipelineKey.depthCompareOp = VK_COMPARE_OP_LESS;
+	m_shadowPipelineKey.isDepthBiasEnabled = VK_TRUE;
+	m_shadowPipelineKey.blendMode = BlendMode::OPAQUE;
+	m_shadowPipelineKey.colorAttachmentCount = 0;
+
+	if (m_useDynamicResolution)
+	{
+		m_upscalePipelineKey.vertexShader = m_pipelineManager.getShaderId("fullscreen.vert.spv");
+		m_upscalePipelineKey.fragmentShader = m_pipelineManager.getShaderId(UPSCALE_FRAGMENT_SHADER);
+		m_upscalePipelineKey.cullMode = VK_CULL_MODE_NONE;
+		m_upscalePipelineKey.isDepthTestEnabled = VK_FALSE;
+		m_upscalePipelineKey.isDepthWriteEnabled = VK_FALSE;
+		m_upscalePipelineKey.blendMode = BlendMode::OPAQUE;
+	}
 
-	VkVertexInputBindingDescription bindingDescription = Vertex::getBindingDescription();
-	std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions = Vertex::getAttributeDescriptions();
+	// Doesn't depend on the render passes, compiled once
+	m_pipelineManager.getComputePipeline(CLUSTER_SHADER);
 
-	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
-	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
-	vertexInputCreateInfo.pVertexBindingDescriptions = &bindingDescription;
-	vertexInputCreateInfo.vertexAttributeDescriptionCount = attributeDescriptions.size();
-	vertexInputCreateInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+	updatePipelineTargets();
+}
 
+void VulkanMain::updatePipelineTargets()
+{
+	bool isTargetSrgb = isSrgbFormat(m_swapchainSupportDetails.surfaceFormat.format);
+	// The scene color is sRGB, upscale.frag encodes for the swapchain instead
+	bool isSceneTargetSrgb = m_useDynamicResolution || isTargetSrgb;
 
-	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo = {};
-	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
+	// Compatible with the old pass unless the surface format changed, then new pipelines are compiled
+	m_trianglePipelineKey.renderPassHash = m_renderPassHash;
+	m_trianglePipelineKey.subpass = m_renderGraph.getSubpass(SCENE_PASS);
 
-	VkViewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float) m_swapchainSupportDetails.extent.width;
-	viewport.height = (float) m_swapchainSupportDetails.extent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
+	if (m_settings.deferredShading)
+	{
+		// Blocks as well, the frame can't do without it
+		m_lightingPipelineKey.renderPassHash = m_renderGraph.getRenderPassHash(LIGHTING_PASS);
+		m_lightingPipelineKey.subpass = m_renderGraph.getSubpass(LIGHTING_PASS);
+		m_lightingPipelineKey.setConstant(LIGHTING_IS_TARGET_SRGB, isSceneTargetSrgb);
+		m_pipelineManager.getPipeline(m_lightingPipelineKey, m_renderGraph.getRenderPass(LIGHTING_PASS));
+	}
+	else
+	{
+		m_trianglePipelineKey.setConstant(TRIANGLE_IS_TARGET_SRGB, isSceneTargetSrgb);
 
-	VkRect2D scissor = {};
-	scissor.offset = {0, 0};
-	scissor.extent = m_swapchainSupportDetails.extent;
-
-	VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
-	viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportStateCreateInfo.viewportCount = 1;
-	viewportStateCreateInfo.pViewports = &viewport;
-	viewportStateCreateInfo.scissorCount = 1;
-	viewportStateCreateInfo.pScissors = &scissor;
-
-	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo = {};
-	rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizerCreateInfo.depthClampEnable = VK_FALSE;
-	rasterizerCreateInfo.rasterizerDiscardEnable = VK_FALSE;
-	rasterizerCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
-	rasterizerCreateInfo.lineWidth = 1.0f;
-	rasterizerCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizerCreateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-	// SHADOW MAPPING SHIT
-	rasterizerCreateInfo.depthBiasEnable = VK_FALSE;
-	rasterizerCreateInfo.depthBiasConstantFactor = 0.0f;
-	rasterizerCreateInfo.depthBiasClamp = 0.0f;
-	rasterizerCreateInfo.depthBiasSlopeFactor = 0.0f;
-
-	VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo = {};
-	multisamplingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisamplingCreateInfo.sampleShadingEnable = VK_FALSE;
-	multisamplingCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-	multisamplingCreateInfo.minSampleShading = 1.0f;
-	multisamplingCreateInfo.pSampleMask = nullptr;
-	multisamplingCreateInfo.alphaToCoverageEnable = VK_FALSE;
-	multisamplingCreateInfo.alphaToOneEnable = VK_FALSE;
-
-	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-	colorBlendAttachment.colorWriteMask =
-			VK_COLOR_COMPONENT_R_BIT |
-			VK_COLOR_COMPONENT_G_BIT |
-			VK_COLOR_COMPONENT_B_BIT |
-			VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_TRUE;
-	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-	VkPipelineColorBlendStateCreateInfo colorBlendingCreateInfo = {};
-	colorBlendingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlendingCreateInfo.logicOpEnable = VK_FALSE;
-	colorBlendingCreateInfo.logicOp = VK_LOGIC_OP_COPY;
-	colorBlendingCreateInfo.attachmentCount = 1;
-	colorBlendingCreateInfo.pAttachments = &colorBlendAttachment;
-	colorBlendingCreateInfo.blendConstants[0] = 0.0f;
-	colorBlendingCreateInfo.blendConstants[1] = 0.0f;
-	colorBlendingCreateInfo.blendConstants[2] = 0.0f;
-	colorBlendingCreateInfo.blendConstants[3] = 0.0f;
-
-	VkDynamicState dynamicState = VK_DYNAMIC_STATE_VIEWPORT;
-	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
-	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	dynamicStateCreateInfo.dynamicStateCount = 1;
-	dynamicStateCreateInfo.pDynamicStates = &dynamicState;
-
-	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
-	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutCreateInfo.setLayoutCount = 1;
-	pipelineLayoutCreateInfo.pSetLayouts = &m_uboDescriptorSetLayout;
-	pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-	pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
-	CALL_VK(vkCreatePipelineLayout(m_logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout));
-
-	//////////////////////
-	////// PIPELINE //////
-	//////////////////////
-
-	VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {};
-	graphicsPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	graphicsPipelineCreateInfo.stageCount = shaderStages.size();
-	graphicsPipelineCreateInfo.pStages = shaderStages.data();
-	graphicsPipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
-	graphicsPipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
-	graphicsPipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
-	graphicsPipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
-	graphicsPipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
-	graphicsPipelineCreateInfo.pDepthStencilState = nullptr;
-	graphicsPipelineCreateInfo.pColorBlendState = &colorBlendingCreateInfo;
-	graphicsPipelineCreateInfo.pDynamicState = nullptr;
-	graphicsPipelineCreateInfo.layout = m_pipelineLayout;
-	graphicsPipelineCreateInfo.renderPass = m_renderPass;
-	graphicsPipelineCreateInfo.subpass = 0;
-	graphicsPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
-	graphicsPipelineCreateInfo.basePipelineIndex = -1;
-
-	CALL_VK(vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &m_graphicsPipeline));
-
-	vkDestroyShaderModule(m_logicalDevice, vertexModule, nullptr);
-	vkDestroyShaderModule(m_logicalDevice, fragmentModule, nullptr);
+		m_triangleFallbackKey.renderPassHash = m_renderPassHash;
+		m_triangleFallbackKey.subpass = m_trianglePipelineKey.subpass;
+		m_triangleFallbackKey.setConstant(FALLBACK_IS_TARGET_SRGB, isSceneTargetSrgb);
+	}
+
+	if (m_useDynamicResolution)
+	{
+		m_upscalePipelineKey.renderPassHash = m_renderGraph.getRenderPassHash(UPSCALE_PASS);
+		m_upscalePipelineKey.subpass = m_renderGraph.getSubpass(UPSCALE_PASS);
+		m_upscalePipelineKey.setConstant(UPSCALE_IS_TARGET_SRGB, isTargetSrgb);
+		m_pipelineManager.getPipeline(m_upscalePipelineKey, m_renderGraph.getRenderPass(UPSCALE_PASS));
+	}
+
+	// The cascades' render passes are all compatible, one pipeline draws them
+	m_shadowPipelineKey.renderPassHash = m_renderGraph.getRenderPassHash(SHADOW_PASSES[0]);
+	m_shadowPipelineKey.subpass = m_renderGraph.getSubpass(SHADOW_PASSES[0]);
+	m_pipelineManager.getPipeline(m_shadowPipelineKey, m_renderGraph.getRenderPass(SHADOW_PASSES[0]));
+
+	if (m_settings.deferredShading)
+	{
+		// gbuffer.frag is as cheap as a fallback would be
+		m_pipelineManager.getPipeline(m_trianglePipelineKey, m_renderPass);
+	}
+	else
+	{
+		// Only the fallback blocks, the first frames draw with it if needed
+		m_pipelineManager.getPipeline(m_triangleFallbackKey, m_renderPass);
+		m_pipelineManager.requestPipeline(m_trianglePipelineKey, m_renderPass);
+	}
 }
 
-void VulkanMain::createFramebuffers()
+void VulkanMain::createRenderGraph()
 {
-	m_framebuffers.resize(m_imageViews.size());
+	VkExtent2D extent = m_swapchainSupportDetails.extent;
+
+	m_renderGraph.importImage("backbuffer", m_swapchainSupportDetails.surfaceFormat.format, extent, m_images, m_imageViews, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	m_renderGraph.addImage("depth", RenderGraphImageDesc(m_depthFormat, extent));
+
+	VkClearColorValue clearColor = {{0.0f, 0.0f, 0.0f, 1.0f}};
+	VkClearDepthStencilValue clearDepth = {m_settings.reverseDepth ? 0.0f : 1.0f, 0};
 
-	for (int i = m_imageViews.size() - 1; i >= 0; --i)
+	// Binned again every frame, the lights and the camera move
+	m_renderGraph.importBuffer("clusters", m_clusterBuffer);
+
+	RenderGraphPass& clusterPass = m_renderGraph.addPass(CLUSTER_PASS, RenderGraphPassType::COMPUTE);
+	clusterPass.addStorageWrite("clusters");
+	clusterPass.setRecord([this](VkCommandBuffer commandBuffer)
+	{
+		recordLightClusters(commandBuffer);
+	});
+
+	// Kept between frames and only rendered again when their cascade is scheduled
+	VkClearDepthStencilValue clearShadow = {1.0f, 0};
+	for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		RenderGraphImageDesc shadowDesc(SHADOW_MAP_FORMAT, {m_shadows.getMapSize(), m_shadows.getMapSize()});
+		shadowDesc.isPersistent = true;
+		m_renderGraph.addImage(SHADOW_MAPS[i], shadowDesc);
+
+		RenderGraphPass& shadowPass = m_renderGraph.addPass(SHADOW_PASSES[i], RenderGraphPassType::GRAPHICS);
+		shadowPass.setDepthOutput(SHADOW_MAPS[i], &clearShadow);
+		shadowPass.setCondition([this, i]()
+		{
+			return m_shadows.isScheduled(i);
+		});
+		shadowPass.setRecord([this, i](VkCommandBuffer commandBuffer)
+		{
+			recordShadowCascade(commandBuffer, i);
+		});
+	}
+
+	// Recreated with the graph
+	m_shadows.invalidate();
+
+	// With dynamic resolution the scene is drawn into the top left of its own
+	// target, sized for the full resolution so scale changes need no new images
+	const char* sceneColor = "backbuffer";
+	if (m_useDynamicResolution)
+	{
+		sceneColor = SCENE_COLOR;
+		m_renderGraph.addImage(SCENE_COLOR, RenderGraphImageDesc(SCENE_COLOR_FORMAT, extent));
+	}
+
+	RenderGraphPass& scenePass = m_renderGraph.addPass(SCENE_PASS, RenderGraphPassType::GRAPHICS);
+	scenePass.setDepthOutput("depth", &clearDepth);
+	scenePass.setRenderArea([this]()
 	{
-		VkFramebufferCreateInfo framebufferCreateInfo = {};
-		framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferCreateInfo.renderPass = m_renderPass;
-		framebufferCreateInfo.attachmentCount = 1;
-		framebufferCreateInfo.pAttachments = &m_imageViews[i];
-		framebufferCreateInfo.width = m_swapchainSupportDetails.extent.width;
-		framebufferCreateInfo.height = m_swapchainSupportDetails.extent.height;
-		framebufferCreateInfo.layers = 1;
+		return m_renderExtent;
+	});
+	scenePass.setRecord([this](VkCommandBuffer commandBuffer)
+	{
+		recordScene(commandBuffer);
+	});
 
-		CALL_VK(vkCreateFramebuffer(m_logicalDevice, &framebufferCreateInfo, nullptr, &m_framebuffers[i]));
+	if (m_settings.deferredShading)
+	{
+		// Only read by the lighting subpass at the same pixel, the graph makes
+		// them transient and merges both passes into one render pass
+		m_renderGraph.addImage("albedo", RenderGraphImageDesc(VK_FORMAT_R8G8B8A8_UNORM, extent));
+		m_renderGraph.addImage("normal", RenderGraphImageDesc(VK_FORMAT_A2B10G10R10_UNORM_PACK32, extent));
+
+		VkClearColorValue clearGBuffer = {{0.0f, 0.0f, 0.0f, 0.0f}};
+		scenePass.addColorOutput("albedo", &clearGBuffer);
+		scenePass.addColorOutput("normal", &clearGBuffer);
+
+		// Same order as the input_attachment_index in lighting.frag
+		RenderGraphPass& lightingPass = m_renderGraph.addPass(LIGHTING_PASS, RenderGraphPassType::GRAPHICS);
+		lightingPass.addInputAttachment("albedo");
+		lightingPass.addInputAttachment("normal");
+		lightingPass.addInputAttachment("depth");
+		lightingPass.addColorOutput(sceneColor, &clearColor);
+		lightingPass.addStorageRead("clusters");
+		for (const char* shadowMap : SHADOW_MAPS)
+		{
+			lightingPass.addSampledImage(shadowMap);
+		}
+		lightingPass.setRenderArea([this]()
+		{
+			return m_renderExtent;
+		});
+		lightingPass.setRecord([this](VkCommandBuffer commandBuffer)
+		{
+			recordLighting(commandBuffer);
+		});
+	}
+	else
+	{
+		scenePass.addColorOutput(sceneColor, &clearColor);
+		scenePass.addStorageRead("clusters");
+		for (const char* shadowMap : SHADOW_MAPS)
+		{
+			scenePass.addSampledImage(shadowMap);
+		}
+	}
+
+	if (m_useDynamicResolution)
+	{
+		// Covers every pixel, nothing to clear
+		RenderGraphPass& upscalePass = m_renderGraph.addPass(UPSCALE_PASS, RenderGraphPassType::GRAPHICS);
+		upscalePass.addSampledImage(SCENE_COLOR);
+		upscalePass.addColorOutput("backbuffer");
+		upscalePass.setRecord([this](VkCommandBuffer commandBuffer)
+		{
+			recordUpscale(commandBuffer);
+		});
 	}
+
+	m_renderGraph.addOutput("backbuffer");
+	m_renderGraph.compile();
+
+	m_renderPass = m_renderGraph.getRenderPass(SCENE_PASS);
+	m_renderPassHash = m_renderGraph.getRenderPassHash(SCENE_PASS);
 }
 
 void VulkanMain::createCommandPool()
@@ -670,133 +1111,133 @@ void VulkanMain::createCommandPool()
 	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
 	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	commandPoolCreateInfo.queueFamilyIndex = m_queueFamilyIndexes.graphical;
-	commandPoolCreateInfo.flags = 0;
+	// Command buffers are recorded again every time their frame slot comes around
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
 	CALL_VK(vkCreateCommandPool(m_logicalDevice, &commandPoolCreateInfo, nullptr, &m_commandPool));
 }
 
-void VulkanMain::createVertexBuffer()
+void VulkanMain::createStagingRing()
 {
-	VkDeviceSize bufferSize = sizeof(m_vertices[0]) * m_vertices.size();
-
 	VkBuffer stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
 
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+	createBuffer(m_settings.stagingRingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 	             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 	             &stagingBuffer, &stagingBufferMemory);
 
-	void *data;
-	vkMapMemory(m_logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, m_vertices.data(), (size_t) bufferSize);
-	vkUnmapMemory(m_logicalDevice, stagingBufferMemory);
+	m_stagingRing.create(m_logicalDevice, m_queueFamilyIndexes.graphical, m_graphicsQueue, &m_timeline, stagingBuffer, stagingBufferMemory, m_settings.stagingRingSize);
+}
 
+void VulkanMain::createVertexBuffer()
+{
+	VkDeviceSize bufferSize = sizeof(m_vertices[0]) * m_vertices.size();
 
 	createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 	             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 	             &m_vertexBuffer, &m_vertexBufferMemory);
 
-	copyBuffer(stagingBuffer, m_vertexBuffer, bufferSize);
-
-	vkDestroyBuffer(m_logicalDevice, stagingBuffer, nullptr);
-	vkFreeMemory(m_logicalDevice, stagingBufferMemory, nullptr);
+	m_stagingRing.upload(m_vertexBuffer, 0, m_vertices.data(), bufferSize);
 }
 
 void VulkanMain::createIndexBuffer()
 {
 	VkDeviceSize bufferSize = sizeof(m_indexes[0]) * m_indexes.size();
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-	             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-	             &stagingBuffer, &stagingBufferMemory);
-
-	void *data;
-	vkMapMemory(m_logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, m_indexes.data(), (size_t) bufferSize);
-	vkUnmapMemory(m_logicalDevice, stagingBufferMemory);
-
 	createBuffer(bufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 	             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_indexBuffer, &m_indexBufferMemory);
 
-	copyBuffer(stagingBuffer, m_indexBuffer, bufferSize);
-
-	vkDestroyBuffer(m_logicalDevice, stagingBuffer, nullptr);
-	vkFreeMemory(m_logicalDevice, stagingBufferMemory, nullptr);
+	m_stagingRing.upload(m_indexBuffer, 0, m_indexes.data(), bufferSize);
 }
 
 void VulkanMain::createUniformBuffers()
 {
-	VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
 
-	m_uniformBuffers.resize(m_images.size() * 2);
-	m_uniformBuffersMemory.resize(m_uniformBuffers.size());
+	VkBufferUsageFlags usageFlags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	if (m_useBindless)
+	{
+		// Read as a tightly packed std430 array indexed by the object
+		m_uniformStride = sizeof(UniformBufferObject);
+		usageFlags |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	}
+	else
+	{
+		// Every object's UBO starts at a bindable offset
+		VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+		m_uniformStride = (sizeof(UniformBufferObject) + alignment - 1) / alignment * alignment;
+	}
+
+	m_uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	m_uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+	m_uniformBufferMappings.resize(MAX_FRAMES_IN_FLIGHT);
 
 	for (int i = 0; i < m_uniformBuffers.size(); ++i)
 	{
-		createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		createBuffer(m_uniformStride * MAX_OBJECTS, usageFlags,
 		             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 		             &m_uniformBuffers[i], &m_uniformBuffersMemory[i]);
+
+		void* pData;
+		CALL_VK(vkMapMemory(m_logicalDevice, m_uniformBuffersMemory[i], 0, VK_WHOLE_SIZE, 0, &pData));
+		m_uniformBufferMappings[i] = static_cast<uint8_t*>(pData);
 	}
-}
 
-void VulkanMain::createDescriptorPool()
-{
-	VkDescriptorPoolSize descriptorPoolSize = {};
-	descriptorPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	descriptorPoolSize.descriptorCount = (uint32_t) m_uniformBuffers.size();
-
-	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
-	descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	descriptorPoolCreateInfo.poolSizeCount = 1;
-	descriptorPoolCreateInfo.pPoolSizes = &descriptorPoolSize;
-	descriptorPoolCreateInfo.maxSets = (uint32_t) m_uniformBuffers.size();
-	descriptorPoolCreateInfo.flags = 0;
-
-	CALL_VK(vkCreateDescriptorPool(m_logicalDevice, &descriptorPoolCreateInfo, nullptr, &m_descriptorPool));
+	if (m_useBindless)
+	{
+		m_uniformBufferBindlessIndexes.resize(MAX_FRAMES_IN_FLIGHT);
+		for (int i = 0; i < m_uniformBuffers.size(); ++i)
+		{
+			m_uniformBufferBindlessIndexes[i] = m_bindlessTable.addBuffer(m_uniformBuffers[i], 0, VK_WHOLE_SIZE);
+		}
+	}
 }
 
-void VulkanMain::createDescriptorSets()
+void VulkanMain::createLightBuffers()
 {
-	std::vector<VkDescriptorSetLayout> layouts(m_uniformBuffers.size(), m_uboDescriptorSetLayout);
+	m_lightBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	m_lightBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+	m_lightBufferMappings.resize(MAX_FRAMES_IN_FLIGHT);
 
-	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {};
-	descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	descriptorSetAllocateInfo.descriptorPool = m_descriptorPool;
-	descriptorSetAllocateInfo.descriptorSetCount = (uint32_t) layouts.size();
-	descriptorSetAllocateInfo.pSetLayouts = layouts.data();
+	for (int i = 0; i < m_lightBuffers.size(); ++i)
+	{
+		createBuffer(sizeof(LightBufferObject), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		             &m_lightBuffers[i], &m_lightBuffersMemory[i]);
 
-	m_descriptorSets.resize(layouts.size());
-	CALL_VK(vkAllocateDescriptorSets(m_logicalDevice, &descriptorSetAllocateInfo, m_descriptorSets.data()));
+		void* pData;
+		CALL_VK(vkMapMemory(m_logicalDevice, m_lightBuffersMemory[i], 0, VK_WHOLE_SIZE, 0, &pData));
+		m_lightBufferMappings[i] = static_cast<LightBufferObject*>(pData);
+	}
 
-	for (int i = m_descriptorSets.size() - 1; i >= 0; --i)
-	{
-		VkDescriptorBufferInfo descriptorBufferInfo = {};
-		descriptorBufferInfo.buffer = m_uniformBuffers[i];
-		descriptorBufferInfo.offset = 0;
-		descriptorBufferInfo.range = sizeof(UniformBufferObject);
+	// ClusterBuffer in clusters.glsl, the counts and then every cluster's indexes
+	createBuffer(sizeof(uint32_t) * CLUSTER_COUNT * (1 + MAX_LIGHTS_PER_CLUSTER), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_clusterBuffer, &m_clusterBufferMemory);
+}
 
-		VkWriteDescriptorSet descriptorWrite = {};
-		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrite.dstSet = m_descriptorSets[i];
-		descriptorWrite.dstBinding = 0;
-		descriptorWrite.dstArrayElement = 0;
+void VulkanMain::createDescriptorAllocators()
+{
+	m_layoutCache.create(m_logicalDevice);
 
-		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrite.descriptorCount = 1;
-		descriptorWrite.pBufferInfo = &descriptorBufferInfo;
-		descriptorWrite.pImageInfo = nullptr;
-		descriptorWrite.pTexelBufferView = nullptr;
+	m_descriptorUpdateTemplates.create(m_logicalDevice, m_supportsDescriptorUpdateTemplate);
+	m_descriptorCache.create(m_logicalDevice, &m_descriptorUpdateTemplates);
 
-		vkUpdateDescriptorSets(m_logicalDevice, 1, &descriptorWrite, 0, nullptr);
+	m_frameDescriptorAllocators.resize(MAX_FRAMES_IN_FLIGHT);
+	for (DescriptorAllocator& allocator : m_frameDescriptorAllocators)
+	{
+		allocator.create(m_logicalDevice);
+	}
+
+	if (m_useBindless)
+	{
+		m_bindlessTable.create(m_logicalDevice, &m_timeline, m_maxBindlessBuffers, m_maxBindlessImages);
 	}
 }
 
 void VulkanMain::createCommandBuffers()
 {
-	m_commandBuffers.resize(m_framebuffers.size());
+	m_commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 	VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
 	commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	commandBufferAllocateInfo.commandPool = m_commandPool;
@@ -804,191 +1245,323 @@ void VulkanMain::createCommandBuffers()
 	commandBufferAllocateInfo.commandBufferCount = m_commandBuffers.size();
 
 	CALL_VK(vkAllocateCommandBuffers(m_logicalDevice, &commandBufferAllocateInfo, m_commandBuffers.data()));
+}
 
-
+void VulkanMain::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t nObjects)
+{
 	VkCommandBufferBeginInfo commandBufferBeginInfo = {};
 	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	commandBufferBeginInfo.flags = 0;
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 	commandBufferBeginInfo.pInheritanceInfo = nullptr;
 
-	VkRenderPassBeginInfo renderPassBeginInfo = {};
-	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassBeginInfo.renderPass = m_renderPass;
-	renderPassBeginInfo.renderArea.offset = {0, 0};
-	renderPassBeginInfo.renderArea.extent = m_swapchainSupportDetails.extent;
-	VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
-	renderPassBeginInfo.clearValueCount = 1;
-	renderPassBeginInfo.pClearValues = &clearColor;
+	CALL_VK(vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo));
+	m_gpuFrameTimer.begin(commandBuffer, m_currentFrameIndex);
 
+	m_nDrawnObjects = nObjects;
+	m_renderGraph.execute(commandBuffer, imageIndex);
 
-	for (int i = m_commandBuffers.size() - 1; i >= 0; --i)
-	{
-		CALL_VK(vkBeginCommandBuffer(m_commandBuffers[i], &commandBufferBeginInfo));
+	m_gpuFrameTimer.end(commandBuffer, m_currentFrameIndex);
+	CALL_VK(vkEndCommandBuffer(commandBuffer))
+}
 
-		renderPassBeginInfo.framebuffer = m_framebuffers[i];
+void VulkanMain::recordScene(VkCommandBuffer commandBuffer)
+{
+	uint32_t nObjects = m_nDrawnObjects;
 
-		vkCmdBeginRenderPass(m_commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-		vkCmdBindPipeline(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+	// Never missing when shading is deferred, it was compiled up front
+	const Pipeline* pPipeline = m_pipelineManager.requestPipeline(m_trianglePipelineKey, m_renderPass);
+	bool isFallback = pPipeline == nullptr;
+	const Pipeline& pipeline = isFallback ? m_pipelineManager.getPipeline(m_triangleFallbackKey, m_renderPass) : *pPipeline;
 
-		VkBuffer vertexBuffers[] = {m_vertexBuffer};
-		VkDeviceSize offsets[] = {0};
-		vkCmdBindVertexBuffers(m_commandBuffers[i], 0, 1, vertexBuffers, offsets);
-		vkCmdBindIndexBuffer(m_commandBuffers[i], m_indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+	VkViewport viewport = {};
+	viewport.width = (float) m_renderExtent.width;
+	viewport.height = (float) m_renderExtent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
 
-		vkCmdBindDescriptorSets(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSets[(i * 2)], 0, nullptr);
-		vkCmdDrawIndexed(m_commandBuffers[i], (uint32_t) m_indexes.size(), 1, 0, 0, 0);
+	VkRect2D scissor = {};
+	scissor.offset = {0, 0};
+	scissor.extent = m_renderExtent;
 
-		vkCmdBindDescriptorSets(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSets[(i * 2) + 1], 0, nullptr);
-		vkCmdDrawIndexed(m_commandBuffers[i], (uint32_t) m_indexes.size(), 1, 0, 0, 0);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-		vkCmdEndRenderPass(m_commandBuffers[i]);
+	VkBuffer vertexBuffers[] = {m_vertexBuffer};
+	VkDeviceSize offsets[] = {0};
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT16);
 
-		CALL_VK(vkEndCommandBuffer(m_commandBuffers[i]))
+	// The fallback is unlit, its layout has no light set
+	if (!m_settings.deferredShading && !isFallback)
+	{
+		// Stays bound while the objects' sets below change
+		VkDescriptorSet lightSet = allocateLightSet(pipeline, true);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, LIGHT_SET, 1, &lightSet, 0, nullptr);
 	}
-}
 
-void VulkanMain::createSyncObjects()
-{
-	////////////////////////
-	////// SEMAPHORES //////
-	////////////////////////
-
-	m_semaphoresImageAvailable.resize(MAX_FRAMES_IN_FLIGHT);
-	m_semaphoresRenderFinished.resize(MAX_FRAMES_IN_FLIGHT);
+	if (m_useBindless)
+	{
+		// One bind for the whole pass, draws only differ in their push constants
+		m_bindlessTable.bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout);
 
-	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
-	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		DrawConstants drawConstants = {};
+		drawConstants.bufferIndex = m_uniformBufferBindlessIndexes[m_currentFrameIndex];
+		for (uint32_t i = 0; i < nObjects; ++i)
+		{
+			drawConstants.objectIndex = i;
+			vkCmdPushConstants(commandBuffer, pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawConstants), &drawConstants);
+			vkCmdDrawIndexed(commandBuffer, (uint32_t) m_indexes.size(), 1, 0, 0, 0);
+		}
+	}
 
-	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	else
 	{
-		CALL_VK(vkCreateSemaphore(m_logicalDevice, &semaphoreCreateInfo, nullptr, &m_semaphoresImageAvailable[i]));
-		CALL_VK(vkCreateSemaphore(m_logicalDevice, &semaphoreCreateInfo, nullptr, &m_semaphoresRenderFinished[i]));
+		// Written once, the same set comes back every time this slot draws object i
+		m_objectBindings.resize(nObjects);
+		m_objectDescriptorSets.resize(nObjects);
+		for (uint32_t i = 0; i < nObjects; ++i)
+		{
+			m_objectBindings[i] = DescriptorBinding::buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_uniformBuffers[m_currentFrameIndex], i * m_uniformStride, sizeof(UniformBufferObject));
+		}
+		m_descriptorCache.getSets(pipeline.setLayouts[0], 1, m_objectBindings, m_objectDescriptorSets.data());
+
+		for (uint32_t i = 0; i < nObjects; ++i)
+		{
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, 1, &m_objectDescriptorSets[i], 0, nullptr);
+			vkCmdDrawIndexed(commandBuffer, (uint32_t) m_indexes.size(), 1, 0, 0, 0);
+		}
 	}
+}
 
-	////////////////////
-	////// FENCES //////
-	////////////////////
+void VulkanMain::recordLighting(VkCommandBuffer commandBuffer)
+{
+	const Pipeline& pipeline = m_pipelineManager.getPipeline(m_lightingPipelineKey, m_renderGraph.getRenderPass(LIGHTING_PASS));
 
-	m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+	// The attachments change with the swapchain, a transient set per frame is simpler than caching
+	VkDescriptorSet descriptorSet = allocateLightSet(pipeline, true);
 
-	VkFenceCreateInfo fenceCreateInfo = {};
-	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+	// One binding per G-buffer attachment, in the order of lighting.frag
+	std::array<DescriptorBinding, 3> bindings;
+	bindings[0] = DescriptorBinding::image(0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, m_renderGraph.getImageView("albedo"), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_NULL_HANDLE);
+	bindings[1] = DescriptorBinding::image(1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, m_renderGraph.getImageView("normal"), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_NULL_HANDLE);
+	bindings[2] = DescriptorBinding::image(2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, m_renderGraph.getImageView("depth"), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_NULL_HANDLE);
 
-	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
-	{
-		CALL_VK(vkCreateFence(m_logicalDevice, &fenceCreateInfo, nullptr, &m_inFlightFences[i]));
-	}
+	m_descriptorCache.write(descriptorSet, pipeline.setLayouts[LIGHT_SET], bindings.data(), (uint32_t) bindings.size());
+
+	VkViewport viewport = {};
+	viewport.width = (float) m_renderExtent.width;
+	viewport.height = (float) m_renderExtent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
 
-	//// IMAGE FENCES ////
-	m_imagesInFlight.resize(m_images.size(), VK_NULL_HANDLE);
+	VkRect2D scissor = {};
+	scissor.offset = {0, 0};
+	scissor.extent = m_renderExtent;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, LIGHT_SET, 1, &descriptorSet, 0, nullptr);
+
+	// Full screen triangle, each pixel applies the lights of its cluster while the G-buffer is still on chip
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 }
 
-void VulkanMain::createRenderPass()
+void VulkanMain::recordUpscale(VkCommandBuffer commandBuffer)
 {
-	VkAttachmentDescription colorAttachment = {};
-	colorAttachment.format = m_swapchainSupportDetails.surfaceFormat.format;
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentReference colorAttachmentReference = {};
-	colorAttachmentReference.attachment = 0;
-	colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpass = {};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorAttachmentReference;
-
-	VkRenderPassCreateInfo renderPassCreateInfo = {};
-	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassCreateInfo.attachmentCount = 1;
-	renderPassCreateInfo.pAttachments = &colorAttachment;
-	renderPassCreateInfo.subpassCount = 1;
-	renderPassCreateInfo.pSubpasses = &subpass;
-
-	VkSubpassDependency dependency = {};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-	renderPassCreateInfo.dependencyCount = 1;
-	renderPassCreateInfo.pDependencies = &dependency;
-
-	CALL_VK(vkCreateRenderPass(m_logicalDevice, &renderPassCreateInfo, nullptr, &m_renderPass));
+	const Pipeline& pipeline = m_pipelineManager.getPipeline(m_upscalePipelineKey, m_renderGraph.getRenderPass(UPSCALE_PASS));
+	VkDescriptorSetLayout layout = pipeline.setLayouts[UPSCALE_SET];
+	VkDescriptorSet descriptorSet = m_frameDescriptorAllocators[m_currentFrameIndex].allocate(layout);
+
+	DescriptorBinding binding = DescriptorBinding::image(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_renderGraph.getImageView(SCENE_COLOR),
+	                                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_upscaleSampler);
+	m_descriptorCache.write(descriptorSet, layout, &binding, 1);
+
+	VkExtent2D extent = m_swapchainSupportDetails.extent;
+
+	VkViewport viewport = {};
+	viewport.width = (float) extent.width;
+	viewport.height = (float) extent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	VkRect2D scissor = {};
+	scissor.offset = {0, 0};
+	scissor.extent = extent;
+
+	// The scene color has the swapchain's extent, its render area is scaled down from that
+	glm::vec2 imageSize((float) extent.width, (float) extent.height);
+	glm::vec2 renderSize((float) m_renderExtent.width, (float) m_renderExtent.height);
+
+	UpscaleConstants upscaleConstants = {};
+	upscaleConstants.uvPerPixel = renderSize / (imageSize * imageSize);
+	upscaleConstants.maxUv = (renderSize - 0.5f) / imageSize;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, UPSCALE_SET, 1, &descriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipeline.layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(UpscaleConstants), &upscaleConstants);
+
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 }
 
-void VulkanMain::createDescriptorSetLayout()
+void VulkanMain::recordLightClusters(VkCommandBuffer commandBuffer)
 {
-	VkDescriptorSetLayoutBinding uboLayoutBinding = {};
-	uboLayoutBinding.binding = 0;
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboLayoutBinding.descriptorCount = 1;
-	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	uboLayoutBinding.pImmutableSamplers = nullptr;
-
-	VkDescriptorSetLayoutCreateInfo descriptorSetCreateInfo = {};
-	descriptorSetCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	descriptorSetCreateInfo.bindingCount = 1;
-	descriptorSetCreateInfo.pBindings = &uboLayoutBinding;
-
-	CALL_VK(vkCreateDescriptorSetLayout(m_logicalDevice, &descriptorSetCreateInfo, nullptr, &m_uboDescriptorSetLayout));
+	const Pipeline& pipeline = m_pipelineManager.getComputePipeline(CLUSTER_SHADER);
+	VkDescriptorSet descriptorSet = allocateLightSet(pipeline, false);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.layout, LIGHT_SET, 1, &descriptorSet, 0, nullptr);
+
+	// A workgroup covers the tiles of one depth slice
+	vkCmdDispatch(commandBuffer, 1, 1, CLUSTER_Z);
 }
 
+void VulkanMain::recordShadowCascade(VkCommandBuffer commandBuffer, uint32_t cascade)
+{
+	const Pipeline& pipeline = m_pipelineManager.getPipeline(m_shadowPipelineKey, m_renderGraph.getRenderPass(SHADOW_PASSES[cascade]));
+	glm::mat4 viewProjection = m_shadows.getViewProjection(cascade);
 
-void VulkanMain::cleanupSwapChain()
+	VkViewport viewport = {};
+	viewport.width = (float) m_shadows.getMapSize();
+	viewport.height = (float) m_shadows.getMapSize();
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	VkRect2D scissor = {};
+	scissor.offset = {0, 0};
+	scissor.extent = {m_shadows.getMapSize(), m_shadows.getMapSize()};
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	vkCmdSetDepthBias(commandBuffer, SHADOW_DEPTH_BIAS_CONSTANT, 0.0f, SHADOW_DEPTH_BIAS_SLOPE);
+
+	VkBuffer vertexBuffers[] = {m_vertexBuffer};
+	VkDeviceSize offsets[] = {0};
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+
+	// Every object casts, also those the camera doesn't see
+	for (uint32_t i = 0; i < m_nDrawnObjects; ++i)
+	{
+		glm::mat4 modelViewProjection = viewProjection * (*m_pDrawnModels)[i];
+		vkCmdPushConstants(commandBuffer, pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(modelViewProjection), &modelViewProjection);
+		vkCmdDrawIndexed(commandBuffer, (uint32_t) m_indexes.size(), 1, 0, 0, 0);
+	}
+}
+
+VkDescriptorSet VulkanMain::allocateLightSet(const Pipeline& pipeline, bool withShadowMaps)
 {
-	for (VkFramebuffer framebuffer : m_framebuffers)
+	VkDescriptorSetLayout layout = pipeline.setLayouts[LIGHT_SET];
+	VkDescriptorSet descriptorSet = m_frameDescriptorAllocators[m_currentFrameIndex].allocate(layout);
+
+	std::array<DescriptorBinding, 2 + SHADOW_CASCADE_COUNT> bindings;
+	bindings[0] = DescriptorBinding::buffer(LIGHT_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_lightBuffers[m_currentFrameIndex], 0, sizeof(LightBufferObject));
+	bindings[1] = DescriptorBinding::buffer(CLUSTER_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_clusterBuffer, 0, VK_WHOLE_SIZE);
+	for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; ++i)
 	{
-		vkDestroyFramebuffer(m_logicalDevice, framebuffer, nullptr);
+		bindings[2 + i] = DescriptorBinding::image(SHADOW_MAP_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_renderGraph.getImageView(SHADOW_MAPS[i]),
+		                                           VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, m_shadowSampler, i);
 	}
 
-	vkFreeCommandBuffers(m_logicalDevice, m_commandPool, static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
+	// Written every frame, through a template when the device has them
+	m_descriptorCache.write(descriptorSet, layout, bindings.data(), withShadowMaps ? (uint32_t) bindings.size() : 2);
 
-	vkDestroyPipeline(m_logicalDevice, m_graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
-	vkDestroyRenderPass(m_logicalDevice, m_renderPass, nullptr);
+	return descriptorSet;
+}
 
-	for (VkImageView imageView : m_imageViews)
+void VulkanMain::createSamplers()
+{
+	// Hardware PCF: every tap compares against the reference depth before filtering
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(m_physicalDevice, SHADOW_MAP_FORMAT, &formatProperties);
+	VkFilter filter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0 ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+	VkSamplerCreateInfo samplerCreateInfo = {};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = filter;
+	samplerCreateInfo.minFilter = filter;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	// Outside the map counts as lit
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+	samplerCreateInfo.compareEnable = VK_TRUE;
+	samplerCreateInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	samplerCreateInfo.minLod = 0.0f;
+	samplerCreateInfo.maxLod = 0.0f;
+
+	CALL_VK(vkCreateSampler(m_logicalDevice, &samplerCreateInfo, nullptr, &m_shadowSampler));
+
+	// Bilinear, the upscale never reads outside the render area
+	VkSamplerCreateInfo upscaleSamplerCreateInfo = {};
+	upscaleSamplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	upscaleSamplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+	upscaleSamplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+	upscaleSamplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	upscaleSamplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	upscaleSamplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	upscaleSamplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	upscaleSamplerCreateInfo.minLod = 0.0f;
+	upscaleSamplerCreateInfo.maxLod = 0.0f;
+
+	CALL_VK(vkCreateSampler(m_logicalDevice, &upscaleSamplerCreateInfo, nullptr, &m_upscaleSampler));
+}
+
+void VulkanMain::createSyncObjects()
+{
+	////////////////////////
+	////// SEMAPHORES //////
+	////////////////////////
+
+	m_semaphoresImageAvailable.resize(MAX_FRAMES_IN_FLIGHT);
+	m_semaphoresRenderFinished.resize(MAX_FRAMES_IN_FLIGHT);
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 	{
-		vkDestroyImageView(m_logicalDevice, imageView, nullptr);
+		CALL_VK(vkCreateSemaphore(m_logicalDevice, &semaphoreCreateInfo, nullptr, &m_semaphoresImageAvailable[i]));
+		CALL_VK(vkCreateSemaphore(m_logicalDevice, &semaphoreCreateInfo, nullptr, &m_semaphoresRenderFinished[i]));
 	}
 
-	vkDestroySwapchainKHR(m_logicalDevice, m_swapchain, nullptr);
+	// Frame slots and images are tracked through m_timeline, 0 means never submitted
+	m_frameTimelineValues.assign(MAX_FRAMES_IN_FLIGHT, 0);
+}
 
-	for (int i = 0; i < m_uniformBuffers.size(); ++i)
+void VulkanMain::cleanupSwapChain()
+{
+	// Everything below may still be used by frames in flight
+	uint64_t lastUseValue = m_timeline.getLastSubmittedValue();
+
+	// Pipelines still compiling reference the render pass
+	m_pipelineManager.wait();
+	m_renderGraph.reset(lastUseValue);
+
+	for (VkImageView imageView : m_imageViews)
 	{
-		vkDestroyBuffer(m_logicalDevice, m_uniformBuffers[i], nullptr);
-		vkFreeMemory(m_logicalDevice, m_uniformBuffersMemory[i], nullptr);
+		m_deletionQueue.enqueueImageView(imageView, lastUseValue);
 	}
 
-	vkDestroyDescriptorPool(m_logicalDevice, m_descriptorPool, nullptr);
+	m_deletionQueue.enqueueSwapchain(m_swapchain, lastUseValue);
 }
 
 void VulkanMain::recreateSwapChain()
 {
-	vkDeviceWaitIdle(m_logicalDevice);
+	// The old objects go through the deletion queue, no need to idle the GPU.
+	// The retired swapchain is handed to the new one and destroyed with the rest.
+	VkSwapchainKHR oldSwapchain = m_swapchain;
 
 	cleanupSwapChain();
-	createSwapChain();
+	createSwapChain(oldSwapchain);
 	m_imageViews = createImageViews(m_logicalDevice, m_images, m_swapchainSupportDetails);
-	createRenderPass();
-	createGraphicsPipeline("triangle.vert.spv", "triangle.frag.spv");
-
-	createFramebuffers();
-	createUniformBuffers();
-	createDescriptorPool();
-	createDescriptorSets();
-
-	createCommandBuffers();
+	createRenderGraph();
+	updatePipelineTargets();
 }
 
 bool VulkanMain::isDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR surfaceHandle)
@@ -1029,6 +1602,107 @@ bool VulkanMain::isDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR
 	return isPhysicalDeviceSuitable;
 }
 
+bool VulkanMain::isInstanceExtensionSupported(const char* extensionName)
+{
+	uint32_t extensionCount;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> extensionProperties(extensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensionProperties.data());
+
+	for (VkExtensionProperties& ep : extensionProperties)
+	{
+		if (strcmp(ep.extensionName, extensionName) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool VulkanMain::isDeviceExtensionSupported(VkPhysicalDevice physicalDevice, const char* extensionName)
+{
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> extensionProperties(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensionProperties.data());
+
+	for (VkExtensionProperties& ep : extensionProperties)
+	{
+		if (strcmp(ep.extensionName, extensionName) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool VulkanMain::isBindlessSupported(VkPhysicalDevice physicalDevice)
+{
+#ifdef VK_EXT_descriptor_indexing
+	if (!m_supportsPhysicalDeviceProperties2 ||
+	    !isDeviceExtensionSupported(physicalDevice, VK_KHR_MAINTENANCE3_EXTENSION_NAME) ||
+	    !isDeviceExtensionSupported(physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+	{
+		return false;
+	}
+
+	// The shader is optional in the bundle, older builds only ship triangle.vert
+	if (!m_shaderBundle.exists(BINDLESS_VERTEX_SHADER))
+	{
+		return false;
+	}
+
+	PFN_vkGetPhysicalDeviceFeatures2KHR pfnGetFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR) vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceFeatures2KHR");
+	PFN_vkGetPhysicalDeviceProperties2KHR pfnGetProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR) vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceProperties2KHR");
+	if (pfnGetFeatures2 == nullptr || pfnGetProperties2 == nullptr)
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+	VkPhysicalDeviceFeatures2KHR features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+	features.pNext = &indexingFeatures;
+	pfnGetFeatures2(physicalDevice, &features);
+
+	if (!indexingFeatures.runtimeDescriptorArray ||
+	    !indexingFeatures.descriptorBindingPartiallyBound ||
+	    !indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind ||
+	    !indexingFeatures.descriptorBindingSampledImageUpdateAfterBind)
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = {};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+	VkPhysicalDeviceProperties2KHR properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+	properties.pNext = &indexingProperties;
+	pfnGetProperties2(physicalDevice, &properties);
+
+	m_maxBindlessBuffers = std::min({MAX_BINDLESS_BUFFERS,
+	                                 indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+	                                 indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers});
+	m_maxBindlessImages = std::min({MAX_BINDLESS_IMAGES,
+	                                indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+	                                indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+	                                indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+	                                indexingProperties.maxDescriptorSetUpdateAfterBindSamplers});
+
+	// Every frame slot's buffer needs a slot
+	return m_maxBindlessBuffers >= MAX_FRAMES_IN_FLIGHT && m_maxBindlessImages > 0;
+#else
+	return false;
+#endif // VK_EXT_descriptor_indexing
+}
+
 QueueFamilyIndexes VulkanMain::getQueueFamilyIndexes(VkPhysicalDevice physicalDevice)
 {
 	QueueFamilyIndexes familyIndexes = {0, 0};
@@ -1280,68 +1954,6 @@ void VulkanMain::createBuffer(VkDeviceSize size, VkBufferUsageFlags usageFlags,
 	vkBindBufferMemory(m_logicalDevice, *buffer, *bufferMemory, 0);
 }
 
-void VulkanMain::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
-{
-	VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
-	commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	commandBufferAllocateInfo.commandPool = m_commandPool;
-	commandBufferAllocateInfo.commandBufferCount = 1;
-
-	VkCommandBuffer transferCommandBuffer;
-	vkAllocateCommandBuffers(m_logicalDevice, &commandBufferAllocateInfo, &transferCommandBuffer);
-
-	VkCommandBufferBeginInfo commandBufferBeginInfo = {};
-	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-	vkBeginCommandBuffer(transferCommandBuffer, &commandBufferBeginInfo);
-
-	VkBufferCopy copyRegion = {};
-	copyRegion.srcOffset = 0;
-	copyRegion.dstOffset = 0;
-	copyRegion.size = size;
-	vkCmdCopyBuffer(transferCommandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-	vkEndCommandBuffer(transferCommandBuffer);
-
-	VkSubmitInfo queueSubmitInfo = {};
-	queueSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	queueSubmitInfo.commandBufferCount = 1;
-	queueSubmitInfo.pCommandBuffers = &transferCommandBuffer;
-
-	vkQueueSubmit(m_graphicsQueue, 1, &queueSubmitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(m_graphicsQueue);
-
-	vkFreeCommandBuffers(m_logicalDevice, m_commandPool, 1, &transferCommandBuffer);
-}
-
-VkShaderModule VulkanMain::createShaderModule(const char *shaderPath)
-{
-	std::vector<char> shaderData = FileReader::readData(shaderPath);
-
-	VkShaderModuleCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = shaderData.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t *>(shaderData.data());
-
-	VkShaderModule shaderModule;
-	CALL_VK(vkCreateShaderModule(m_logicalDevice, &createInfo, nullptr, &shaderModule));
-	return shaderModule;
-}
-
-
-VkPipelineShaderStageCreateInfo VulkanMain::getCreateShaderPipelineInfo(VkShaderModule shaderModule, VkShaderStageFlagBits shaderStage)
-{
-	VkPipelineShaderStageCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	createInfo.stage = shaderStage;
-	createInfo.module = shaderModule;
-	createInfo.pName = "main";
-
-	return createInfo;
-}
-
 VkFormat VulkanMain::findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags featureFlags)
 {
 	for (VkFormat format : candidates)
@@ -1356,15 +1968,16 @@ VkFormat VulkanMain::findSupportedFormat(const std::vector<VkFormat> &candidates
 		{
 			return format;
 		}
-
-		__android_log_assert("Failed to find supported format.", nullptr, nullptr);
 	}
+
+	__android_log_assert("Failed to find supported format.", nullptr, nullptr);
 }
 
 VkFormat VulkanMain::findDepthFormat()
 {
 	return findSupportedFormat(
-			{VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT},
+			// Reverse-Z only pays off with floating point depth
+			{VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
 			VK_IMAGE_TILING_OPTIMAL,
 			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
 	);
@@ -1373,4 +1986,18 @@ VkFormat VulkanMain::findDepthFormat()
 bool VulkanMain::hasStencilComponent(VkFormat format)
 {
 	return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
+}
+
+bool VulkanMain::isSrgbFormat(VkFormat format)
+{
+	switch (format)
+	{
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+		case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+			return true;
+
+		default:
+			return false;
+	}
 }
\ No newline at end of file
@@ -8,10 +8,67 @@
 #include "vulkan_wrapper.h"
 #include <android_native_app_glue.h>
 
-#include "camera/FocusedCamera.h"
+#include "FrameState.h"
+#include "memory/StagingRing.h"
+#include "memory/DeletionQueue.h"
+#include "descriptors/DescriptorAllocator.h"
+#include "descriptors/DescriptorCache.h"
+#include "descriptors/BindlessTable.h"
+#include "pipeline/LayoutCache.h"
+#include "pipeline/ShaderBundle.h"
+#include "pipeline/ShaderCache.h"
+#include "pipeline/PipelineManager.h"
+#include "graph/RenderGraph.h"
+#include "shadows/CascadedShadows.h"
+#include "sync/GpuTimeline.h"
+#include "sync/GpuFrameTimer.h"
+#include "sync/RenderScaleController.h"
+#include "sync/FramesInFlightController.h"
+#include "sync/FramePacer.h"
 
 #include <vector>
 #include <array>
+#include <chrono>
+
+struct RendererSettings
+{
+	VkDeviceSize stagingRingSize = 4 * 1024 * 1024;
+
+	// Track GPU progress with VK_KHR_timeline_semaphore when the device has it
+	bool preferTimelineSemaphore = true;
+
+	// Starting value, adjusted from the GPU wait time in draw() when adaptive
+	uint32_t framesInFlight = 2;
+	bool adaptiveFramesInFlight = true;
+
+	// Delay frame starts until just before the GPU / display can take them
+	bool lowLatencyPacing = false;
+
+	// Depth cleared to 0 and tested with GREATER_OR_EQUAL, for the reverse-Z
+	// projection of Camera. Has to match the camera's setReverseDepth().
+	bool reverseDepth = true;
+
+	// One bindless descriptor set indexed from push constants, when the device
+	// has VK_EXT_descriptor_indexing. Falls back to a set per draw otherwise.
+	bool preferBindless = true;
+
+	// G-buffer and lighting as two subpasses of one render pass, the G-buffer
+	// then never leaves tile memory. Forward shading otherwise, both read the
+	// lights from the same clusters.
+	bool deferredShading = true;
+
+	// Resolution of each sun shadow cascade, and how far from the camera
+	// shadows are drawn at all
+	uint32_t shadowMapSize = 1024;
+	float shadowDistance = 10.0f;
+
+	// Scene rendered offscreen at a share of the swapchain resolution and
+	// upscaled, the share follows the GPU frame time when the device has
+	// timestamps. The budget leaves some headroom under 60 Hz.
+	bool dynamicResolution = true;
+	float gpuFrameBudget = 0.014f;
+	float minRenderScale = 0.5f;
+};
 
 struct QueueFamilyIndexes
 {
@@ -34,6 +91,38 @@ struct UniformBufferObject {
 	alignas(16) glm::mat4 projection;
 };
 
+// Lights of a frame beyond this are dropped
+const uint32_t MAX_LIGHTS = 512;
+
+// Cluster grid in clusters.glsl: screen tiles times depth slices. A cluster
+// keeps the first MAX_LIGHTS_PER_CLUSTER lights that reach into it.
+const uint32_t CLUSTER_X = 16;
+const uint32_t CLUSTER_Y = 8;
+const uint32_t CLUSTER_Z = 24;
+const uint32_t CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+const uint32_t MAX_LIGHTS_PER_CLUSTER = 64;
+
+struct PointLightData
+{
+	// View space position and radius
+	glm::vec4 positionRadius;
+	glm::vec4 color;
+};
+
+// LightBuffer in clusters.glsl, std430
+struct LightBufferObject
+{
+	alignas(16) glm::mat4 inverseProjection;
+	// View space to the texture coordinates and depth of each cascade
+	alignas(16) glm::mat4 shadowMatrices[SHADOW_CASCADE_COUNT];
+	// View space, towards the sun
+	alignas(16) glm::vec4 sunDirection;
+	alignas(16) glm::vec4 sunColor;
+	alignas(16) glm::vec2 viewportSize;
+	uint32_t lightCount;
+	alignas(16) PointLightData lights[MAX_LIGHTS];
+};
+
 struct Vertex
 {
 	glm::vec3 position;
@@ -48,36 +137,25 @@ struct Vertex
 
 		return bindingDescription;
 	}
-
-	static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions()
-	{
-		std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions = {};
-
-		// POSITION
-		attributeDescriptions[0].binding = 0;
-		attributeDescriptions[0].location = 0;
-		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[0].offset = offsetof(Vertex, position);
-
-		// COLOR
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-		return attributeDescriptions;
-	}
 };
 
 class VulkanMain
 {
 public:
-	VulkanMain();
+	// Pipelines are compiled on pJobSystem's workers when given
+	VulkanMain(const RendererSettings& settings = RendererSettings(), JobSystem* pJobSystem = nullptr);
 
 	void init(android_app* pApp);
 	void destroy();
 
-	void draw();
+	// Called from the render thread only once init() returned
+	void draw(const FrameState& frameState);
+
+	void setFramesInFlight(uint32_t framesInFlight, bool isAdaptive);
+
+	// How long the main loop should keep handling events before calling draw()
+	float getTimeUntilNextFrame() const;
+	float getFrameInterval() const;
 
 	bool m_isReady = false;
 
@@ -85,35 +163,56 @@ private:
 	void createInstance();
 	void createSurface();
 	void createDevice();
-	void createSwapChain();
+	void createSwapChain(VkSwapchainKHR oldSwapchain);
 
 	std::vector<VkImageView> createImageViews(VkDevice logicalDevice, std::vector<VkImage>& images, SwapChainSupportDetails& swapchainSupportDetails) const;
-	void createGraphicsPipeline(const char* vertexPath, const char* fragmentPath);
+	void createPipelines();
+	// Points the pipeline keys at the current render pass and swapchain format
+	void updatePipelineTargets();
 
-	void createRenderPass();
-	void createDescriptorSetLayout();
+	// The frame's passes and their attachments, once per swapchain
+	void createRenderGraph();
 
-	void createFramebuffers();
 	void createCommandPool();
+	void createStagingRing();
 
 	void createVertexBuffer();
 	void createIndexBuffer();
 	void createUniformBuffers();
-
-	void createDescriptorPool();
-	void createDescriptorSets();
+	// The lights of every frame slot and the clusters they are binned into
+	void createLightBuffers();
+	void createDescriptorAllocators();
 
 	void createCommandBuffers();
+	void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t nObjects);
+	// Inside the graph's scene pass, which fills the G-buffer when shading is deferred
+	void recordScene(VkCommandBuffer commandBuffer);
+	void recordLighting(VkCommandBuffer commandBuffer);
+	void recordLightClusters(VkCommandBuffer commandBuffer);
+	// Depth of the drawn objects from the sun, when the cascade is scheduled
+	void recordShadowCascade(VkCommandBuffer commandBuffer, uint32_t cascade);
+	// Transient set with the frame's lights and the clusters, for pipelines reading
+	// them. The shading ones also get the shadow maps.
+	VkDescriptorSet allocateLightSet(const Pipeline& pipeline, bool withShadowMaps);
+	// Filters the scene's render area up to the whole swapchain image
+	void recordUpscale(VkCommandBuffer commandBuffer);
+	void createSamplers();
 	void createSyncObjects();
 
 
 	void cleanupSwapChain();
 	void recreateSwapChain();
 
+	void readPresentationTiming();
+
 private:
 	// DEVICE
 	bool isDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR surfaceHandle);
 
+	bool isInstanceExtensionSupported(const char* extensionName);
+	bool isDeviceExtensionSupported(VkPhysicalDevice physicalDevice, const char* extensionName);
+	bool isBindlessSupported(VkPhysicalDevice physicalDevice);
+
 	// QUEUES
 	QueueFamilyIndexes getQueueFamilyIndexes(VkPhysicalDevice physicalDevice);
 
@@ -137,29 +236,28 @@ private:
 	uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t memoryTypeFilter, VkMemoryPropertyFlags memoryPropertyFlags);
 	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkBuffer* buffer, VkDeviceMemory* bufferMemory);
 
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-
-
-	VkShaderModule createShaderModule(const char* shaderPath);
-
-	VkPipelineShaderStageCreateInfo getCreateShaderPipelineInfo(VkShaderModule shaderModule, VkShaderStageFlagBits shaderStage);
 
 	VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags featureFlags);
 	VkFormat findDepthFormat();
 	bool hasStencilComponent(VkFormat format);
+	bool isSrgbFormat(VkFormat format);
 
 
 
 private:
 	android_app* m_pApp;
+	RendererSettings m_settings;
+	JobSystem* m_pJobSystem;
 
-	FocusedCamera m_camera;
 	VkSurfaceKHR m_surface;
 
 	VkInstance m_instance;
+	bool m_supportsPhysicalDeviceProperties2;
 
 	VkPhysicalDevice m_physicalDevice;
 	VkDevice m_logicalDevice;
+	bool m_supportsTimelineSemaphore;
+	bool m_supportsDescriptorUpdateTemplate;
 
 	QueueFamilyIndexes m_queueFamilyIndexes;
 
@@ -172,11 +270,24 @@ private:
 	std::vector<VkImage> m_images;
 	std::vector<VkImageView> m_imageViews;
 
-	VkRenderPass m_renderPass;
-	VkPipeline m_graphicsPipeline;
-	VkPipelineLayout m_pipelineLayout;
+	VkFormat m_depthFormat;
 
-	std::vector<VkFramebuffer> m_framebuffers;
+	RenderGraph m_renderGraph;
+	// Of the scene pass, owned by the graph
+	VkRenderPass m_renderPass;
+	uint64_t m_renderPassHash;
+	uint32_t m_nDrawnObjects;
+
+	// Read once, outlives the device
+	ShaderBundle m_shaderBundle;
+	ShaderCache m_shaderCache;
+	PipelineManager m_pipelineManager;
+	PipelineKey m_trianglePipelineKey;
+	// Unlit and compiled up front, forward shading draws with it until the requested pipeline is ready
+	PipelineKey m_triangleFallbackKey;
+	PipelineKey m_lightingPipelineKey;
+	PipelineKey m_shadowPipelineKey;
+	PipelineKey m_upscalePipelineKey;
 
 	VkCommandPool m_commandPool;
 	std::vector<VkCommandBuffer> m_commandBuffers;
@@ -184,13 +295,34 @@ private:
 	std::vector<VkSemaphore> m_semaphoresImageAvailable;
 	std::vector<VkSemaphore> m_semaphoresRenderFinished;
 
-	std::vector<VkFence> m_inFlightFences;
-	std::vector<VkFence> m_imagesInFlight;
+	GpuTimeline m_timeline;
+	DeletionQueue m_deletionQueue;
+	std::vector<uint64_t> m_frameTimelineValues;
+	std::vector<uint64_t> m_imageTimelineValues;
+
+	FramesInFlightController m_framesInFlightController;
+	std::chrono::steady_clock::time_point m_lastFrameStart;
 
 	uint32_t m_currentFrameIndex;
+
+	GpuFrameTimer m_gpuFrameTimer;
+	RenderScaleController m_renderScaleController;
+	bool m_useDynamicResolution;
+	// Part of the scene's attachments drawn this frame, the swapchain extent without dynamic resolution
+	VkExtent2D m_renderExtent;
+	VkSampler m_upscaleSampler;
+
+	FramePacer m_framePacer;
+	bool m_supportsDisplayTiming;
+	uint32_t m_presentId;
+	PFN_vkGetRefreshCycleDurationGOOGLE m_pfnGetRefreshCycleDuration;
+	PFN_vkGetPastPresentationTimingGOOGLE m_pfnGetPastPresentationTiming;
 	bool m_framebufferResized;
 
 
+	StagingRing m_stagingRing;
+
+
 	std::vector<Vertex> m_vertices;
 	std::vector<uint16_t> m_indexes;
 
@@ -201,12 +333,43 @@ private:
 	VkDeviceMemory m_indexBufferMemory;
 
 
-	VkDescriptorSetLayout m_uboDescriptorSetLayout;
-	VkDescriptorPool m_descriptorPool;
-	std::vector<VkDescriptorSet> m_descriptorSets;
-
+	// Set layouts and pipeline layouts reflected from the shaders
+	LayoutCache m_layoutCache;
+	DescriptorUpdateTemplates m_descriptorUpdateTemplates;
+	DescriptorCache m_descriptorCache;
+	// Transient sets, reset when their frame slot is reused
+	std::vector<DescriptorAllocator> m_frameDescriptorAllocators;
+	// Packed bindings of every object's set, reused between frames
+	std::vector<DescriptorBinding> m_objectBindings;
+	std::vector<VkDescriptorSet> m_objectDescriptorSets;
+
+	bool m_useBindless;
+	uint32_t m_maxBindlessBuffers;
+	uint32_t m_maxBindlessImages;
+	BindlessTable m_bindlessTable;
+	// Table index of each frame slot's uniform buffer
+	std::vector<uint32_t> m_uniformBufferBindlessIndexes;
+
+	// One persistently mapped buffer per frame slot, one UBO per object
 	std::vector<VkBuffer> m_uniformBuffers;
 	std::vector<VkDeviceMemory> m_uniformBuffersMemory;
+	std::vector<uint8_t*> m_uniformBufferMappings;
+	VkDeviceSize m_uniformStride;
+
+	// Per frame slot as well, binned by the cluster pass and read when shading
+	std::vector<VkBuffer> m_lightBuffers;
+	std::vector<VkDeviceMemory> m_lightBuffersMemory;
+	std::vector<LightBufferObject*> m_lightBufferMappings;
+
+	// Written on the GPU every frame, the graph orders the frames' accesses
+	VkBuffer m_clusterBuffer;
+	VkDeviceMemory m_clusterBufferMemory;
+
+	// Maps are images of the graph, rendered only when update() schedules them
+	CascadedShadows m_shadows;
+	VkSampler m_shadowSampler;
+	// Casters of the frame being recorded
+	const std::vector<glm::mat4>* m_pDrawnModels;
 
 #ifndef NDEBUG
 	VkDebugUtilsMessengerEXT m_debugMessenger = VK_NULL_HANDLE;
@@ -1,5 +1,26 @@
 #include "Camera.h"
 
+#include <math.h>
+#include <algorithm>
+
+const float NEAR_PLANE = 0.01f;
+const float FAR_PLANE = 1000.0f;
+
+// Vulkan clip space has Y pointing down, the flip is part of the projection
+static glm::mat4 getReverseInfiniteProjection(float fovy, float aspect, float nearPlane)
+{
+	float focalLength = 1.0f / tanf(fovy * 0.5f);
+
+	// depth = nearPlane / -z: 1 on the near plane, towards 0 at infinity
+	glm::mat4 projection(0.0f);
+	projection[0][0] = focalLength / aspect;
+	projection[1][1] = -focalLength;
+	projection[2][3] = -1.0f;
+	projection[3][2] = nearPlane;
+
+	return projection;
+}
+
 Camera::Camera(
 	float width,
 	float height,
@@ -7,12 +28,117 @@ Camera::Camera(
 	const glm::vec3& eye,
 	const glm::vec3& center
 	) :
-	m_projection(glm::perspective(fovy, width / height, 0.01f, 1000.0f))
+	m_fovy(fovy),
+	m_aspect(width / height),
+	m_isReverseDepth(true),
+	m_isProjectionDirty(true),
+	m_isViewDirty(true),
+	m_isViewProjectionDirty(true),
+	m_areFrustumPlanesDirty(true)
 {
 	setCoordinates(eye, center);
 }
 
+const glm::mat4& Camera::getProjection()
+{
+	if (m_isProjectionDirty)
+	{
+		if (m_isReverseDepth)
+		{
+			m_projection = getReverseInfiniteProjection(m_fovy, m_aspect, NEAR_PLANE);
+		}
+		else
+		{
+			m_projection = glm::perspective(m_fovy, m_aspect, NEAR_PLANE, FAR_PLANE);
+			m_projection[1][1] *= -1;
+		}
+		m_isProjectionDirty = false;
+	}
+
+	return m_projection;
+}
+
+const glm::mat4& Camera::getView()
+{
+	if (m_isViewDirty)
+	{
+		// Inverse of the camera transform: rotate back, then move the eye to the origin
+		m_view = glm::mat4_cast(glm::conjugate(m_orientation)) * glm::translate(glm::mat4(1), -m_eye);
+		m_isViewDirty = false;
+	}
+
+	return m_view;
+}
+
+const glm::mat4& Camera::getViewProjection()
+{
+	if (m_isViewProjectionDirty)
+	{
+		m_viewProjection = getProjection() * getView();
+		m_isViewProjectionDirty = false;
+		m_areFrustumPlanesDirty = true;
+	}
+
+	return m_viewProjection;
+}
+
+const std::array<glm::vec4, 6>& Camera::getFrustumPlanes()
+{
+	const glm::mat4& viewProjection = getViewProjection();
+	if (m_areFrustumPlanesDirty)
+	{
+		// Gribb / Hartmann, rows of the matrix with a [0, 1] depth range
+		glm::mat4 rows = glm::transpose(viewProjection);
+
+		m_frustumPlanes[0] = rows[3] + rows[0];
+		m_frustumPlanes[1] = rows[3] - rows[0];
+		m_frustumPlanes[2] = rows[3] + rows[1];
+		m_frustumPlanes[3] = rows[3] - rows[1];
+		m_frustumPlanes[4] = rows[2];
+		m_frustumPlanes[5] = rows[3] - rows[2];
+
+		if (m_isReverseDepth)
+		{
+			std::swap(m_frustumPlanes[4], m_frustumPlanes[5]);
+		}
+
+		for (glm::vec4& plane : m_frustumPlanes)
+		{
+			float length = glm::length(glm::vec3(plane));
+
+			// No normal: the plane at infinity
+			plane = length > 0.0f ? plane / length : glm::vec4(0, 0, 0, 1);
+		}
+
+		m_areFrustumPlanesDirty = false;
+	}
+
+	return m_frustumPlanes;
+}
+
+void Camera::setSize(float width, float height)
+{
+	m_aspect = width / height;
+	m_isProjectionDirty = true;
+	m_isViewProjectionDirty = true;
+}
+
+void Camera::setReverseDepth(bool isReverseDepth)
+{
+	m_isReverseDepth = isReverseDepth;
+	m_isProjectionDirty = true;
+	m_isViewProjectionDirty = true;
+}
+
 void Camera::setCoordinates(const glm::vec3& eye, const glm::vec3& center)
 {
-	m_view = glm::lookAt(eye, center, { 0, 1, 0 });
+	setPose(eye, glm::quatLookAt(glm::normalize(center - eye), { 0, 1, 0 }));
+}
+
+void Camera::setPose(const glm::vec3& eye, const glm::quat& orientation)
+{
+	m_eye = eye;
+	m_orientation = orientation;
+	m_isViewDirty = true;
+	m_isViewProjectionDirty = true;
 }
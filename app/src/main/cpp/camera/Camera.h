@@ -4,7 +4,14 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
+#include <array>
+
+/*
+ * Position and orientation are cheap to change, the matrices derived from them
+ * are only rebuilt when read, at most once per frame.
+ */
 class Camera
 {
 public:
@@ -16,19 +23,41 @@ public:
 		const glm::vec3& center = { 0, 0, 0 }
 	);
 
-	glm::mat4& getProjection()
-	{
-		return m_projection;
-	}
+	const glm::mat4& getProjection();
+	const glm::mat4& getView();
+	const glm::mat4& getViewProjection();
+
+	// Left, right, bottom, top (in clip space), near, far; normalized, pointing
+	// inside. The far plane of an infinite projection lets everything through.
+	const std::array<glm::vec4, 6>& getFrustumPlanes();
 
-	glm::mat4& getView()
-	{
-		return m_view;
-	}
+	void setSize(float width, float height);
 
+	// Reverse-Z with the far plane at infinity (default), or a classic [near, far] range.
+	// The depth test of the renderer has to match.
+	void setReverseDepth(bool isReverseDepth);
 	void setCoordinates(const glm::vec3& eye, const glm::vec3& center);
 
 protected:
+	void setPose(const glm::vec3& eye, const glm::quat& orientation);
+
+protected:
+	glm::vec3 m_eye;
+	// Camera to world, the camera looks down its -Z
+	glm::quat m_orientation;
+
+	float m_fovy;
+	float m_aspect;
+	bool m_isReverseDepth;
+
+private:
+	bool m_isProjectionDirty;
+	bool m_isViewDirty;
+	bool m_isViewProjectionDirty;
+	bool m_areFrustumPlanesDirty;
+
 	glm::mat4 m_projection;
 	glm::mat4 m_view;
+	glm::mat4 m_viewProjection;
+	std::array<glm::vec4, 6> m_frustumPlanes;
 };
@@ -1,7 +1,9 @@
-
 #include "FocusedCamera.h"
 #include <math.h>
 
+// Keeps the orbit from going over the top
+const float MAX_ELEVATION = glm::half_pi<float>() - 0.01f;
+
 FocusedCamera::FocusedCamera(
 	float width,
 	float height,
@@ -11,37 +13,36 @@ FocusedCamera::FocusedCamera(
 	float alpha,
 	float radius
 ) :
-	m_radius(radius),
-	m_theta(theta),
-	m_alpha(alpha),
-	m_center(center),
-	m_fovy(fovy),
+	Camera(width, height, fovy, getEye(center, theta, alpha, radius), center),
 
-	Camera(width, height, fovy, getEye(center, theta, alpha, radius), center)
+	m_radius(radius),
+	m_elevation(glm::half_pi<float>() - theta),
+	m_center(center)
 {
 }
 
 void FocusedCamera::setCenter(const glm::vec3& center)
 {
 	m_center = center;
-	setCoordinates(getEye(center, m_theta, m_alpha, m_radius), center);
+	setPose(m_center + m_orientation * glm::vec3(0, 0, m_radius), m_orientation);
 }
 
 void FocusedCamera::rotate(float x, float y)
 {
-	m_theta -= y;
-	m_alpha += x;
+	float elevation = glm::clamp(m_elevation + y, -MAX_ELEVATION, MAX_ELEVATION);
+	y = elevation - m_elevation;
+	m_elevation = elevation;
+
+	// Yaw around the world up, pitch around the camera's own right axis
+	glm::quat yaw = glm::angleAxis(-x, glm::vec3(0, 1, 0));
+	glm::quat pitch = glm::angleAxis(-y, glm::vec3(1, 0, 0));
+	m_orientation = glm::normalize(yaw * m_orientation * pitch);
 
 	setCenter(m_center);
 }
 
-const glm::vec3 FocusedCamera::getEye(const glm::vec3& center, float theta, float alpha, float radius)
+glm::vec3 FocusedCamera::getEye(const glm::vec3& center, float theta, float alpha, float radius)
 {
 	glm::vec3 distance = glm::vec3(radius * sinf(theta) * cosf(alpha), radius * cosf(theta), radius * sinf(theta) * sinf(alpha));
 	return center + distance;
 }
-
-void FocusedCamera::setSize(float width, float height)
-{
-	m_projection = glm::perspective(m_fovy, width / height, 0.01f, 1000.0f);
-}
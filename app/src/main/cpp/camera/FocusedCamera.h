@@ -1,5 +1,9 @@
 #include "Camera.h"
 
+/*
+ * Orbits around a center. Rotations are accumulated into the orientation
+ * quaternion, the eye follows from it without any trigonometry per update.
+ */
 class FocusedCamera : public Camera
 {
 public:
@@ -13,20 +17,18 @@ public:
 		float radius = 3
 	);
 
-	void setSize(float width, float height);
 	void setCenter(const glm::vec3& center);
 	void rotate(float x, float y);
 
 private:
 	
-	const glm::vec3 getEye(const glm::vec3& center, float theta, float alpha, float radius);
+	static glm::vec3 getEye(const glm::vec3& center, float theta, float alpha, float radius);
 
 private:
 	float m_radius;
-	float m_fovy;
 
-	float m_theta;
-	float m_alpha;
+	// Angle above the horizon, clamped short of the poles
+	float m_elevation;
 
 	glm::vec3 m_center;
 };
@@ -0,0 +1,185 @@
+#include "BindlessTable.h"
+
+#include <array>
+
+void BindlessTable::SlotAllocator::reset(uint32_t capacity)
+{
+	m_capacity = capacity;
+	m_nextUnused = 0;
+	m_freeSlots.clear();
+	m_retiredSlots.clear();
+}
+
+uint32_t BindlessTable::SlotAllocator::allocate(GpuTimeline* pTimeline)
+{
+	// Retired in submission order, stop at the first one still in use
+	while (!m_retiredSlots.empty() && pTimeline->isComplete(m_retiredSlots.front().lastUseValue))
+	{
+		m_freeSlots.push_back(m_retiredSlots.front().index);
+		m_retiredSlots.pop_front();
+	}
+
+	if (!m_freeSlots.empty())
+	{
+		uint32_t index = m_freeSlots.back();
+		m_freeSlots.pop_back();
+		return index;
+	}
+
+	if (m_nextUnused == m_capacity)
+	{
+		__android_log_assert("Bindless table is full.", nullptr, nullptr);
+	}
+
+	return m_nextUnused++;
+}
+
+void BindlessTable::SlotAllocator::release(uint32_t index, uint64_t lastUseValue)
+{
+	m_retiredSlots.push_back({index, lastUseValue});
+}
+
+BindlessTable::BindlessTable() :
+		m_logicalDevice(VK_NULL_HANDLE),
+		m_pTimeline(nullptr),
+		m_layout(VK_NULL_HANDLE),
+		m_pool(VK_NULL_HANDLE),
+		m_set(VK_NULL_HANDLE)
+{
+}
+
+void BindlessTable::create(VkDevice logicalDevice, GpuTimeline* pTimeline, uint32_t maxBuffers, uint32_t maxImages)
+{
+	m_logicalDevice = logicalDevice;
+	m_pTimeline = pTimeline;
+
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings = {};
+	bindings[BUFFER_BINDING].binding = BUFFER_BINDING;
+	bindings[BUFFER_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[BUFFER_BINDING].descriptorCount = maxBuffers;
+	bindings[BUFFER_BINDING].stageFlags = VK_SHADER_STAGE_ALL;
+
+	bindings[IMAGE_BINDING].binding = IMAGE_BINDING;
+	bindings[IMAGE_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[IMAGE_BINDING].descriptorCount = maxImages;
+	bindings[IMAGE_BINDING].stageFlags = VK_SHADER_STAGE_ALL;
+
+	std::array<VkDescriptorBindingFlagsEXT, 2> bindingFlags = {
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT,
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT
+	};
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsCreateInfo = {};
+	bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	bindingFlagsCreateInfo.bindingCount = (uint32_t) bindingFlags.size();
+	bindingFlagsCreateInfo.pBindingFlags = bindingFlags.data();
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+	layoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	layoutCreateInfo.bindingCount = (uint32_t) bindings.size();
+	layoutCreateInfo.pBindings = bindings.data();
+
+	CALL_VK(vkCreateDescriptorSetLayout(m_logicalDevice, &layoutCreateInfo, nullptr, &m_layout));
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[0].descriptorCount = maxBuffers;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[1].descriptorCount = maxImages;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	poolCreateInfo.maxSets = 1;
+	poolCreateInfo.poolSizeCount = (uint32_t) poolSizes.size();
+	poolCreateInfo.pPoolSizes = poolSizes.data();
+
+	CALL_VK(vkCreateDescriptorPool(m_logicalDevice, &poolCreateInfo, nullptr, &m_pool));
+
+	VkDescriptorSetAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = m_pool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &m_layout;
+
+	CALL_VK(vkAllocateDescriptorSets(m_logicalDevice, &allocateInfo, &m_set));
+
+	m_bufferSlots.reset(maxBuffers);
+	m_imageSlots.reset(maxImages);
+}
+
+void BindlessTable::destroy()
+{
+	if (m_layout == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkDestroyDescriptorPool(m_logicalDevice, m_pool, nullptr);
+	vkDestroyDescriptorSetLayout(m_logicalDevice, m_layout, nullptr);
+
+	m_pool = VK_NULL_HANDLE;
+	m_layout = VK_NULL_HANDLE;
+	m_set = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessTable::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	uint32_t index = m_bufferSlots.allocate(m_pTimeline);
+
+	VkDescriptorBufferInfo bufferInfo = {};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = offset;
+	bufferInfo.range = range;
+
+	VkWriteDescriptorSet descriptorWrite = {};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = m_set;
+	descriptorWrite.dstBinding = BUFFER_BINDING;
+	descriptorWrite.dstArrayElement = index;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(m_logicalDevice, 1, &descriptorWrite, 0, nullptr);
+	return index;
+}
+
+void BindlessTable::removeBuffer(uint32_t index, uint64_t lastUseValue)
+{
+	m_bufferSlots.release(index, lastUseValue);
+}
+
+uint32_t BindlessTable::addImage(VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout)
+{
+	uint32_t index = m_imageSlots.allocate(m_pTimeline);
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.imageView = imageView;
+	imageInfo.sampler = sampler;
+	imageInfo.imageLayout = imageLayout;
+
+	VkWriteDescriptorSet descriptorWrite = {};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = m_set;
+	descriptorWrite.dstBinding = IMAGE_BINDING;
+	descriptorWrite.dstArrayElement = index;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(m_logicalDevice, 1, &descriptorWrite, 0, nullptr);
+	return index;
+}
+
+void BindlessTable::removeImage(uint32_t index, uint64_t lastUseValue)
+{
+	m_imageSlots.release(index, lastUseValue);
+}
+
+void BindlessTable::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout) const
+{
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, 0, 1, &m_set, 0, nullptr);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "../vulkan_wrapper.h"
+#include "../sync/GpuTimeline.h"
+
+#include <deque>
+#include <vector>
+
+/*
+ * One descriptor set holding every buffer and sampled image of the renderer in
+ * two large arrays (VK_EXT_descriptor_indexing). Shaders index them with values
+ * from push constants, so the set is bound once per frame instead of per draw.
+ *
+ * The bindings are UPDATE_AFTER_BIND and PARTIALLY_BOUND: slots can be written
+ * while command buffers using the set are pending, as long as those don't use
+ * the written slot. Removed slots are only reused once the GPU passed the
+ * timeline value of their last use.
+ */
+class BindlessTable
+{
+public:
+	static const uint32_t BUFFER_BINDING = 0;
+	static const uint32_t IMAGE_BINDING = 1;
+
+	BindlessTable();
+
+	void create(VkDevice logicalDevice, GpuTimeline* pTimeline, uint32_t maxBuffers, uint32_t maxImages);
+	void destroy();
+
+	// Storage buffers, returns the index shaders use
+	uint32_t addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+	void removeBuffer(uint32_t index, uint64_t lastUseValue);
+
+	// Combined image samplers
+	uint32_t addImage(VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout);
+	void removeImage(uint32_t index, uint64_t lastUseValue);
+
+	void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout) const;
+
+	VkDescriptorSetLayout getLayout() const
+	{
+		return m_layout;
+	}
+
+private:
+	class SlotAllocator
+	{
+	public:
+		void reset(uint32_t capacity);
+
+		uint32_t allocate(GpuTimeline* pTimeline);
+		void release(uint32_t index, uint64_t lastUseValue);
+
+	private:
+		struct RetiredSlot
+		{
+			uint32_t index;
+			uint64_t lastUseValue;
+		};
+
+		uint32_t m_capacity = 0;
+		uint32_t m_nextUnused = 0;
+		std::vector<uint32_t> m_freeSlots;
+		std::deque<RetiredSlot> m_retiredSlots;
+	};
+
+private:
+	VkDevice m_logicalDevice;
+	GpuTimeline* m_pTimeline;
+
+	VkDescriptorSetLayout m_layout;
+	VkDescriptorPool m_pool;
+	VkDescriptorSet m_set;
+
+	SlotAllocator m_bufferSlots;
+	SlotAllocator m_imageSlots;
+};
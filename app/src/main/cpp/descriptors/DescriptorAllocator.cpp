@@ -0,0 +1,139 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+
+// Pools get bigger each time one runs out, up to this many sets
+const uint32_t MAX_SETS_PER_POOL = 4096;
+
+struct PoolSizeRatio
+{
+	VkDescriptorType type;
+	float descriptorsPerSet;
+};
+
+// Rough mix of what sets contain, a pool holding the wrong mix just runs out earlier
+const PoolSizeRatio POOL_SIZE_RATIOS[] = {
+		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         2.0f},
+		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         1.0f},
+		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f},
+		{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,          1.0f},
+		{VK_DESCRIPTOR_TYPE_SAMPLER,                0.5f},
+		{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          0.5f},
+		{VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,       0.5f},
+};
+
+DescriptorAllocator::DescriptorAllocator() :
+		m_logicalDevice(VK_NULL_HANDLE),
+		m_setsPerPool(0),
+		m_currentPool(VK_NULL_HANDLE)
+{
+}
+
+void DescriptorAllocator::create(VkDevice logicalDevice, uint32_t setsPerPool)
+{
+	m_logicalDevice = logicalDevice;
+	m_setsPerPool = setsPerPool;
+}
+
+void DescriptorAllocator::destroy()
+{
+	for (VkDescriptorPool pool : m_usedPools)
+	{
+		vkDestroyDescriptorPool(m_logicalDevice, pool, nullptr);
+	}
+	for (VkDescriptorPool pool : m_freePools)
+	{
+		vkDestroyDescriptorPool(m_logicalDevice, pool, nullptr);
+	}
+
+	m_usedPools.clear();
+	m_freePools.clear();
+	m_currentPool = VK_NULL_HANDLE;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+	if (m_currentPool == VK_NULL_HANDLE)
+	{
+		m_currentPool = getPool();
+	}
+
+	VkDescriptorSetAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = m_currentPool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	VkResult result = vkAllocateDescriptorSets(m_logicalDevice, &allocateInfo, &set);
+
+	// Without VK_KHR_maintenance1 a full pool may report any out of memory error
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL ||
+	    result == VK_ERROR_OUT_OF_HOST_MEMORY || result == VK_ERROR_OUT_OF_DEVICE_MEMORY)
+	{
+		m_currentPool = getPool();
+		allocateInfo.descriptorPool = m_currentPool;
+
+		CALL_VK(vkAllocateDescriptorSets(m_logicalDevice, &allocateInfo, &set));
+	}
+	else
+	{
+		CALL_VK(result);
+	}
+
+	return set;
+}
+
+void DescriptorAllocator::reset()
+{
+	for (VkDescriptorPool pool : m_usedPools)
+	{
+		vkResetDescriptorPool(m_logicalDevice, pool, 0);
+		m_freePools.push_back(pool);
+	}
+
+	m_usedPools.clear();
+	m_currentPool = VK_NULL_HANDLE;
+}
+
+VkDescriptorPool DescriptorAllocator::getPool()
+{
+	VkDescriptorPool pool;
+	if (!m_freePools.empty())
+	{
+		pool = m_freePools.back();
+		m_freePools.pop_back();
+	}
+	else
+	{
+		pool = createPool(m_setsPerPool);
+		m_setsPerPool = std::min(m_setsPerPool * 2, MAX_SETS_PER_POOL);
+	}
+
+	m_usedPools.push_back(pool);
+	return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t maxSets)
+{
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (const PoolSizeRatio& ratio : POOL_SIZE_RATIOS)
+	{
+		VkDescriptorPoolSize poolSize = {};
+		poolSize.type = ratio.type;
+		poolSize.descriptorCount = std::max(1u, (uint32_t) (ratio.descriptorsPerSet * maxSets));
+		poolSizes.push_back(poolSize);
+	}
+
+	VkDescriptorPoolCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	createInfo.flags = 0;
+	createInfo.maxSets = maxSets;
+	createInfo.poolSizeCount = (uint32_t) poolSizes.size();
+	createInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool pool;
+	CALL_VK(vkCreateDescriptorPool(m_logicalDevice, &createInfo, nullptr, &pool));
+	return pool;
+}
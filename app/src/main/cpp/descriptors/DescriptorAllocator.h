@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../vulkan_wrapper.h"
+
+#include <vector>
+
+/*
+ * Hands out descriptor sets of any layout from a chain of pools. A new, larger
+ * pool is created when the current one runs out; reset() frees every set at
+ * once with vkResetDescriptorPool and keeps the pools for reuse.
+ *
+ * Used once per frame slot for transient sets (reset when the slot comes
+ * around again) and by DescriptorCache for long lived ones.
+ */
+class DescriptorAllocator
+{
+public:
+	DescriptorAllocator();
+
+	void create(VkDevice logicalDevice, uint32_t setsPerPool = 64);
+	void destroy();
+
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+	// Only once the GPU is done with every set of this allocator
+	void reset();
+
+private:
+	VkDescriptorPool getPool();
+	VkDescriptorPool createPool(uint32_t maxSets);
+
+private:
+	VkDevice m_logicalDevice;
+	uint32_t m_setsPerPool;
+
+	VkDescriptorPool m_currentPool;
+	std::vector<VkDescriptorPool> m_usedPools;
+	std::vector<VkDescriptorPool> m_freePools;
+};
@@ -0,0 +1,181 @@
+#include "DescriptorCache.h"
+
+#include "../util/Hash.h"
+
+#include <algorithm>
+
+DescriptorBinding DescriptorBinding::buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	DescriptorBinding descriptorBinding = {};
+	descriptorBinding.binding = binding;
+	descriptorBinding.type = type;
+	descriptorBinding.bufferInfo.buffer = buffer;
+	descriptorBinding.bufferInfo.offset = offset;
+	descriptorBinding.bufferInfo.range = range;
+
+	return descriptorBinding;
+}
+
+DescriptorBinding DescriptorBinding::image(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkImageLayout imageLayout, VkSampler sampler, uint32_t arrayElement)
+{
+	DescriptorBinding descriptorBinding = {};
+	descriptorBinding.binding = binding;
+	descriptorBinding.arrayElement = arrayElement;
+	descriptorBinding.type = type;
+	descriptorBinding.imageInfo.imageView = imageView;
+	descriptorBinding.imageInfo.imageLayout = imageLayout;
+	descriptorBinding.imageInfo.sampler = sampler;
+
+	return descriptorBinding;
+}
+
+bool DescriptorBinding::isBuffer() const
+{
+	return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ||
+	       type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+	       type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+	       type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+}
+
+bool DescriptorBinding::operator==(const DescriptorBinding& other) const
+{
+	if (binding != other.binding || arrayElement != other.arrayElement || type != other.type)
+	{
+		return false;
+	}
+
+	if (isBuffer())
+	{
+		return bufferInfo.buffer == other.bufferInfo.buffer &&
+		       bufferInfo.offset == other.bufferInfo.offset &&
+		       bufferInfo.range == other.bufferInfo.range;
+	}
+
+	return imageInfo.imageView == other.imageInfo.imageView &&
+	       imageInfo.imageLayout == other.imageInfo.imageLayout &&
+	       imageInfo.sampler == other.imageInfo.sampler;
+}
+
+DescriptorCache::DescriptorCache() :
+		m_logicalDevice(VK_NULL_HANDLE),
+		m_pUpdateTemplates(nullptr)
+{
+}
+
+void DescriptorCache::create(VkDevice logicalDevice, DescriptorUpdateTemplates* pUpdateTemplates)
+{
+	m_logicalDevice = logicalDevice;
+	m_pUpdateTemplates = pUpdateTemplates;
+	m_allocator.create(logicalDevice);
+}
+
+void DescriptorCache::destroy()
+{
+	m_entries.clear();
+	m_allocator.destroy();
+}
+
+VkDescriptorSet DescriptorCache::getSet(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings)
+{
+	return getSet(layout, bindings.data(), (uint32_t) bindings.size());
+}
+
+void DescriptorCache::getSets(VkDescriptorSetLayout layout, uint32_t nBindingsPerSet, const std::vector<DescriptorBinding>& bindings, VkDescriptorSet* pSets)
+{
+	uint32_t nSets = (uint32_t) bindings.size() / nBindingsPerSet;
+	for (uint32_t i = 0; i < nSets; ++i)
+	{
+		pSets[i] = getSet(layout, &bindings[i * nBindingsPerSet], nBindingsPerSet);
+	}
+}
+
+VkDescriptorSet DescriptorCache::getSet(VkDescriptorSetLayout layout, const DescriptorBinding* pBindings, uint32_t nBindings)
+{
+	std::vector<Entry>& bucket = m_entries[hash(layout, pBindings, nBindings)];
+	for (const Entry& entry : bucket)
+	{
+		if (entry.layout == layout && entry.bindings.size() == nBindings &&
+		    std::equal(entry.bindings.begin(), entry.bindings.end(), pBindings))
+		{
+			return entry.set;
+		}
+	}
+
+	Entry entry;
+	entry.layout = layout;
+	entry.bindings.assign(pBindings, pBindings + nBindings);
+	entry.set = m_allocator.allocate(layout);
+	write(entry.set, layout, pBindings, nBindings);
+
+	bucket.push_back(entry);
+	return entry.set;
+}
+
+void DescriptorCache::clear()
+{
+	m_entries.clear();
+	m_allocator.reset();
+}
+
+uint64_t DescriptorCache::hash(VkDescriptorSetLayout layout, const DescriptorBinding* pBindings, uint32_t nBindings)
+{
+	uint64_t hash = HASH_SEED;
+	hashCombine(hash, layout);
+
+	for (uint32_t i = 0; i < nBindings; ++i)
+	{
+		const DescriptorBinding& binding = pBindings[i];
+		hashCombine(hash, binding.binding);
+		hashCombine(hash, binding.arrayElement);
+		hashCombine(hash, binding.type);
+
+		if (binding.isBuffer())
+		{
+			hashCombine(hash, binding.bufferInfo.buffer);
+			hashCombine(hash, binding.bufferInfo.offset);
+			hashCombine(hash, binding.bufferInfo.range);
+		}
+		else
+		{
+			hashCombine(hash, binding.imageInfo.imageView);
+			hashCombine(hash, binding.imageInfo.imageLayout);
+			hashCombine(hash, binding.imageInfo.sampler);
+		}
+	}
+
+	return hash;
+}
+
+void DescriptorCache::write(VkDescriptorSet set, VkDescriptorSetLayout layout, const DescriptorBinding* pBindings, uint32_t nBindings)
+{
+	// The bindings are already laid out as the template's source data
+	if (m_pUpdateTemplates != nullptr && m_pUpdateTemplates->isSupported())
+	{
+		m_pUpdateTemplates->write(set, layout, pBindings, nBindings);
+		return;
+	}
+
+	std::vector<VkWriteDescriptorSet> writes(nBindings);
+	for (uint32_t i = 0; i < nBindings; ++i)
+	{
+		VkWriteDescriptorSet& descriptorWrite = writes[i];
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = set;
+		descriptorWrite.dstBinding = pBindings[i].binding;
+		descriptorWrite.dstArrayElement = pBindings[i].arrayElement;
+		descriptorWrite.descriptorType = pBindings[i].type;
+		descriptorWrite.descriptorCount = 1;
+
+		if (pBindings[i].isBuffer())
+		{
+			descriptorWrite.pBufferInfo = &pBindings[i].bufferInfo;
+		}
+		else
+		{
+			descriptorWrite.pImageInfo = &pBindings[i].imageInfo;
+		}
+	}
+
+	// All bindings in a single call
+	vkUpdateDescriptorSets(m_logicalDevice, (uint32_t) writes.size(), writes.data(), 0, nullptr);
+}
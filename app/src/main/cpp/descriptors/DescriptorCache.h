@@ -0,0 +1,73 @@
+#pragma once
+
+#include "DescriptorAllocator.h"
+#include "DescriptorUpdateTemplates.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// One descriptor of a set, either a buffer or an image
+struct DescriptorBinding
+{
+	uint32_t binding;
+	// Element of an array binding, one DescriptorBinding each
+	uint32_t arrayElement;
+	VkDescriptorType type;
+
+	VkDescriptorBufferInfo bufferInfo;
+	VkDescriptorImageInfo imageInfo;
+
+	static DescriptorBinding buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+	static DescriptorBinding image(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkImageLayout imageLayout, VkSampler sampler, uint32_t arrayElement = 0);
+
+	bool isBuffer() const;
+
+	bool operator==(const DescriptorBinding& other) const;
+};
+
+/*
+ * Sets that never change once written (materials, per object data in
+ * persistent buffers) are looked up by a hash of their layout and bindings.
+ * The same bindings always give back the same set, allocated and written once.
+ */
+class DescriptorCache
+{
+public:
+	DescriptorCache();
+
+	// New sets are written through pUpdateTemplates when it is supported
+	void create(VkDevice logicalDevice, DescriptorUpdateTemplates* pUpdateTemplates = nullptr);
+	void destroy();
+
+	VkDescriptorSet getSet(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings);
+
+	// Sets of one layout in bulk: bindings is packed, nBindingsPerSet after each other per set
+	void getSets(VkDescriptorSetLayout layout, uint32_t nBindingsPerSet, const std::vector<DescriptorBinding>& bindings, VkDescriptorSet* pSets);
+
+	// Frees every cached set, once none of them can be in use anymore
+	void clear();
+
+	// Same path as cached sets, for the per frame ones of a DescriptorAllocator
+	void write(VkDescriptorSet set, VkDescriptorSetLayout layout, const DescriptorBinding* pBindings, uint32_t nBindings);
+
+private:
+	struct Entry
+	{
+		VkDescriptorSetLayout layout;
+		std::vector<DescriptorBinding> bindings;
+		VkDescriptorSet set;
+	};
+
+	VkDescriptorSet getSet(VkDescriptorSetLayout layout, const DescriptorBinding* pBindings, uint32_t nBindings);
+
+	static uint64_t hash(VkDescriptorSetLayout layout, const DescriptorBinding* pBindings, uint32_t nBindings);
+
+private:
+	VkDevice m_logicalDevice;
+	DescriptorAllocator m_allocator;
+	DescriptorUpdateTemplates* m_pUpdateTemplates;
+
+	// Colliding entries share a bucket
+	std::unordered_map<uint64_t, std::vector<Entry>> m_entries;
+};
@@ -0,0 +1,116 @@
+#include "DescriptorUpdateTemplates.h"
+
+#include "DescriptorCache.h"
+#include "../util/Hash.h"
+
+#include <cstddef>
+
+static uint64_t getSlot(const DescriptorBinding& binding)
+{
+	// Descriptor types fit in 32 bits, bindings and array sizes in 16
+	return ((uint64_t) binding.binding << 48) | ((uint64_t) binding.arrayElement << 32) | (uint32_t) binding.type;
+}
+
+DescriptorUpdateTemplates::DescriptorUpdateTemplates() :
+		m_logicalDevice(VK_NULL_HANDLE),
+		m_pfnCreate(nullptr),
+		m_pfnDestroy(nullptr),
+		m_pfnUpdate(nullptr)
+{
+}
+
+void DescriptorUpdateTemplates::create(VkDevice logicalDevice, bool isExtensionEnabled)
+{
+	m_logicalDevice = logicalDevice;
+
+	if (!isExtensionEnabled)
+	{
+		return;
+	}
+
+	m_pfnCreate = (PFN_vkCreateDescriptorUpdateTemplateKHR) vkGetDeviceProcAddr(logicalDevice, "vkCreateDescriptorUpdateTemplateKHR");
+	m_pfnDestroy = (PFN_vkDestroyDescriptorUpdateTemplateKHR) vkGetDeviceProcAddr(logicalDevice, "vkDestroyDescriptorUpdateTemplateKHR");
+	m_pfnUpdate = (PFN_vkUpdateDescriptorSetWithTemplateKHR) vkGetDeviceProcAddr(logicalDevice, "vkUpdateDescriptorSetWithTemplateKHR");
+
+	if (m_pfnCreate == nullptr || m_pfnDestroy == nullptr)
+	{
+		m_pfnUpdate = nullptr;
+	}
+}
+
+void DescriptorUpdateTemplates::destroy()
+{
+	for (auto& bucket : m_templates)
+	{
+		for (const Entry& entry : bucket.second)
+		{
+			m_pfnDestroy(m_logicalDevice, entry.updateTemplate, nullptr);
+		}
+	}
+	m_templates.clear();
+}
+
+void DescriptorUpdateTemplates::write(VkDescriptorSet set, VkDescriptorSetLayout layout, const DescriptorBinding* pBindings, uint32_t nBindings)
+{
+	m_pfnUpdate(m_logicalDevice, set, getTemplate(layout, pBindings, nBindings), pBindings);
+}
+
+VkDescriptorUpdateTemplateKHR DescriptorUpdateTemplates::getTemplate(VkDescriptorSetLayout layout, const DescriptorBinding* pBindings, uint32_t nBindings)
+{
+	std::vector<uint64_t> slots(nBindings);
+	uint64_t hash = HASH_SEED;
+	hashCombine(hash, layout);
+
+	for (uint32_t i = 0; i < nBindings; ++i)
+	{
+		slots[i] = getSlot(pBindings[i]);
+		hashCombine(hash, slots[i]);
+	}
+
+	std::vector<Entry>& bucket = m_templates[hash];
+	for (const Entry& entry : bucket)
+	{
+		if (entry.layout == layout && entry.slots == slots)
+		{
+			return entry.updateTemplate;
+		}
+	}
+
+	Entry entry;
+	entry.layout = layout;
+	entry.slots = slots;
+	entry.updateTemplate = createTemplate(layout, pBindings, nBindings);
+
+	bucket.push_back(entry);
+	return entry.updateTemplate;
+}
+
+VkDescriptorUpdateTemplateKHR DescriptorUpdateTemplates::createTemplate(VkDescriptorSetLayout layout, const DescriptorBinding* pBindings, uint32_t nBindings)
+{
+	// Entry i reads the info struct of pBindings[i] straight out of the array
+	std::vector<VkDescriptorUpdateTemplateEntryKHR> entries(nBindings);
+	for (uint32_t i = 0; i < nBindings; ++i)
+	{
+		size_t infoOffset = pBindings[i].isBuffer() ? offsetof(DescriptorBinding, bufferInfo) : offsetof(DescriptorBinding, imageInfo);
+
+		VkDescriptorUpdateTemplateEntryKHR& templateEntry = entries[i];
+		templateEntry.dstBinding = pBindings[i].binding;
+		templateEntry.dstArrayElement = pBindings[i].arrayElement;
+		templateEntry.descriptorCount = 1;
+		templateEntry.descriptorType = pBindings[i].type;
+		templateEntry.offset = i * sizeof(DescriptorBinding) + infoOffset;
+		templateEntry.stride = sizeof(DescriptorBinding);
+	}
+
+	VkDescriptorUpdateTemplateCreateInfoKHR createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+	createInfo.descriptorUpdateEntryCount = (uint32_t) entries.size();
+	createInfo.pDescriptorUpdateEntries = entries.data();
+	createInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+	createInfo.descriptorSetLayout = layout;
+
+	VkDescriptorUpdateTemplateKHR updateTemplate;
+	CALL_VK(m_pfnCreate(m_logicalDevice, &createInfo, nullptr, &updateTemplate));
+
+	return updateTemplate;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "../vulkan_wrapper.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct DescriptorBinding;
+
+/*
+ * VkDescriptorUpdateTemplates (VK_KHR_descriptor_update_template), generated
+ * on first use for each layout and sequence of binding slots. A template reads
+ * the DescriptorBinding array itself as its packed source data, so a whole set
+ * is written with one call and without filling VkWriteDescriptorSets.
+ *
+ * The entry points are loaded with vkGetDeviceProcAddr; without the extension
+ * isSupported() is false and callers keep using vkUpdateDescriptorSets.
+ */
+class DescriptorUpdateTemplates
+{
+public:
+	DescriptorUpdateTemplates();
+
+	// Only with the extension enabled on the device
+	void create(VkDevice logicalDevice, bool isExtensionEnabled);
+	void destroy();
+
+	bool isSupported() const
+	{
+		return m_pfnUpdate != nullptr;
+	}
+
+	void write(VkDescriptorSet set, VkDescriptorSetLayout layout, const DescriptorBinding* pBindings, uint32_t nBindings);
+
+private:
+	struct Entry
+	{
+		VkDescriptorSetLayout layout;
+		// binding, array element and type of each slot, the data of the bindings doesn't matter
+		std::vector<uint64_t> slots;
+		VkDescriptorUpdateTemplateKHR updateTemplate;
+	};
+
+	VkDescriptorUpdateTemplateKHR getTemplate(VkDescriptorSetLayout layout, const DescriptorBinding* pBindings, uint32_t nBindings);
+	VkDescriptorUpdateTemplateKHR createTemplate(VkDescriptorSetLayout layout, const DescriptorBinding* pBindings, uint32_t nBindings);
+
+private:
+	VkDevice m_logicalDevice;
+
+	PFN_vkCreateDescriptorUpdateTemplateKHR m_pfnCreate;
+	PFN_vkDestroyDescriptorUpdateTemplateKHR m_pfnDestroy;
+	PFN_vkUpdateDescriptorSetWithTemplateKHR m_pfnUpdate;
+
+	// Colliding entries share a bucket
+	std::unordered_map<uint64_t, std::vector<Entry>> m_templates;
+};
@@ -0,0 +1,1431 @@
+#include "RenderGraph.h"
+
+#include "../util/Hash.h"
+
+#include <android/log.h>
+#include <algorithm>
+
+const uint32_t INVALID_INDEX = UINT32_MAX;
+
+// Only these need to be made available, read bits in a source access mask do nothing
+const VkAccessFlags WRITE_ACCESS =
+		VK_ACCESS_SHADER_WRITE_BIT |
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_TRANSFER_WRITE_BIT;
+
+static bool operator==(const VkExtent2D& a, const VkExtent2D& b)
+{
+	return a.width == b.width && a.height == b.height;
+}
+
+RenderGraphImageDesc::RenderGraphImageDesc(VkFormat format, VkExtent2D extent) :
+		format(format),
+		extent(extent),
+		samples(VK_SAMPLE_COUNT_1_BIT),
+		isPersistent(false)
+{
+}
+
+RenderGraphPass::RenderGraphPass(const std::string& name, RenderGraphPassType type) :
+		m_name(name),
+		m_type(type),
+		m_isCulled(false),
+		m_physicalPass(INVALID_INDEX),
+		m_subpass(0)
+{
+}
+
+void RenderGraphPass::addColorOutput(const std::string& image, const VkClearColorValue* pClearValue)
+{
+	VkClearValue clearValue = {};
+	if (pClearValue != nullptr)
+	{
+		clearValue.color = *pClearValue;
+	}
+
+	addUse(image, RenderGraphAccess::COLOR_ATTACHMENT, pClearValue != nullptr ? &clearValue : nullptr);
+}
+
+void RenderGraphPass::setDepthOutput(const std::string& image, const VkClearDepthStencilValue* pClearValue)
+{
+	VkClearValue clearValue = {};
+	if (pClearValue != nullptr)
+	{
+		clearValue.depthStencil = *pClearValue;
+	}
+
+	addUse(image, RenderGraphAccess::DEPTH_ATTACHMENT, pClearValue != nullptr ? &clearValue : nullptr);
+}
+
+void RenderGraphPass::addInputAttachment(const std::string& image)
+{
+	addUse(image, RenderGraphAccess::INPUT_ATTACHMENT, nullptr);
+}
+
+void RenderGraphPass::addSampledImage(const std::string& image)
+{
+	addUse(image, RenderGraphAccess::SAMPLED, nullptr);
+}
+
+void RenderGraphPass::addStorageRead(const std::string& resource)
+{
+	addUse(resource, RenderGraphAccess::STORAGE_READ, nullptr);
+}
+
+void RenderGraphPass::addStorageWrite(const std::string& resource)
+{
+	addUse(resource, RenderGraphAccess::STORAGE_WRITE, nullptr);
+}
+
+void RenderGraphPass::addTransferSource(const std::string& resource)
+{
+	addUse(resource, RenderGraphAccess::TRANSFER_SOURCE, nullptr);
+}
+
+void RenderGraphPass::addTransferDestination(const std::string& resource)
+{
+	addUse(resource, RenderGraphAccess::TRANSFER_DESTINATION, nullptr);
+}
+
+void RenderGraphPass::setRecord(const RecordFunction& record)
+{
+	m_record = record;
+}
+
+void RenderGraphPass::setCondition(const ConditionFunction& condition)
+{
+	m_condition = condition;
+}
+
+void RenderGraphPass::setRenderArea(const RenderAreaFunction& renderArea)
+{
+	m_renderArea = renderArea;
+}
+
+void RenderGraphPass::addUse(const std::string& name, RenderGraphAccess access, const VkClearValue* pClearValue)
+{
+	Use use = {};
+	use.name = name;
+	use.resource = INVALID_INDEX;
+	use.access = access;
+	use.isCleared = pClearValue != nullptr;
+	if (pClearValue != nullptr)
+	{
+		use.clearValue = *pClearValue;
+	}
+
+	m_uses.push_back(use);
+}
+
+RenderGraph::RenderGraph() :
+		m_logicalDevice(VK_NULL_HANDLE),
+		m_memoryProperties(),
+		m_pDeletionQueue(nullptr),
+		m_isFirstExecute(false)
+{
+}
+
+void RenderGraph::create(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, DeletionQueue* pDeletionQueue)
+{
+	m_logicalDevice = logicalDevice;
+	m_pDeletionQueue = pDeletionQueue;
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+}
+
+void RenderGraph::reset(uint64_t lastUseValue)
+{
+	for (const PhysicalPass& physicalPass : m_physicalPasses)
+	{
+		for (VkFramebuffer framebuffer : physicalPass.framebuffers)
+		{
+			m_pDeletionQueue->enqueueFramebuffer(framebuffer, lastUseValue);
+		}
+		m_pDeletionQueue->enqueueRenderPass(physicalPass.renderPass, lastUseValue);
+	}
+
+	for (const Resource& resource : m_resources)
+	{
+		if (resource.isImported || !resource.isImage)
+		{
+			continue;
+		}
+
+		for (VkImageView view : resource.views)
+		{
+			m_pDeletionQueue->enqueueImageView(view, lastUseValue);
+		}
+		for (VkImage image : resource.images)
+		{
+			m_pDeletionQueue->enqueueImage(image, lastUseValue);
+		}
+		m_pDeletionQueue->enqueueMemory(resource.memory, lastUseValue);
+	}
+
+	for (const MemoryBlock& block : m_memoryBlocks)
+	{
+		m_pDeletionQueue->enqueueMemory(block.memory, lastUseValue);
+	}
+
+	m_resources.clear();
+	m_resourceIndexes.clear();
+	m_outputs.clear();
+	m_passes.clear();
+	m_passIndexes.clear();
+	m_physicalPasses.clear();
+	m_memoryBlocks.clear();
+	m_finalBarriers = BarrierBatch();
+	m_initialBarriers = BarrierBatch();
+	m_isFirstExecute = false;
+}
+
+uint32_t RenderGraph::addResource(const std::string& name)
+{
+	if (m_resourceIndexes.count(name) != 0)
+	{
+		__android_log_assert("Render graph resource added twice.", nullptr, "%s", name.c_str());
+	}
+
+	Resource resource = {};
+	resource.name = name;
+	resource.samples = VK_SAMPLE_COUNT_1_BIT;
+	resource.buffer = VK_NULL_HANDLE;
+	resource.memory = VK_NULL_HANDLE;
+	resource.memoryBlock = INVALID_INDEX;
+	resource.aliasPredecessor = INVALID_INDEX;
+	resource.firstPass = INVALID_INDEX;
+	resource.state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	uint32_t index = (uint32_t) m_resources.size();
+	m_resources.push_back(resource);
+	m_resourceIndexes[name] = index;
+	return index;
+}
+
+void RenderGraph::addImage(const std::string& name, const RenderGraphImageDesc& desc)
+{
+	Resource& resource = m_resources[addResource(name)];
+	resource.isImage = true;
+	resource.isPersistent = desc.isPersistent;
+	resource.format = desc.format;
+	resource.extent = desc.extent;
+	resource.samples = desc.samples;
+}
+
+void RenderGraph::importImage(const std::string& name, VkFormat format, VkExtent2D extent,
+                              const std::vector<VkImage>& images, const std::vector<VkImageView>& views, VkImageLayout finalLayout)
+{
+	Resource& resource = m_resources[addResource(name)];
+	resource.isImage = true;
+	resource.isImported = true;
+	resource.format = format;
+	resource.extent = extent;
+	resource.images = images;
+	resource.views = views;
+	resource.finalLayout = finalLayout;
+}
+
+void RenderGraph::importBuffer(const std::string& name, VkBuffer buffer)
+{
+	Resource& resource = m_resources[addResource(name)];
+	resource.isImported = true;
+	resource.buffer = buffer;
+}
+
+RenderGraphPass& RenderGraph::addPass(const std::string& name, RenderGraphPassType type)
+{
+	if (m_passIndexes.count(name) != 0)
+	{
+		__android_log_assert("Render graph pass added twice.", nullptr, "%s", name.c_str());
+	}
+
+	m_passIndexes[name] = (uint32_t) m_passes.size();
+	m_passes.push_back(RenderGraphPass(name, type));
+	return m_passes.back();
+}
+
+void RenderGraph::addOutput(const std::string& resource)
+{
+	auto it = m_resourceIndexes.find(resource);
+	if (it == m_resourceIndexes.end())
+	{
+		__android_log_assert("Unknown render graph output.", nullptr, "%s", resource.c_str());
+	}
+
+	m_outputs.push_back(it->second);
+}
+
+void RenderGraph::compile()
+{
+	// Names are only looked up once, everything below works on indexes
+	for (RenderGraphPass& pass : m_passes)
+	{
+		for (RenderGraphPass::Use& use : pass.m_uses)
+		{
+			auto it = m_resourceIndexes.find(use.name);
+			if (it == m_resourceIndexes.end())
+			{
+				__android_log_assert("Unknown render graph resource.", nullptr, "%s in %s", use.name.c_str(), pass.m_name.c_str());
+			}
+			use.resource = it->second;
+
+			if (!m_resources[use.resource].isImage && use.access != RenderGraphAccess::STORAGE_READ && use.access != RenderGraphAccess::STORAGE_WRITE &&
+			    use.access != RenderGraphAccess::TRANSFER_SOURCE && use.access != RenderGraphAccess::TRANSFER_DESTINATION)
+			{
+				__android_log_assert("Buffers only support storage and transfer accesses.", nullptr, "%s in %s", use.name.c_str(), pass.m_name.c_str());
+			}
+
+			// Anything else would need barriers that depend on whether the pass runs
+			const Resource& resource = m_resources[use.resource];
+			if (pass.m_condition && (pass.m_type != RenderGraphPassType::GRAPHICS || !isAttachment(use.access) || !resource.isPersistent || resource.isImported))
+			{
+				__android_log_assert("Conditional passes only support persistent attachments.", nullptr, "%s in %s", use.name.c_str(), pass.m_name.c_str());
+			}
+		}
+	}
+
+	cullPasses();
+	groupPasses();
+	createImages();
+	allocateMemory();
+
+	// The first run only finds the state everything is left in at the end of a
+	// frame, the second starts from it so the hazards with the previous frame are covered
+	std::vector<RenderPassDesc> renderPassDescs;
+	simulate(renderPassDescs);
+	simulate(renderPassDescs);
+
+	for (uint32_t i = 0; i < m_physicalPasses.size(); ++i)
+	{
+		if (m_physicalPasses[i].type == RenderGraphPassType::GRAPHICS)
+		{
+			createRenderPass(m_physicalPasses[i], renderPassDescs[i]);
+		}
+	}
+
+	// Persistent images are expected in their end of frame layout
+	m_initialBarriers = BarrierBatch();
+	for (uint32_t i = 0; i < m_resources.size(); ++i)
+	{
+		const Resource& resource = m_resources[i];
+		if (resource.isPersistent && resource.firstPass != INVALID_INDEX && resource.state.layout != VK_IMAGE_LAYOUT_UNDEFINED)
+		{
+			m_initialBarriers.srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			m_initialBarriers.dstStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			m_initialBarriers.barriers.push_back({i, VK_IMAGE_LAYOUT_UNDEFINED, resource.state.layout, 0, 0});
+		}
+	}
+	m_isFirstExecute = true;
+}
+
+void RenderGraph::cullPasses()
+{
+	for (Resource& resource : m_resources)
+	{
+		resource.isNeeded = false;
+	}
+	for (uint32_t output : m_outputs)
+	{
+		m_resources[output].isNeeded = true;
+	}
+
+	// Backwards, a pass is kept when a later kept pass (or an output) needs what it writes
+	for (size_t i = m_passes.size(); i-- > 0;)
+	{
+		RenderGraphPass& pass = m_passes[i];
+
+		pass.m_isCulled = true;
+		for (const RenderGraphPass::Use& use : pass.m_uses)
+		{
+			if (isWrite(use.access) && m_resources[use.resource].isNeeded)
+			{
+				pass.m_isCulled = false;
+			}
+		}
+
+		if (pass.m_isCulled)
+		{
+			continue;
+		}
+
+		// Cleared outputs don't need earlier contents, loaded outputs and inputs do
+		for (const RenderGraphPass::Use& use : pass.m_uses)
+		{
+			if (use.isCleared)
+			{
+				m_resources[use.resource].isNeeded = false;
+			}
+		}
+		for (const RenderGraphPass::Use& use : pass.m_uses)
+		{
+			if (!use.isCleared)
+			{
+				m_resources[use.resource].isNeeded = true;
+			}
+		}
+	}
+}
+
+void RenderGraph::groupPasses()
+{
+	m_physicalPasses.clear();
+
+	for (uint32_t i = 0; i < m_passes.size(); ++i)
+	{
+		RenderGraphPass& pass = m_passes[i];
+		if (pass.m_isCulled)
+		{
+			continue;
+		}
+
+		if (!m_physicalPasses.empty() && canMerge(m_physicalPasses.back(), pass))
+		{
+			PhysicalPass& physicalPass = m_physicalPasses.back();
+			pass.m_physicalPass = (uint32_t) m_physicalPasses.size() - 1;
+			pass.m_subpass = (uint32_t) physicalPass.passes.size();
+			physicalPass.passes.push_back(i);
+			continue;
+		}
+
+		PhysicalPass physicalPass;
+		physicalPass.type = pass.m_type;
+		physicalPass.passes.push_back(i);
+		physicalPass.barriers.srcStages = 0;
+		physicalPass.barriers.dstStages = 0;
+		physicalPass.extent = {0, 0};
+		physicalPass.renderPass = VK_NULL_HANDLE;
+		physicalPass.renderPassHash = 0;
+
+		if (pass.m_type == RenderGraphPassType::GRAPHICS)
+		{
+			// Every attachment covers the render area
+			for (const RenderGraphPass::Use& use : pass.m_uses)
+			{
+				if (!isAttachment(use.access))
+				{
+					continue;
+				}
+
+				const VkExtent2D& extent = m_resources[use.resource].extent;
+				if (physicalPass.extent.width == 0)
+				{
+					physicalPass.extent = extent;
+				}
+				else if (!(physicalPass.extent == extent))
+				{
+					__android_log_assert("Attachments of a pass differ in size.", nullptr, "%s", pass.m_name.c_str());
+				}
+			}
+
+			if (physicalPass.extent.width == 0)
+			{
+				__android_log_assert("Graphics pass without attachments.", nullptr, "%s", pass.m_name.c_str());
+			}
+		}
+
+		pass.m_physicalPass = (uint32_t) m_physicalPasses.size();
+		pass.m_subpass = 0;
+		m_physicalPasses.push_back(physicalPass);
+	}
+}
+
+bool RenderGraph::canMerge(const PhysicalPass& physicalPass, const RenderGraphPass& pass) const
+{
+	if (physicalPass.type != RenderGraphPassType::GRAPHICS || pass.m_type != RenderGraphPassType::GRAPHICS)
+	{
+		return false;
+	}
+
+	// Skipped on their own
+	if (pass.m_condition || m_passes[physicalPass.passes.back()].m_condition)
+	{
+		return false;
+	}
+
+	// Subpasses can only depend on each other through attachments at the same
+	// pixel, anything else needs a barrier outside the render pass
+	for (const RenderGraphPass::Use& use : pass.m_uses)
+	{
+		if (isAttachment(use.access) && !(m_resources[use.resource].extent == physicalPass.extent))
+		{
+			return false;
+		}
+
+		for (uint32_t passIndex : physicalPass.passes)
+		{
+			for (const RenderGraphPass::Use& other : m_passes[passIndex].m_uses)
+			{
+				if (other.resource == use.resource && (!isAttachment(use.access) || !isAttachment(other.access)))
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void RenderGraph::createImages()
+{
+	for (Resource& resource : m_resources)
+	{
+		resource.usage = 0;
+		resource.firstPass = INVALID_INDEX;
+		resource.lastPass = 0;
+		resource.isTransient = false;
+		resource.state = {VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, 0};
+	}
+
+	for (const RenderGraphPass& pass : m_passes)
+	{
+		if (pass.m_isCulled)
+		{
+			continue;
+		}
+
+		for (const RenderGraphPass::Use& use : pass.m_uses)
+		{
+			Resource& resource = m_resources[use.resource];
+			resource.usage |= getUsage(use.access);
+			resource.firstPass = std::min(resource.firstPass, pass.m_physicalPass);
+			resource.lastPass = std::max(resource.lastPass, pass.m_physicalPass);
+		}
+	}
+
+	const VkImageUsageFlags attachmentUsage =
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+			VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+	for (uint32_t i = 0; i < m_resources.size(); ++i)
+	{
+		Resource& resource = m_resources[i];
+		if (resource.isImported || !resource.isImage || resource.firstPass == INVALID_INDEX)
+		{
+			continue;
+		}
+
+		// Never leaves the render pass, tilers don't even need memory for it
+		bool isOutput = std::find(m_outputs.begin(), m_outputs.end(), i) != m_outputs.end();
+		resource.isTransient = !resource.isPersistent && !isOutput && resource.firstPass == resource.lastPass && (resource.usage & ~attachmentUsage) == 0;
+		if (resource.isTransient)
+		{
+			resource.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		}
+
+		VkImageCreateInfo imageCreateInfo = {};
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.format = resource.format;
+		imageCreateInfo.extent.width = resource.extent.width;
+		imageCreateInfo.extent.height = resource.extent.height;
+		imageCreateInfo.extent.depth = 1;
+		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.samples = resource.samples;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.usage = resource.usage;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		resource.images.resize(1);
+		CALL_VK(vkCreateImage(m_logicalDevice, &imageCreateInfo, nullptr, &resource.images[0]));
+	}
+}
+
+void RenderGraph::allocateMemory()
+{
+	m_memoryBlocks.clear();
+
+	std::vector<uint32_t> aliasable;
+	for (uint32_t i = 0; i < m_resources.size(); ++i)
+	{
+		Resource& resource = m_resources[i];
+		if (resource.images.empty() || resource.isImported)
+		{
+			continue;
+		}
+
+		VkMemoryRequirements memoryRequirements;
+		vkGetImageMemoryRequirements(m_logicalDevice, resource.images[0], &memoryRequirements);
+
+		if (!resource.isTransient && !resource.isPersistent)
+		{
+			aliasable.push_back(i);
+			continue;
+		}
+
+		// Lazily allocated memory is only committed if the tiles spill, nothing to share
+		uint32_t memoryTypeIndex = INVALID_INDEX;
+		if (resource.isTransient)
+		{
+			memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+		}
+		if (memoryTypeIndex == INVALID_INDEX)
+		{
+			memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		}
+		if (memoryTypeIndex == INVALID_INDEX)
+		{
+			__android_log_assert("No device local memory type for a render graph image.", nullptr, "%s", resource.name.c_str());
+		}
+
+		VkMemoryAllocateInfo memoryAllocateInfo = {};
+		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memoryAllocateInfo.allocationSize = memoryRequirements.size;
+		memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+		CALL_VK(vkAllocateMemory(m_logicalDevice, &memoryAllocateInfo, nullptr, &resource.memory));
+		CALL_VK(vkBindImageMemory(m_logicalDevice, resource.images[0], resource.memory, 0));
+	}
+
+	// Images whose lifetimes don't overlap share a block, all bound at offset 0
+	std::sort(aliasable.begin(), aliasable.end(), [this](uint32_t a, uint32_t b)
+	{
+		return m_resources[a].firstPass < m_resources[b].firstPass;
+	});
+
+	for (uint32_t index : aliasable)
+	{
+		Resource& resource = m_resources[index];
+
+		VkMemoryRequirements memoryRequirements;
+		vkGetImageMemoryRequirements(m_logicalDevice, resource.images[0], &memoryRequirements);
+
+		uint32_t blockIndex = INVALID_INDEX;
+		for (uint32_t i = 0; i < m_memoryBlocks.size(); ++i)
+		{
+			const MemoryBlock& block = m_memoryBlocks[i];
+			if (block.lastPass < resource.firstPass && (block.memoryTypeBits & memoryRequirements.memoryTypeBits) != 0)
+			{
+				blockIndex = i;
+				break;
+			}
+		}
+
+		if (blockIndex == INVALID_INDEX)
+		{
+			blockIndex = (uint32_t) m_memoryBlocks.size();
+			m_memoryBlocks.push_back({VK_NULL_HANDLE, 0, 1, ~0u, 0, INVALID_INDEX});
+		}
+
+		MemoryBlock& block = m_memoryBlocks[blockIndex];
+		block.size = std::max(block.size, memoryRequirements.size);
+		block.alignment = std::max(block.alignment, memoryRequirements.alignment);
+		block.memoryTypeBits &= memoryRequirements.memoryTypeBits;
+
+		resource.memoryBlock = blockIndex;
+		resource.aliasPredecessor = block.lastResource;
+		block.lastPass = resource.lastPass;
+		block.lastResource = index;
+	}
+
+	for (MemoryBlock& block : m_memoryBlocks)
+	{
+		VkMemoryAllocateInfo memoryAllocateInfo = {};
+		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memoryAllocateInfo.allocationSize = block.size;
+		memoryAllocateInfo.memoryTypeIndex = findMemoryType(block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (memoryAllocateInfo.memoryTypeIndex == INVALID_INDEX)
+		{
+			__android_log_assert("No device local memory type for a render graph memory block.", nullptr, nullptr);
+		}
+
+		CALL_VK(vkAllocateMemory(m_logicalDevice, &memoryAllocateInfo, nullptr, &block.memory));
+	}
+
+	for (uint32_t index : aliasable)
+	{
+		Resource& resource = m_resources[index];
+		const MemoryBlock& block = m_memoryBlocks[resource.memoryBlock];
+
+		// The first image of a block follows the last one of the previous frame
+		if (resource.aliasPredecessor == INVALID_INDEX)
+		{
+			resource.aliasPredecessor = block.lastResource;
+		}
+
+		CALL_VK(vkBindImageMemory(m_logicalDevice, resource.images[0], block.memory, 0));
+	}
+
+	// Views need bound memory
+	for (Resource& resource : m_resources)
+	{
+		if (resource.images.empty() || resource.isImported)
+		{
+			continue;
+		}
+
+		VkImageViewCreateInfo viewCreateInfo = {};
+		viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewCreateInfo.image = resource.images[0];
+		viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewCreateInfo.format = resource.format;
+		viewCreateInfo.subresourceRange.aspectMask = isDepthFormat(resource.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+		viewCreateInfo.subresourceRange.baseMipLevel = 0;
+		viewCreateInfo.subresourceRange.levelCount = 1;
+		viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+		viewCreateInfo.subresourceRange.layerCount = 1;
+
+		resource.views.resize(1);
+		CALL_VK(vkCreateImageView(m_logicalDevice, &viewCreateInfo, nullptr, &resource.views[0]));
+	}
+}
+
+void RenderGraph::simulate(std::vector<RenderPassDesc>& renderPassDescs)
+{
+	renderPassDescs.assign(m_physicalPasses.size(), RenderPassDesc());
+
+	// Swapchain images come from the acquire semaphore, waited for at the color
+	// output stage. Everything else continues from the end of the last frame.
+	for (Resource& resource : m_resources)
+	{
+		resource.isTouched = false;
+		if (resource.isImported && resource.isImage)
+		{
+			resource.state = {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0};
+		}
+	}
+
+	for (uint32_t i = 0; i < m_physicalPasses.size(); ++i)
+	{
+		PhysicalPass& physicalPass = m_physicalPasses[i];
+		physicalPass.barriers = BarrierBatch();
+		physicalPass.barriers.srcStages = 0;
+		physicalPass.barriers.dstStages = 0;
+
+		if (physicalPass.type == RenderGraphPassType::GRAPHICS)
+		{
+			simulateGraphicsPass(physicalPass, i, renderPassDescs[i]);
+			continue;
+		}
+
+		for (uint32_t passIndex : physicalPass.passes)
+		{
+			for (const RenderGraphPass::Use& use : m_passes[passIndex].m_uses)
+			{
+				addBarrier(physicalPass.barriers, use.resource, use.access, physicalPass.type);
+			}
+		}
+	}
+
+	// Imported images not left in their final layout by a render pass
+	m_finalBarriers = BarrierBatch();
+	m_finalBarriers.srcStages = 0;
+	m_finalBarriers.dstStages = 0;
+	for (uint32_t i = 0; i < m_resources.size(); ++i)
+	{
+		Resource& resource = m_resources[i];
+		if (!resource.isImported || !resource.isImage || resource.firstPass == INVALID_INDEX || resource.state.layout == resource.finalLayout)
+		{
+			continue;
+		}
+
+		m_finalBarriers.srcStages |= resource.state.writeStages | resource.state.readStages;
+		m_finalBarriers.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		m_finalBarriers.barriers.push_back({i, resource.state.layout, resource.finalLayout, resource.state.writeAccess, 0});
+		resource.state.layout = resource.finalLayout;
+	}
+}
+
+void RenderGraph::simulateGraphicsPass(PhysicalPass& physicalPass, uint32_t physicalIndex, RenderPassDesc& desc)
+{
+	uint32_t nSubpasses = (uint32_t) physicalPass.passes.size();
+
+	physicalPass.attachments.clear();
+	physicalPass.clearValues.clear();
+	desc.attachments.clear();
+	desc.colorReferences.assign(nSubpasses, std::vector<VkAttachmentReference>());
+	desc.inputReferences.assign(nSubpasses, std::vector<VkAttachmentReference>());
+	desc.depthReferences.assign(nSubpasses, {VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED});
+	desc.preserveAttachments.assign(nSubpasses, std::vector<uint32_t>());
+	desc.dependencies.clear();
+
+	// Per attachment: the last subpass using it and how, plus everything the pass did to it
+	struct AttachmentState
+	{
+		VkImageLayout previousLayout;
+		uint32_t firstSubpass;
+		uint32_t lastSubpass;
+		VkImageLayout lastLayout;
+		VkPipelineStageFlags lastStages;
+		VkAccessFlags lastWriteAccess;
+		VkPipelineStageFlags stages;
+		VkAccessFlags writeAccess;
+	};
+	std::vector<AttachmentState> attachmentStates;
+
+	// Layout transitions only wait for external dependencies into the first subpass using the attachment
+	std::vector<VkSubpassDependency> externalDependencies(nSubpasses);
+	for (uint32_t subpass = 0; subpass < nSubpasses; ++subpass)
+	{
+		externalDependencies[subpass] = {};
+		externalDependencies[subpass].srcSubpass = VK_SUBPASS_EXTERNAL;
+		externalDependencies[subpass].dstSubpass = subpass;
+	}
+
+	for (uint32_t subpass = 0; subpass < nSubpasses; ++subpass)
+	{
+		const RenderGraphPass& pass = m_passes[physicalPass.passes[subpass]];
+
+		for (const RenderGraphPass::Use& use : pass.m_uses)
+		{
+			// Hoisted in front of the render pass, merging made sure that is safe
+			if (!isAttachment(use.access))
+			{
+				addBarrier(physicalPass.barriers, use.resource, use.access, RenderGraphPassType::GRAPHICS);
+				continue;
+			}
+
+			Resource& resource = m_resources[use.resource];
+			VkImageLayout layout = getLayout(use.access, resource.format);
+			VkPipelineStageFlags stages = getStages(use.access, RenderGraphPassType::GRAPHICS);
+			VkAccessFlags accessFlags = getAccessFlags(use.access);
+			VkAccessFlags writeAccess = isWrite(use.access) ? accessFlags & WRITE_ACCESS : 0;
+
+			uint32_t attachment = (uint32_t) (std::find(physicalPass.attachments.begin(), physicalPass.attachments.end(), use.resource) - physicalPass.attachments.begin());
+			if (attachment == physicalPass.attachments.size())
+			{
+				touch(use.resource);
+
+				bool isLoaded = !use.isCleared && resource.state.layout != VK_IMAGE_LAYOUT_UNDEFINED;
+
+				VkAttachmentDescription description = {};
+				description.format = resource.format;
+				description.samples = resource.samples;
+				description.loadOp = use.isCleared ? VK_ATTACHMENT_LOAD_OP_CLEAR : isLoaded ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				description.stencilLoadOp = hasStencil(resource.format) ? description.loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				description.initialLayout = isLoaded ? resource.state.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+				// Earlier passes and the previous frame, the render pass does the layout transition
+				VkSubpassDependency& externalDependency = externalDependencies[subpass];
+				externalDependency.srcStageMask |= resource.state.writeStages | resource.state.readStages;
+				externalDependency.srcAccessMask |= resource.state.writeAccess;
+				externalDependency.dstStageMask |= stages;
+				externalDependency.dstAccessMask |= accessFlags;
+
+				physicalPass.attachments.push_back(use.resource);
+				physicalPass.clearValues.push_back(use.clearValue);
+				desc.attachments.push_back(description);
+				attachmentStates.push_back({resource.state.layout, subpass, subpass, layout, stages, writeAccess, stages, writeAccess});
+			}
+			else
+			{
+				if (use.isCleared)
+				{
+					__android_log_assert("Only the first use of an attachment in a render pass can clear it.", nullptr, "%s in %s", use.name.c_str(), pass.m_name.c_str());
+				}
+
+				AttachmentState& state = attachmentStates[attachment];
+				if (state.lastSubpass != subpass && (state.lastWriteAccess != 0 || writeAccess != 0 || state.lastLayout != layout))
+				{
+					VkSubpassDependency* pDependency = nullptr;
+					for (VkSubpassDependency& dependency : desc.dependencies)
+					{
+						if (dependency.srcSubpass == state.lastSubpass && dependency.dstSubpass == subpass)
+						{
+							pDependency = &dependency;
+						}
+					}
+					if (pDependency == nullptr)
+					{
+						desc.dependencies.push_back({});
+						pDependency = &desc.dependencies.back();
+						pDependency->srcSubpass = state.lastSubpass;
+						pDependency->dstSubpass = subpass;
+						pDependency->dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+					}
+
+					pDependency->srcStageMask |= state.lastStages;
+					pDependency->srcAccessMask |= state.lastWriteAccess;
+					pDependency->dstStageMask |= stages;
+					pDependency->dstAccessMask |= accessFlags;
+				}
+
+				state.lastSubpass = subpass;
+				state.lastLayout = layout;
+				state.lastStages = stages;
+				state.lastWriteAccess = writeAccess;
+				state.stages |= stages;
+				state.writeAccess |= writeAccess;
+			}
+
+			VkAttachmentReference reference = {attachment, layout};
+			switch (use.access)
+			{
+				case RenderGraphAccess::COLOR_ATTACHMENT:
+					desc.colorReferences[subpass].push_back(reference);
+					break;
+
+				case RenderGraphAccess::DEPTH_ATTACHMENT:
+					desc.depthReferences[subpass] = reference;
+					break;
+
+				default:
+					desc.inputReferences[subpass].push_back(reference);
+					break;
+			}
+		}
+	}
+
+	for (const VkSubpassDependency& externalDependency : externalDependencies)
+	{
+		if (externalDependency.srcStageMask != 0)
+		{
+			desc.dependencies.push_back(externalDependency);
+		}
+	}
+
+	// Skipping the pass must not change the layouts later barriers expect
+	bool isConditional = nSubpasses == 1 && m_passes[physicalPass.passes[0]].m_condition;
+
+	// Orders final layout transitions before the barriers of later passes, which
+	// wait for the attachment stages
+	VkSubpassDependency finalDependency = {};
+	finalDependency.srcSubpass = 0;
+	finalDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+
+	for (uint32_t attachment = 0; attachment < physicalPass.attachments.size(); ++attachment)
+	{
+		const AttachmentState& state = attachmentStates[attachment];
+		uint32_t resourceIndex = physicalPass.attachments[attachment];
+		Resource& resource = m_resources[resourceIndex];
+
+		// Contents between two uses have to survive the subpasses in between
+		for (uint32_t subpass = state.firstSubpass + 1; subpass < state.lastSubpass; ++subpass)
+		{
+			bool isReferenced = desc.depthReferences[subpass].attachment == attachment;
+			for (const VkAttachmentReference& reference : desc.colorReferences[subpass])
+			{
+				isReferenced |= reference.attachment == attachment;
+			}
+			for (const VkAttachmentReference& reference : desc.inputReferences[subpass])
+			{
+				isReferenced |= reference.attachment == attachment;
+			}
+
+			if (!isReferenced)
+			{
+				desc.preserveAttachments[subpass].push_back(attachment);
+			}
+		}
+
+		bool isOutput = std::find(m_outputs.begin(), m_outputs.end(), resourceIndex) != m_outputs.end();
+		bool isStored = resource.isImported || resource.isPersistent || isOutput || resource.lastPass > physicalIndex;
+
+		VkAttachmentDescription& description = desc.attachments[attachment];
+		description.storeOp = isStored ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		description.stencilStoreOp = hasStencil(resource.format) ? description.storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		description.finalLayout = resource.isImported && resource.lastPass == physicalIndex ? resource.finalLayout : state.lastLayout;
+
+		// Undefined only until the first simulation found the end of frame layout
+		if (isConditional && state.previousLayout != VK_IMAGE_LAYOUT_UNDEFINED && state.previousLayout != description.finalLayout)
+		{
+			description.finalLayout = state.previousLayout;
+			finalDependency.srcStageMask |= state.stages;
+			finalDependency.srcAccessMask |= state.writeAccess;
+			finalDependency.dstStageMask |= state.stages;
+		}
+
+		// Later accesses wait for everything the render pass did, including its layout transitions
+		resource.state.layout = description.finalLayout;
+		resource.state.writeStages = state.stages;
+		resource.state.writeAccess = state.writeAccess;
+		resource.state.readStages = 0;
+	}
+
+	if (finalDependency.srcStageMask != 0)
+	{
+		desc.dependencies.push_back(finalDependency);
+	}
+}
+
+void RenderGraph::touch(uint32_t resourceIndex)
+{
+	Resource& resource = m_resources[resourceIndex];
+	if (resource.isTouched)
+	{
+		return;
+	}
+	resource.isTouched = true;
+
+	if (resource.isImported || resource.isPersistent || !resource.isImage)
+	{
+		return;
+	}
+
+	// Contents are discarded, but the memory may still be in use by the previous
+	// image of its block, or by this image in the previous frame
+	uint32_t predecessor = resource.aliasPredecessor != INVALID_INDEX ? resource.aliasPredecessor : resourceIndex;
+	const AccessState& previous = m_resources[predecessor].state;
+
+	AccessState state = {VK_IMAGE_LAYOUT_UNDEFINED, previous.writeStages | previous.readStages, previous.writeAccess, 0};
+	resource.state = state;
+}
+
+void RenderGraph::addBarrier(BarrierBatch& batch, uint32_t resourceIndex, RenderGraphAccess access, RenderGraphPassType type)
+{
+	touch(resourceIndex);
+
+	Resource& resource = m_resources[resourceIndex];
+	AccessState& state = resource.state;
+
+	VkPipelineStageFlags stages = getStages(access, type);
+	VkAccessFlags accessFlags = getAccessFlags(access);
+	VkImageLayout layout = resource.isImage ? getLayout(access, resource.format) : VK_IMAGE_LAYOUT_UNDEFINED;
+	bool isLayoutChange = resource.isImage && layout != state.layout;
+
+	if (isWrite(access) || isLayoutChange)
+	{
+		// Earlier reads have to be done before the data changes as well
+		VkPipelineStageFlags srcStages = state.writeStages | state.readStages;
+		if (srcStages == 0 && isLayoutChange)
+		{
+			srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		}
+
+		if (srcStages != 0)
+		{
+			batch.srcStages |= srcStages;
+			batch.dstStages |= stages;
+			batch.barriers.push_back({resourceIndex, state.layout, layout, state.writeAccess, accessFlags});
+		}
+
+		if (isWrite(access))
+		{
+			state = {layout, stages, accessFlags & WRITE_ACCESS, 0};
+		}
+		else
+		{
+			// The transition is a write this stage already waited for
+			state = {layout, stages, 0, stages};
+		}
+	}
+	else if (state.writeStages != 0 && (state.readStages & stages) != stages)
+	{
+		batch.srcStages |= state.writeStages;
+		batch.dstStages |= stages;
+		batch.barriers.push_back({resourceIndex, layout, layout, state.writeAccess, accessFlags});
+		state.readStages |= stages;
+	}
+	else
+	{
+		state.readStages |= stages;
+	}
+}
+
+void RenderGraph::createRenderPass(PhysicalPass& physicalPass, const RenderPassDesc& desc)
+{
+	uint32_t nSubpasses = (uint32_t) physicalPass.passes.size();
+
+	std::vector<VkSubpassDescription> subpasses(nSubpasses);
+	for (uint32_t i = 0; i < nSubpasses; ++i)
+	{
+		VkSubpassDescription& subpass = subpasses[i];
+		subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = (uint32_t) desc.colorReferences[i].size();
+		subpass.pColorAttachments = desc.colorReferences[i].data();
+		subpass.inputAttachmentCount = (uint32_t) desc.inputReferences[i].size();
+		subpass.pInputAttachments = desc.inputReferences[i].data();
+		subpass.pDepthStencilAttachment = desc.depthReferences[i].attachment != VK_ATTACHMENT_UNUSED ? &desc.depthReferences[i] : nullptr;
+		subpass.preserveAttachmentCount = (uint32_t) desc.preserveAttachments[i].size();
+		subpass.pPreserveAttachments = desc.preserveAttachments[i].data();
+	}
+
+	VkRenderPassCreateInfo renderPassCreateInfo = {};
+	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassCreateInfo.attachmentCount = (uint32_t) desc.attachments.size();
+	renderPassCreateInfo.pAttachments = desc.attachments.data();
+	renderPassCreateInfo.subpassCount = nSubpasses;
+	renderPassCreateInfo.pSubpasses = subpasses.data();
+	renderPassCreateInfo.dependencyCount = (uint32_t) desc.dependencies.size();
+	renderPassCreateInfo.pDependencies = desc.dependencies.data();
+
+	CALL_VK(vkCreateRenderPass(m_logicalDevice, &renderPassCreateInfo, nullptr, &physicalPass.renderPass));
+
+	// Compatibility only depends on the attachment formats and how subpasses reference them
+	uint64_t hash = HASH_SEED;
+	hashCombine(hash, nSubpasses);
+	for (const VkAttachmentDescription& attachment : desc.attachments)
+	{
+		hashCombine(hash, attachment.format);
+		hashCombine(hash, attachment.samples);
+	}
+	for (uint32_t i = 0; i < nSubpasses; ++i)
+	{
+		for (const VkAttachmentReference& reference : desc.colorReferences[i])
+		{
+			hashCombine(hash, reference.attachment);
+		}
+		hashCombine(hash, VK_ATTACHMENT_UNUSED);
+		for (const VkAttachmentReference& reference : desc.inputReferences[i])
+		{
+			hashCombine(hash, reference.attachment);
+		}
+		hashCombine(hash, VK_ATTACHMENT_UNUSED);
+		hashCombine(hash, desc.depthReferences[i].attachment);
+	}
+	physicalPass.renderPassHash = hash;
+
+	// Imported attachments need a framebuffer per image
+	size_t nFramebuffers = 1;
+	for (uint32_t resource : physicalPass.attachments)
+	{
+		nFramebuffers = std::max(nFramebuffers, m_resources[resource].views.size());
+	}
+
+	std::vector<VkImageView> views(physicalPass.attachments.size());
+	physicalPass.framebuffers.resize(nFramebuffers);
+	for (size_t i = 0; i < nFramebuffers; ++i)
+	{
+		for (size_t attachment = 0; attachment < views.size(); ++attachment)
+		{
+			const Resource& resource = m_resources[physicalPass.attachments[attachment]];
+			views[attachment] = resource.views.size() > 1 ? resource.views[i] : resource.views[0];
+		}
+
+		VkFramebufferCreateInfo framebufferCreateInfo = {};
+		framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferCreateInfo.renderPass = physicalPass.renderPass;
+		framebufferCreateInfo.attachmentCount = (uint32_t) views.size();
+		framebufferCreateInfo.pAttachments = views.data();
+		framebufferCreateInfo.width = physicalPass.extent.width;
+		framebufferCreateInfo.height = physicalPass.extent.height;
+		framebufferCreateInfo.layers = 1;
+
+		CALL_VK(vkCreateFramebuffer(m_logicalDevice, &framebufferCreateInfo, nullptr, &physicalPass.framebuffers[i]));
+	}
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+	bool isFirstExecute = m_isFirstExecute;
+	if (m_isFirstExecute)
+	{
+		recordBarriers(commandBuffer, m_initialBarriers, imageIndex);
+		m_isFirstExecute = false;
+	}
+
+	for (const PhysicalPass& physicalPass : m_physicalPasses)
+	{
+		// New images have no contents to keep, conditional passes run at least once
+		const RenderGraphPass& firstPass = m_passes[physicalPass.passes[0]];
+		if (!isFirstExecute && firstPass.m_condition && !firstPass.m_condition())
+		{
+			continue;
+		}
+
+		recordBarriers(commandBuffer, physicalPass.barriers, imageIndex);
+
+		if (physicalPass.type != RenderGraphPassType::GRAPHICS)
+		{
+			for (uint32_t passIndex : physicalPass.passes)
+			{
+				const RenderGraphPass& pass = m_passes[passIndex];
+				if (pass.m_record)
+				{
+					pass.m_record(commandBuffer);
+				}
+			}
+			continue;
+		}
+
+		VkRenderPassBeginInfo renderPassBeginInfo = {};
+		renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassBeginInfo.renderPass = physicalPass.renderPass;
+		renderPassBeginInfo.framebuffer = physicalPass.framebuffers[physicalPass.framebuffers.size() > 1 ? imageIndex : 0];
+		renderPassBeginInfo.renderArea.offset = {0, 0};
+		renderPassBeginInfo.renderArea.extent = physicalPass.extent;
+		if (firstPass.m_renderArea)
+		{
+			VkExtent2D renderArea = firstPass.m_renderArea();
+			renderPassBeginInfo.renderArea.extent.width = std::min(renderArea.width, physicalPass.extent.width);
+			renderPassBeginInfo.renderArea.extent.height = std::min(renderArea.height, physicalPass.extent.height);
+		}
+		renderPassBeginInfo.clearValueCount = (uint32_t) physicalPass.clearValues.size();
+		renderPassBeginInfo.pClearValues = physicalPass.clearValues.data();
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		for (uint32_t subpass = 0; subpass < physicalPass.passes.size(); ++subpass)
+		{
+			if (subpass > 0)
+			{
+				vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+			}
+
+			const RenderGraphPass& pass = m_passes[physicalPass.passes[subpass]];
+			if (pass.m_record)
+			{
+				pass.m_record(commandBuffer);
+			}
+		}
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	recordBarriers(commandBuffer, m_finalBarriers, imageIndex);
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch, uint32_t imageIndex)
+{
+	if (batch.barriers.empty())
+	{
+		return;
+	}
+
+	m_imageBarriers.clear();
+	m_bufferBarriers.clear();
+
+	for (const Barrier& barrier : batch.barriers)
+	{
+		const Resource& resource = m_resources[barrier.resource];
+
+		if (!resource.isImage)
+		{
+			VkBufferMemoryBarrier bufferBarrier = {};
+			bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			bufferBarrier.srcAccessMask = barrier.srcAccess;
+			bufferBarrier.dstAccessMask = barrier.dstAccess;
+			bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.buffer = resource.buffer;
+			bufferBarrier.offset = 0;
+			bufferBarrier.size = VK_WHOLE_SIZE;
+			m_bufferBarriers.push_back(bufferBarrier);
+			continue;
+		}
+
+		VkImageMemoryBarrier imageBarrier = {};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.srcAccessMask = barrier.srcAccess;
+		imageBarrier.dstAccessMask = barrier.dstAccess;
+		imageBarrier.oldLayout = barrier.oldLayout;
+		imageBarrier.newLayout = barrier.newLayout;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = resource.images.size() > 1 ? resource.images[imageIndex] : resource.images[0];
+		imageBarrier.subresourceRange.aspectMask = !isDepthFormat(resource.format) ? VK_IMAGE_ASPECT_COLOR_BIT :
+		                                           hasStencil(resource.format) ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+		imageBarrier.subresourceRange.baseMipLevel = 0;
+		imageBarrier.subresourceRange.levelCount = 1;
+		imageBarrier.subresourceRange.baseArrayLayer = 0;
+		imageBarrier.subresourceRange.layerCount = 1;
+		m_imageBarriers.push_back(imageBarrier);
+	}
+
+	vkCmdPipelineBarrier(commandBuffer, batch.srcStages, batch.dstStages, 0,
+	                     0, nullptr,
+	                     (uint32_t) m_bufferBarriers.size(), m_bufferBarriers.data(),
+	                     (uint32_t) m_imageBarriers.size(), m_imageBarriers.data());
+}
+
+const RenderGraphPass& RenderGraph::getPass(const std::string& pass) const
+{
+	auto it = m_passIndexes.find(pass);
+	if (it == m_passIndexes.end())
+	{
+		__android_log_assert("Unknown render graph pass.", nullptr, "%s", pass.c_str());
+	}
+
+	return m_passes[it->second];
+}
+
+bool RenderGraph::isCulled(const std::string& pass) const
+{
+	return getPass(pass).m_isCulled;
+}
+
+VkRenderPass RenderGraph::getRenderPass(const std::string& pass) const
+{
+	const RenderGraphPass& graphPass = getPass(pass);
+	return graphPass.m_isCulled ? VK_NULL_HANDLE : m_physicalPasses[graphPass.m_physicalPass].renderPass;
+}
+
+uint32_t RenderGraph::getSubpass(const std::string& pass) const
+{
+	return getPass(pass).m_subpass;
+}
+
+uint64_t RenderGraph::getRenderPassHash(const std::string& pass) const
+{
+	const RenderGraphPass& graphPass = getPass(pass);
+	return graphPass.m_isCulled ? 0 : m_physicalPasses[graphPass.m_physicalPass].renderPassHash;
+}
+
+VkImageView RenderGraph::getImageView(const std::string& image) const
+{
+	auto it = m_resourceIndexes.find(image);
+	if (it == m_resourceIndexes.end() || m_resources[it->second].views.empty())
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	return m_resources[it->second].views[0];
+}
+
+uint32_t RenderGraph::findMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags propertyFlags) const
+{
+	for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i)
+	{
+		if ((memoryTypeBits & (1u << i)) != 0 && (m_memoryProperties.memoryTypes[i].propertyFlags & propertyFlags) == propertyFlags)
+		{
+			return i;
+		}
+	}
+
+	return INVALID_INDEX;
+}
+
+bool RenderGraph::isAttachment(RenderGraphAccess access)
+{
+	return access == RenderGraphAccess::COLOR_ATTACHMENT ||
+	       access == RenderGraphAccess::DEPTH_ATTACHMENT ||
+	       access == RenderGraphAccess::INPUT_ATTACHMENT;
+}
+
+bool RenderGraph::isWrite(RenderGraphAccess access)
+{
+	return access == RenderGraphAccess::COLOR_ATTACHMENT ||
+	       access == RenderGraphAccess::DEPTH_ATTACHMENT ||
+	       access == RenderGraphAccess::STORAGE_WRITE ||
+	       access == RenderGraphAccess::TRANSFER_DESTINATION;
+}
+
+bool RenderGraph::isDepthFormat(VkFormat format)
+{
+	switch (format)
+	{
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+bool RenderGraph::hasStencil(VkFormat format)
+{
+	return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+VkImageLayout RenderGraph::getLayout(RenderGraphAccess access, VkFormat format)
+{
+	switch (access)
+	{
+		case RenderGraphAccess::COLOR_ATTACHMENT:
+			return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		case RenderGraphAccess::DEPTH_ATTACHMENT:
+			return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		case RenderGraphAccess::INPUT_ATTACHMENT:
+		case RenderGraphAccess::SAMPLED:
+			return isDepthFormat(format) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		case RenderGraphAccess::STORAGE_READ:
+		case RenderGraphAccess::STORAGE_WRITE:
+			return VK_IMAGE_LAYOUT_GENERAL;
+
+		case RenderGraphAccess::TRANSFER_SOURCE:
+			return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+		case RenderGraphAccess::TRANSFER_DESTINATION:
+			return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	}
+
+	return VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+VkPipelineStageFlags RenderGraph::getStages(RenderGraphAccess access, RenderGraphPassType type)
+{
+	switch (access)
+	{
+		case RenderGraphAccess::COLOR_ATTACHMENT:
+			return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+		case RenderGraphAccess::DEPTH_ATTACHMENT:
+			return VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+		case RenderGraphAccess::INPUT_ATTACHMENT:
+			return VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+		case RenderGraphAccess::SAMPLED:
+		case RenderGraphAccess::STORAGE_READ:
+		case RenderGraphAccess::STORAGE_WRITE:
+			return type == RenderGraphPassType::GRAPHICS ? VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT :
+			       type == RenderGraphPassType::COMPUTE ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+		case RenderGraphAccess::TRANSFER_SOURCE:
+		case RenderGraphAccess::TRANSFER_DESTINATION:
+			return VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+
+	return VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+}
+
+VkAccessFlags RenderGraph::getAccessFlags(RenderGraphAccess access)
+{
+	switch (access)
+	{
+		case RenderGraphAccess::COLOR_ATTACHMENT:
+			return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+		case RenderGraphAccess::DEPTH_ATTACHMENT:
+			return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		case RenderGraphAccess::INPUT_ATTACHMENT:
+			return VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+
+		case RenderGraphAccess::SAMPLED:
+		case RenderGraphAccess::STORAGE_READ:
+			return VK_ACCESS_SHADER_READ_BIT;
+
+		case RenderGraphAccess::STORAGE_WRITE:
+			return VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		case RenderGraphAccess::TRANSFER_SOURCE:
+			return VK_ACCESS_TRANSFER_READ_BIT;
+
+		case RenderGraphAccess::TRANSFER_DESTINATION:
+			return VK_ACCESS_TRANSFER_WRITE_BIT;
+	}
+
+	return 0;
+}
+
+VkImageUsageFlags RenderGraph::getUsage(RenderGraphAccess access)
+{
+	switch (access)
+	{
+		case RenderGraphAccess::COLOR_ATTACHMENT:
+			return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+		case RenderGraphAccess::DEPTH_ATTACHMENT:
+			return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+		case RenderGraphAccess::INPUT_ATTACHMENT:
+			return VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+		case RenderGraphAccess::SAMPLED:
+			return VK_IMAGE_USAGE_SAMPLED_BIT;
+
+		case RenderGraphAccess::STORAGE_READ:
+		case RenderGraphAccess::STORAGE_WRITE:
+			return VK_IMAGE_USAGE_STORAGE_BIT;
+
+		case RenderGraphAccess::TRANSFER_SOURCE:
+			return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+		case RenderGraphAccess::TRANSFER_DESTINATION:
+			return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	}
+
+	return 0;
+}
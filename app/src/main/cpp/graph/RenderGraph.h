@@ -0,0 +1,313 @@
+#pragma once
+
+#include "../vulkan_wrapper.h"
+#include "../memory/DeletionQueue.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class RenderGraphPassType : uint8_t
+{
+	GRAPHICS,
+	COMPUTE,
+	TRANSFER
+};
+
+enum class RenderGraphAccess : uint8_t
+{
+	COLOR_ATTACHMENT,
+	DEPTH_ATTACHMENT,
+	INPUT_ATTACHMENT,
+	SAMPLED,
+	STORAGE_READ,
+	STORAGE_WRITE,
+	TRANSFER_SOURCE,
+	TRANSFER_DESTINATION
+};
+
+struct RenderGraphImageDesc
+{
+	VkFormat format;
+	VkExtent2D extent;
+	VkSampleCountFlagBits samples;
+
+	// Contents are kept for the next frame, the image is then never aliased
+	bool isPersistent;
+
+	// Single sampled and not persistent
+	RenderGraphImageDesc(VkFormat format, VkExtent2D extent);
+};
+
+class RenderGraphPass
+{
+public:
+	typedef std::function<void(VkCommandBuffer commandBuffer)> RecordFunction;
+	typedef std::function<bool()> ConditionFunction;
+	typedef std::function<VkExtent2D()> RenderAreaFunction;
+
+	// Without a clear value the contents written by earlier passes are kept
+	void addColorOutput(const std::string& image, const VkClearColorValue* pClearValue = nullptr);
+	void setDepthOutput(const std::string& image, const VkClearDepthStencilValue* pClearValue = nullptr);
+
+	// Read at the same pixel, passes only connected this way share a render pass
+	void addInputAttachment(const std::string& image);
+
+	void addSampledImage(const std::string& image);
+	void addStorageRead(const std::string& resource);
+	void addStorageWrite(const std::string& resource);
+	void addTransferSource(const std::string& resource);
+	void addTransferDestination(const std::string& resource);
+
+	// Called inside the pass's subpass for graphics passes
+	void setRecord(const RecordFunction& record);
+
+	// Checked by every execute(), the pass is skipped while it returns false and
+	// its outputs keep their contents. Only for graphics passes that use nothing
+	// but persistent attachments, they get a render pass of their own.
+	void setCondition(const ConditionFunction& condition);
+
+	// Checked by every execute() as well, graphics passes then only draw into the
+	// top left corner of their attachments. Passes merged into one render pass
+	// share the area of the first.
+	void setRenderArea(const RenderAreaFunction& renderArea);
+
+private:
+	friend class RenderGraph;
+
+	struct Use
+	{
+		std::string name;
+		uint32_t resource;
+		RenderGraphAccess access;
+		bool isCleared;
+		VkClearValue clearValue;
+	};
+
+	RenderGraphPass(const std::string& name, RenderGraphPassType type);
+	void addUse(const std::string& name, RenderGraphAccess access, const VkClearValue* pClearValue);
+
+private:
+	std::string m_name;
+	RenderGraphPassType m_type;
+	std::vector<Use> m_uses;
+	RecordFunction m_record;
+	ConditionFunction m_condition;
+	RenderAreaFunction m_renderArea;
+
+	// Set by RenderGraph::compile()
+	bool m_isCulled;
+	uint32_t m_physicalPass;
+	uint32_t m_subpass;
+};
+
+/*
+ * Frame structure as passes that read and write named resources. compile()
+ * works out everything that used to be written by hand:
+ *
+ *  - passes that contribute to no output are culled
+ *  - consecutive graphics passes only connected through attachments are merged
+ *    into the subpasses of one VkRenderPass, so tilers keep the data on chip
+ *  - load / store ops, layouts, subpass dependencies and pipeline barriers
+ *    follow from the order of the accesses, including the hazards between
+ *    consecutive frames that share the graph's images
+ *  - images only used within one render pass are TRANSIENT and lazily
+ *    allocated where the device allows it, other images whose lifetimes don't
+ *    overlap share memory
+ *  - conditional passes leave their attachments in the layout they found them
+ *    in, so skipping them needs no other barriers
+ *
+ * The graph is compiled once per swapchain and executed every frame. reset()
+ * hands its Vulkan objects to the deletion queue, frames in flight may still
+ * use them.
+ */
+class RenderGraph
+{
+public:
+	RenderGraph();
+
+	void create(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, DeletionQueue* pDeletionQueue);
+
+	// Drops all passes and resources
+	void reset(uint64_t lastUseValue);
+
+	void addImage(const std::string& name, const RenderGraphImageDesc& desc);
+
+	// One image per swapchain image, execute() picks one. Undefined at the start
+	// of the frame and left in finalLayout.
+	void importImage(const std::string& name, VkFormat format, VkExtent2D extent,
+	                 const std::vector<VkImage>& images, const std::vector<VkImageView>& views, VkImageLayout finalLayout);
+	void importBuffer(const std::string& name, VkBuffer buffer);
+
+	// The reference stays valid until reset()
+	RenderGraphPass& addPass(const std::string& name, RenderGraphPassType type);
+
+	// Resources that are needed after the frame, passes not contributing to one are culled
+	void addOutput(const std::string& resource);
+
+	void compile();
+
+	// imageIndex selects the image of imported images
+	void execute(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+	bool isCulled(const std::string& pass) const;
+
+	// Of graphics passes, for creating their pipelines
+	VkRenderPass getRenderPass(const std::string& pass) const;
+	uint32_t getSubpass(const std::string& pass) const;
+	uint64_t getRenderPassHash(const std::string& pass) const;
+
+	// Of images added to the graph, e.g. for descriptors of later passes
+	VkImageView getImageView(const std::string& image) const;
+
+private:
+	struct AccessState
+	{
+		VkImageLayout layout;
+		VkPipelineStageFlags writeStages;
+		VkAccessFlags writeAccess;
+		// Stages that waited for the last write (or transition) already
+		VkPipelineStageFlags readStages;
+	};
+
+	struct Resource
+	{
+		std::string name;
+		bool isImage;
+		bool isImported;
+		bool isPersistent;
+		bool isTransient;
+
+		VkFormat format;
+		VkExtent2D extent;
+		VkSampleCountFlagBits samples;
+		VkImageUsageFlags usage;
+		VkImageLayout finalLayout;
+
+		// Several for imported images
+		std::vector<VkImage> images;
+		std::vector<VkImageView> views;
+		VkBuffer buffer;
+
+		// Owned images only, aliased images share the memory of their block
+		VkDeviceMemory memory;
+		uint32_t memoryBlock;
+		// Previous image in the block, the last one for the first
+		uint32_t aliasPredecessor;
+
+		bool isNeeded;
+		uint32_t firstPass;
+		uint32_t lastPass;
+
+		AccessState state;
+		bool isTouched;
+	};
+
+	struct MemoryBlock
+	{
+		VkDeviceMemory memory;
+		VkDeviceSize size;
+		VkDeviceSize alignment;
+		uint32_t memoryTypeBits;
+		uint32_t lastPass;
+		uint32_t lastResource;
+	};
+
+	struct Barrier
+	{
+		uint32_t resource;
+		VkImageLayout oldLayout;
+		VkImageLayout newLayout;
+		VkAccessFlags srcAccess;
+		VkAccessFlags dstAccess;
+	};
+
+	struct BarrierBatch
+	{
+		VkPipelineStageFlags srcStages;
+		VkPipelineStageFlags dstStages;
+		std::vector<Barrier> barriers;
+	};
+
+	struct PhysicalPass
+	{
+		RenderGraphPassType type;
+		// Logical passes, in subpass order for graphics passes
+		std::vector<uint32_t> passes;
+		BarrierBatch barriers;
+
+		VkExtent2D extent;
+		std::vector<uint32_t> attachments;
+		std::vector<VkClearValue> clearValues;
+		VkRenderPass renderPass;
+		uint64_t renderPassHash;
+		// One per image of imported attachments
+		std::vector<VkFramebuffer> framebuffers;
+	};
+
+	// Everything describing a graphics pass' VkRenderPass, filled while simulating
+	struct RenderPassDesc
+	{
+		std::vector<VkAttachmentDescription> attachments;
+		std::vector<std::vector<VkAttachmentReference>> colorReferences;
+		std::vector<std::vector<VkAttachmentReference>> inputReferences;
+		std::vector<VkAttachmentReference> depthReferences;
+		std::vector<std::vector<uint32_t>> preserveAttachments;
+		std::vector<VkSubpassDependency> dependencies;
+	};
+
+	uint32_t addResource(const std::string& name);
+	const RenderGraphPass& getPass(const std::string& pass) const;
+
+	void cullPasses();
+	void groupPasses();
+	void createImages();
+	void allocateMemory();
+	void simulate(std::vector<RenderPassDesc>& renderPassDescs);
+	void simulateGraphicsPass(PhysicalPass& physicalPass, uint32_t physicalIndex, RenderPassDesc& desc);
+	void addBarrier(BarrierBatch& batch, uint32_t resource, RenderGraphAccess access, RenderGraphPassType type);
+	void touch(uint32_t resource);
+	void createRenderPass(PhysicalPass& physicalPass, const RenderPassDesc& desc);
+	void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch, uint32_t imageIndex);
+
+	bool canMerge(const PhysicalPass& physicalPass, const RenderGraphPass& pass) const;
+	uint32_t findMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags propertyFlags) const;
+
+	static bool isAttachment(RenderGraphAccess access);
+	static bool isWrite(RenderGraphAccess access);
+	static bool isDepthFormat(VkFormat format);
+	static bool hasStencil(VkFormat format);
+	static VkImageLayout getLayout(RenderGraphAccess access, VkFormat format);
+	static VkPipelineStageFlags getStages(RenderGraphAccess access, RenderGraphPassType type);
+	static VkAccessFlags getAccessFlags(RenderGraphAccess access);
+	static VkImageUsageFlags getUsage(RenderGraphAccess access);
+
+private:
+	VkDevice m_logicalDevice;
+	VkPhysicalDeviceMemoryProperties m_memoryProperties;
+	DeletionQueue* m_pDeletionQueue;
+
+	std::vector<Resource> m_resources;
+	std::unordered_map<std::string, uint32_t> m_resourceIndexes;
+	std::vector<uint32_t> m_outputs;
+
+	// Passes never move, references are handed out
+	std::deque<RenderGraphPass> m_passes;
+	std::unordered_map<std::string, uint32_t> m_passIndexes;
+
+	std::vector<PhysicalPass> m_physicalPasses;
+	std::vector<MemoryBlock> m_memoryBlocks;
+
+	// Transitions imported images to their final layout where no render pass does
+	BarrierBatch m_finalBarriers;
+	// Persistent images start undefined, once after compile()
+	BarrierBatch m_initialBarriers;
+	bool m_isFirstExecute;
+
+	// Reused by recordBarriers()
+	std::vector<VkImageMemoryBarrier> m_imageBarriers;
+	std::vector<VkBufferMemoryBarrier> m_bufferBarriers;
+};
@@ -0,0 +1,126 @@
+#include "InputQueue.h"
+
+#include <algorithm>
+
+InputQueue::InputQueue() :
+		m_pointerId(-1),
+		m_isDragging(false),
+		m_lastX(0.0f),
+		m_lastY(0.0f)
+{
+}
+
+bool InputQueue::onInputEvent(const AInputEvent* pEvent)
+{
+	if (AInputEvent_getType(pEvent) != AINPUT_EVENT_TYPE_MOTION)
+	{
+		return false;
+	}
+
+	int32_t action = AMotionEvent_getAction(pEvent);
+	int32_t actionIndex = (action & AMOTION_EVENT_ACTION_POINTER_INDEX_MASK) >> AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT;
+
+	switch (action & AMOTION_EVENT_ACTION_MASK)
+	{
+		case AMOTION_EVENT_ACTION_DOWN:
+			m_pointerId = AMotionEvent_getPointerId(pEvent, 0);
+			pushSample(TouchSample::DOWN, AMotionEvent_getEventTime(pEvent), AMotionEvent_getX(pEvent, 0), AMotionEvent_getY(pEvent, 0));
+			return true;
+
+		case AMOTION_EVENT_ACTION_MOVE:
+		{
+			size_t nPointers = AMotionEvent_getPointerCount(pEvent);
+			for (size_t pointerIndex = 0; pointerIndex < nPointers; ++pointerIndex)
+			{
+				if (AMotionEvent_getPointerId(pEvent, pointerIndex) != m_pointerId)
+				{
+					continue;
+				}
+
+				// Samples batched since the previous event, oldest first
+				size_t nHistory = AMotionEvent_getHistorySize(pEvent);
+				for (size_t h = 0; h < nHistory; ++h)
+				{
+					pushSample(TouchSample::MOVE, AMotionEvent_getHistoricalEventTime(pEvent, h),
+					           AMotionEvent_getHistoricalX(pEvent, pointerIndex, h), AMotionEvent_getHistoricalY(pEvent, pointerIndex, h));
+				}
+				pushSample(TouchSample::MOVE, AMotionEvent_getEventTime(pEvent), AMotionEvent_getX(pEvent, pointerIndex), AMotionEvent_getY(pEvent, pointerIndex));
+			}
+			return true;
+		}
+
+		case AMOTION_EVENT_ACTION_POINTER_UP:
+			if (AMotionEvent_getPointerId(pEvent, actionIndex) != m_pointerId)
+			{
+				return true;
+			}
+			// The dragging finger left, the others don't take over
+			// FALLTHROUGH
+		case AMOTION_EVENT_ACTION_UP:
+		case AMOTION_EVENT_ACTION_CANCEL:
+			pushSample(TouchSample::UP, AMotionEvent_getEventTime(pEvent), 0.0f, 0.0f);
+			m_pointerId = -1;
+			return true;
+
+		default:
+			return true;
+	}
+}
+
+void InputQueue::pushSample(TouchSample::Type type, int64_t timeNanos, float x, float y)
+{
+	TouchSample sample = {};
+	sample.type = type;
+	sample.timeNanos = timeNanos;
+	sample.x = x;
+	sample.y = y;
+	m_samples.push_back(sample);
+}
+
+TouchDelta InputQueue::consume()
+{
+	TouchDelta delta;
+	if (m_samples.empty())
+	{
+		return delta;
+	}
+
+	// Events are delivered in order, historical samples keep it within an event
+	std::stable_sort(m_samples.begin(), m_samples.end(), [](const TouchSample& a, const TouchSample& b)
+	{
+		return a.timeNanos < b.timeNanos;
+	});
+
+	for (const TouchSample& sample : m_samples)
+	{
+		switch (sample.type)
+		{
+			case TouchSample::DOWN:
+				m_isDragging = true;
+				break;
+
+			case TouchSample::MOVE:
+				if (m_isDragging)
+				{
+					delta.x += sample.x - m_lastX;
+					delta.y += sample.y - m_lastY;
+				}
+				break;
+
+			case TouchSample::UP:
+				m_isDragging = false;
+				continue;
+		}
+
+		m_lastX = sample.x;
+		m_lastY = sample.y;
+	}
+
+	delta.nSamples = (uint32_t) m_samples.size();
+	delta.latestTimeNanos = m_samples.back().timeNanos;
+
+	// Keeps its capacity, no allocations once the queue saw a busy frame
+	m_samples.clear();
+
+	return delta;
+}
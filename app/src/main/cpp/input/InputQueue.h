@@ -0,0 +1,63 @@
+#pragma once
+
+#include <android/input.h>
+
+#include <cstdint>
+#include <vector>
+
+struct TouchSample
+{
+	enum Type
+	{
+		DOWN,
+		MOVE,
+		UP
+	};
+
+	Type type;
+	int64_t timeNanos;
+	float x;
+	float y;
+};
+
+// Everything the touch input did since the previous frame
+struct TouchDelta
+{
+	float x = 0.0f;
+	float y = 0.0f;
+
+	uint32_t nSamples = 0;
+	// AMotionEvent time base (CLOCK_MONOTONIC), 0 without samples
+	int64_t latestTimeNanos = 0;
+};
+
+/*
+ * Collects motion events as they are delivered, including the historical
+ * samples Android batches into each ACTION_MOVE, and turns them into a single
+ * drag delta once per frame. The simulation then updates the camera once no
+ * matter how many events arrived.
+ */
+class InputQueue
+{
+public:
+	InputQueue();
+
+	// From onInputEvent, returns true when the event was used
+	bool onInputEvent(const AInputEvent* pEvent);
+
+	// Accumulates and clears the pending samples
+	TouchDelta consume();
+
+private:
+	void pushSample(TouchSample::Type type, int64_t timeNanos, float x, float y);
+
+private:
+	std::vector<TouchSample> m_samples;
+
+	// Only the first finger drags
+	int32_t m_pointerId;
+
+	bool m_isDragging;
+	float m_lastX;
+	float m_lastY;
+};
@@ -0,0 +1,453 @@
+#include "JobSystem.h"
+
+#include <chrono>
+#include <cstdio>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+// Failed searches before an idle worker goes to sleep
+const uint32_t IDLE_SPINS = 64;
+
+// Bounds the cost of a wake up lost between the search and going to sleep
+const std::chrono::milliseconds SLEEP_TIMEOUT(1);
+
+static thread_local JobSystem* t_pJobSystem = nullptr;
+static thread_local int32_t t_workerIndex = -1;
+static thread_local uint32_t t_randomState = 0x9E3779B9;
+
+static uint32_t nextRandom()
+{
+	// xorshift32, only used to spread thieves over the victims
+	t_randomState ^= t_randomState << 13;
+	t_randomState ^= t_randomState >> 17;
+	t_randomState ^= t_randomState << 5;
+	return t_randomState;
+}
+
+static uint32_t readMaxFrequency(uint32_t core)
+{
+	char path[96];
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cpufreq/cpuinfo_max_freq", core);
+
+	FILE* file = fopen(path, "r");
+	if (file == nullptr)
+	{
+		return 0;
+	}
+
+	unsigned int frequency = 0;
+	if (fscanf(file, "%u", &frequency) != 1)
+	{
+		frequency = 0;
+	}
+	fclose(file);
+
+	return frequency;
+}
+
+// Cores the workers may run on
+static std::vector<uint32_t> getCores(CoreAffinity affinity)
+{
+	uint32_t nCores = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<uint32_t> frequencies(nCores);
+	uint32_t maxFrequency = 0;
+	if (affinity == CoreAffinity::BIG_CORES)
+	{
+		for (uint32_t core = 0; core < nCores; ++core)
+		{
+			frequencies[core] = readMaxFrequency(core);
+			maxFrequency = std::max(maxFrequency, frequencies[core]);
+		}
+	}
+
+	// Without cpufreq every core counts as big
+	std::vector<uint32_t> cores;
+	for (uint32_t core = 0; core < nCores; ++core)
+	{
+		if (frequencies[core] == maxFrequency)
+		{
+			cores.push_back(core);
+		}
+	}
+
+	return cores;
+}
+
+static void setAffinity(const std::vector<uint32_t>& cores)
+{
+#ifdef __linux__
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	for (uint32_t core : cores)
+	{
+		CPU_SET(core, &cpuSet);
+	}
+
+	// Best effort, the cores can be offline or reserved
+	sched_setaffinity(0, sizeof(cpuSet), &cpuSet);
+#endif
+}
+
+JobSystem::JobSystem() :
+		m_isRunning(false),
+		m_jobPool(JOB_POOL_SIZE),
+		m_jobsInUse(JOB_POOL_SIZE),
+		m_nextJob(0),
+		m_nSharedJobs(0),
+		m_nBackgroundJobs(0),
+		m_nSleeping(0)
+{
+}
+
+JobSystem::~JobSystem()
+{
+	stop();
+}
+
+void JobSystem::start(const JobSystemSettings& settings)
+{
+	if (m_isRunning.load())
+	{
+		return;
+	}
+
+	std::vector<uint32_t> cores = getCores(settings.affinity);
+
+	uint32_t nWorkers = settings.nWorkers;
+	if (nWorkers == 0)
+	{
+		nWorkers = std::max(1u, (uint32_t) cores.size() - 1);
+	}
+
+	// All deques exist before the first worker can try to steal
+	m_deques.clear();
+	for (uint32_t i = 0; i < nWorkers; ++i)
+	{
+		m_deques.emplace_back(new WorkStealingDeque<Job>(DEQUE_CAPACITY));
+	}
+
+	m_isRunning.store(true);
+	for (uint32_t i = 0; i < nWorkers; ++i)
+	{
+		std::vector<uint32_t> workerCores;
+		switch (settings.affinity)
+		{
+			case CoreAffinity::BIG_CORES:
+				workerCores = cores;
+				break;
+
+			case CoreAffinity::PIN_TO_CORES:
+				// Core 0 is left to the thread that started the system
+				workerCores.push_back(cores[(i + 1) % cores.size()]);
+				break;
+
+			default:
+				break;
+		}
+
+		m_workers.emplace_back(&JobSystem::workerMain, this, i, workerCores);
+	}
+}
+
+void JobSystem::stop()
+{
+	if (!m_isRunning.load())
+	{
+		return;
+	}
+
+	m_isRunning.store(false);
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_wakeCondition.notify_all();
+	}
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+	m_deques.clear();
+}
+
+void JobSystem::run(JobFunction function, void* pData, uint32_t begin, uint32_t end, JobCounter* pCounter, JobCounter* pDependency)
+{
+	Job* pJob = allocateJob();
+	pJob->function = function;
+	pJob->pData = pData;
+	pJob->begin = begin;
+	pJob->end = end;
+	pJob->pCounter = pCounter;
+	pJob->pNextContinuation = nullptr;
+
+	if (pCounter != nullptr)
+	{
+		pCounter->m_value.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (pDependency != nullptr)
+	{
+		std::lock_guard<std::mutex> lock(pDependency->m_mutex);
+		if (pDependency->m_value.load(std::memory_order_acquire) != 0)
+		{
+			// Pushed by the last job of the dependency
+			pJob->pNextContinuation = pDependency->m_pContinuations;
+			pDependency->m_pContinuations = pJob;
+			return;
+		}
+	}
+
+	push(pJob);
+}
+
+void JobSystem::runBackground(JobFunction function, void* pData, JobCounter* pCounter)
+{
+	Job job = {};
+	job.function = function;
+	job.pData = pData;
+	job.begin = 0;
+	job.end = 1;
+	job.pCounter = pCounter;
+
+	if (pCounter != nullptr)
+	{
+		pCounter->m_value.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_backgroundMutex);
+		m_backgroundJobs.push_back(job);
+		m_nBackgroundJobs.fetch_add(1, std::memory_order_release);
+	}
+
+	if (m_nSleeping.load(std::memory_order_relaxed) > 0)
+	{
+		m_wakeCondition.notify_one();
+	}
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	while (!counter.isDone())
+	{
+		Job* pJob = findJob();
+		if (pJob != nullptr)
+		{
+			execute(pJob);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// The last job may still hold the lock right after reaching zero
+	std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+Job* JobSystem::allocateJob()
+{
+	// Skips slots still pending, only a full ring can make this spin
+	for (;;)
+	{
+		uint32_t index = m_nextJob.fetch_add(1, std::memory_order_relaxed) & (JOB_POOL_SIZE - 1);
+
+		bool isInUse = false;
+		if (m_jobsInUse[index].compare_exchange_strong(isInUse, true, std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			return &m_jobPool[index];
+		}
+	}
+}
+
+void JobSystem::push(Job* pJob)
+{
+	if (t_pJobSystem == this && t_workerIndex >= 0)
+	{
+		if (!m_deques[t_workerIndex]->push(pJob))
+		{
+			// Deque full, nobody would be faster than running it right here
+			execute(pJob);
+			return;
+		}
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(m_sharedMutex);
+		m_sharedJobs.push_back(pJob);
+		m_nSharedJobs.fetch_add(1, std::memory_order_release);
+	}
+
+	if (m_nSleeping.load(std::memory_order_relaxed) > 0)
+	{
+		m_wakeCondition.notify_one();
+	}
+}
+
+Job* JobSystem::findJob()
+{
+	bool isWorker = t_pJobSystem == this && t_workerIndex >= 0;
+	if (isWorker)
+	{
+		Job* pJob = m_deques[t_workerIndex]->pop();
+		if (pJob != nullptr)
+		{
+			return pJob;
+		}
+	}
+
+	if (m_nSharedJobs.load(std::memory_order_acquire) > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_sharedMutex);
+		if (!m_sharedJobs.empty())
+		{
+			Job* pJob = m_sharedJobs.front();
+			m_sharedJobs.pop_front();
+			m_nSharedJobs.fetch_sub(1, std::memory_order_relaxed);
+			return pJob;
+		}
+	}
+
+	uint32_t nDeques = (uint32_t) m_deques.size();
+	if (nDeques == 0)
+	{
+		return nullptr;
+	}
+
+	uint32_t firstVictim = nextRandom() % nDeques;
+	for (uint32_t i = 0; i < nDeques; ++i)
+	{
+		uint32_t victim = (firstVictim + i) % nDeques;
+		if (isWorker && victim == (uint32_t) t_workerIndex)
+		{
+			continue;
+		}
+
+		Job* pJob = m_deques[victim]->steal();
+		if (pJob != nullptr)
+		{
+			return pJob;
+		}
+	}
+
+	return nullptr;
+}
+
+bool JobSystem::popBackgroundJob(Job* pJob)
+{
+	if (m_nBackgroundJobs.load(std::memory_order_acquire) == 0)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_backgroundMutex);
+	if (m_backgroundJobs.empty())
+	{
+		return false;
+	}
+
+	*pJob = m_backgroundJobs.front();
+	m_backgroundJobs.pop_front();
+	m_nBackgroundJobs.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+void JobSystem::execute(Job* pJob)
+{
+	// The slot is free for the next job as soon as it is copied
+	Job job = *pJob;
+	m_jobsInUse[pJob - m_jobPool.data()].store(false, std::memory_order_release);
+
+	invoke(job);
+}
+
+void JobSystem::invoke(const Job& job)
+{
+	job.function(job);
+
+	if (job.pCounter != nullptr)
+	{
+		finish(*job.pCounter);
+	}
+}
+
+void JobSystem::finish(JobCounter& counter)
+{
+	// Only the last job of a group needs the lock
+	uint32_t value = counter.m_value.load(std::memory_order_relaxed);
+	while (value > 1)
+	{
+		if (counter.m_value.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+		{
+			return;
+		}
+	}
+
+	Job* pContinuation;
+	{
+		std::lock_guard<std::mutex> lock(counter.m_mutex);
+		if (counter.m_value.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		{
+			// More jobs were added to the group in the meantime
+			return;
+		}
+
+		pContinuation = counter.m_pContinuations;
+		counter.m_pContinuations = nullptr;
+	}
+
+	// The counter may be gone from here on
+	while (pContinuation != nullptr)
+	{
+		Job* pNext = pContinuation->pNextContinuation;
+		push(pContinuation);
+		pContinuation = pNext;
+	}
+}
+
+void JobSystem::workerMain(uint32_t workerIndex, const std::vector<uint32_t>& cores)
+{
+	t_pJobSystem = this;
+	t_workerIndex = (int32_t) workerIndex;
+	t_randomState += workerIndex * 0x6C8E9CF5;
+
+	if (!cores.empty())
+	{
+		setAffinity(cores);
+	}
+
+	uint32_t nIdle = 0;
+	while (m_isRunning.load(std::memory_order_relaxed))
+	{
+		Job* pJob = findJob();
+		if (pJob != nullptr)
+		{
+			execute(pJob);
+			nIdle = 0;
+			continue;
+		}
+
+		// Only once nothing short is left, waiting threads count on that
+		Job backgroundJob;
+		if (popBackgroundJob(&backgroundJob))
+		{
+			invoke(backgroundJob);
+			nIdle = 0;
+			continue;
+		}
+
+		if (++nIdle < IDLE_SPINS)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_nSleeping.fetch_add(1, std::memory_order_relaxed);
+		m_wakeCondition.wait_for(lock, SLEEP_TIMEOUT);
+		m_nSleeping.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "WorkStealingDeque.h"
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+struct Job;
+typedef void (*JobFunction)(const Job& job);
+
+struct Job
+{
+	JobFunction function;
+	void* pData;
+
+	// Range of items processed by this job
+	uint32_t begin;
+	uint32_t end;
+
+	class JobCounter* pCounter;
+
+	// Next job started by the same dependency
+	Job* pNextContinuation;
+};
+
+/*
+ * Number of unfinished jobs of a group. Jobs can be made to start only once a
+ * counter reached zero, that is how dependencies between groups are expressed.
+ * A counter has to be waited on with JobSystem::wait() before it goes away.
+ */
+class JobCounter
+{
+public:
+	JobCounter() :
+			m_value(0),
+			m_pContinuations(nullptr)
+	{
+	}
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool isDone() const
+	{
+		return m_value.load(std::memory_order_acquire) == 0;
+	}
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> m_value;
+
+	// Only taken to register continuations and by the last job of the group
+	std::mutex m_mutex;
+	Job* m_pContinuations;
+};
+
+enum class CoreAffinity
+{
+	// Let the scheduler place the workers
+	NONE,
+	// Keep the workers on the fastest cluster of a big.LITTLE SoC
+	BIG_CORES,
+	// One worker per core
+	PIN_TO_CORES
+};
+
+struct JobSystemSettings
+{
+	// 0 picks one worker per core except the calling one
+	uint32_t nWorkers = 0;
+	CoreAffinity affinity = CoreAffinity::NONE;
+};
+
+/*
+ * Work stealing job scheduler: every worker owns a Chase-Lev deque it pushes to
+ * and pops from, idle workers steal from the others. Threads outside the system
+ * (android_main, the render thread) submit through a shared queue and help
+ * executing jobs while they wait on a counter.
+ *
+ * Jobs live in a fixed ring, a slot is only handed out again once its job was
+ * copied out for execution. No more than JOB_POOL_SIZE may be pending at once.
+ * Background jobs are queued apart and only run by idle workers, a thread
+ * waiting on a counter never gets stuck in one.
+ */
+class JobSystem
+{
+public:
+	JobSystem();
+	~JobSystem();
+
+	void start(const JobSystemSettings& settings = JobSystemSettings());
+	void stop();
+
+	uint32_t getWorkerCount() const
+	{
+		return (uint32_t) m_workers.size();
+	}
+
+	// Runs function over [begin, end) once pDependency (if any) is done.
+	void run(JobFunction function, void* pData, uint32_t begin, uint32_t end, JobCounter* pCounter, JobCounter* pDependency = nullptr);
+
+	// For long jobs like pipeline compiles, pCounter is waited on as usual
+	void runBackground(JobFunction function, void* pData, JobCounter* pCounter);
+
+	// Executes other jobs until the counter reaches zero, background ones excepted
+	void wait(JobCounter& counter);
+
+	// Splits [0, count) into batches, calls function(begin, end) for each and waits.
+	template<typename Function>
+	void parallelFor(uint32_t count, uint32_t batchSize, const Function& function)
+	{
+		JobCounter counter;
+		for (uint32_t begin = 0; begin < count; begin += batchSize)
+		{
+			run(&invokeRange<Function>, (void*) &function, begin, std::min(count, begin + batchSize), &counter);
+		}
+		wait(counter);
+	}
+
+private:
+	template<typename Function>
+	static void invokeRange(const Job& job)
+	{
+		(*static_cast<const Function*>(job.pData))(job.begin, job.end);
+	}
+
+	Job* allocateJob();
+	void push(Job* pJob);
+	Job* findJob();
+	bool popBackgroundJob(Job* pJob);
+	void execute(Job* pJob);
+	void invoke(const Job& job);
+	void finish(JobCounter& counter);
+
+	void workerMain(uint32_t workerIndex, const std::vector<uint32_t>& cores);
+
+private:
+	static const uint32_t JOB_POOL_SIZE = 4096;
+
+	// Below the pool size, a full deque has to be reachable without the ring wrapping
+	static const uint32_t DEQUE_CAPACITY = JOB_POOL_SIZE / 4;
+
+	std::atomic<bool> m_isRunning;
+
+	std::vector<std::thread> m_workers;
+	std::vector<std::unique_ptr<WorkStealingDeque<Job>>> m_deques;
+
+	std::vector<Job> m_jobPool;
+	std::vector<std::atomic<bool>> m_jobsInUse;
+	std::atomic<uint32_t> m_nextJob;
+
+	// Submissions from threads that aren't workers
+	std::mutex m_sharedMutex;
+	std::deque<Job*> m_sharedJobs;
+	std::atomic<uint32_t> m_nSharedJobs;
+
+	// Copies, they can stay queued for longer than a ring slot lives
+	std::mutex m_backgroundMutex;
+	std::deque<Job> m_backgroundJobs;
+	std::atomic<uint32_t> m_nBackgroundJobs;
+
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wakeCondition;
+	std::atomic<uint32_t> m_nSleeping;
+};
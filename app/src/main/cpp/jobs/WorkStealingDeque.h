@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Chase-Lev work stealing deque. The store / load pairs that have to be seen in
+ * the same order by owner and thieves are seq_cst operations rather than fences
+ * (Le et al. 2013), which also keeps the deque checkable with ThreadSanitizer.
+ *
+ * The owning thread pushes and pops at the bottom, any other thread steals from
+ * the top. Only the last element ever needs a CAS between owner and thieves.
+ * The capacity is fixed, push() fails instead of growing so that no thief can
+ * be left reading a freed buffer.
+ */
+template<typename T>
+class WorkStealingDeque
+{
+public:
+	WorkStealingDeque(uint32_t capacity = 4096) :
+			m_top(0),
+			m_padding(),
+			m_bottom(0),
+			m_mask(capacity - 1),
+			m_items(capacity)
+	{
+		// capacity has to be a power of two
+	}
+
+	// OWNER
+	bool push(T* item)
+	{
+		int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+		int64_t top = m_top.load(std::memory_order_acquire);
+		if (bottom - top > (int64_t) m_mask)
+		{
+			return false;
+		}
+
+		m_items[bottom & m_mask].store(item, std::memory_order_relaxed);
+		m_bottom.store(bottom + 1, std::memory_order_release);
+		return true;
+	}
+
+	T* pop()
+	{
+		int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+		m_bottom.store(bottom, std::memory_order_seq_cst);
+		int64_t top = m_top.load(std::memory_order_seq_cst);
+
+		if (top > bottom)
+		{
+			// Empty
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		T* item = m_items[bottom & m_mask].load(std::memory_order_relaxed);
+		if (top == bottom)
+		{
+			// Last item, race the thieves for it
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				item = nullptr;
+			}
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+
+		return item;
+	}
+
+	// THIEVES
+	T* steal()
+	{
+		int64_t top = m_top.load(std::memory_order_seq_cst);
+		int64_t bottom = m_bottom.load(std::memory_order_seq_cst);
+
+		if (top >= bottom)
+		{
+			return nullptr;
+		}
+
+		T* item = m_items[top & m_mask].load(std::memory_order_relaxed);
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			// Lost against the owner or another thief
+			return nullptr;
+		}
+
+		return item;
+	}
+
+	bool isEmpty() const
+	{
+		return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+	}
+
+private:
+	// top and bottom on separate cache lines, thieves hammer the first one
+	std::atomic<int64_t> m_top;
+	char m_padding[64 - sizeof(std::atomic<int64_t>)];
+	std::atomic<int64_t> m_bottom;
+
+	uint32_t m_mask;
+	std::vector<std::atomic<T*>> m_items;
+};
@@ -0,0 +1,188 @@
+#include "DeletionQueue.h"
+
+// Non dispatchable handles are pointers on 64 bit and uint64_t on 32 bit targets,
+// both round trip through a C style cast.
+template<typename T>
+static T fromHandle(uint64_t handle)
+{
+	return (T) handle;
+}
+
+DeletionQueue::DeletionQueue() :
+		m_logicalDevice(VK_NULL_HANDLE),
+		m_pTimeline(nullptr)
+{
+}
+
+void DeletionQueue::create(VkDevice logicalDevice, GpuTimeline* pTimeline)
+{
+	m_logicalDevice = logicalDevice;
+	m_pTimeline = pTimeline;
+}
+
+void DeletionQueue::destroy()
+{
+	for (const Entry& entry : m_entries)
+	{
+		destroyEntry(entry);
+	}
+	m_entries.clear();
+}
+
+template<typename T>
+void DeletionQueue::push(VkObjectType type, T object, uint64_t timelineValue, uint64_t parent)
+{
+	if (object == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	m_entries.push_back({type, (uint64_t) object, parent, timelineValue});
+}
+
+void DeletionQueue::enqueueBuffer(VkBuffer buffer, uint64_t timelineValue)
+{
+	push(VK_OBJECT_TYPE_BUFFER, buffer, timelineValue);
+}
+
+void DeletionQueue::enqueueMemory(VkDeviceMemory memory, uint64_t timelineValue)
+{
+	push(VK_OBJECT_TYPE_DEVICE_MEMORY, memory, timelineValue);
+}
+
+void DeletionQueue::enqueueImage(VkImage image, uint64_t timelineValue)
+{
+	push(VK_OBJECT_TYPE_IMAGE, image, timelineValue);
+}
+
+void DeletionQueue::enqueueImageView(VkImageView imageView, uint64_t timelineValue)
+{
+	push(VK_OBJECT_TYPE_IMAGE_VIEW, imageView, timelineValue);
+}
+
+void DeletionQueue::enqueueSampler(VkSampler sampler, uint64_t timelineValue)
+{
+	push(VK_OBJECT_TYPE_SAMPLER, sampler, timelineValue);
+}
+
+void DeletionQueue::enqueueFramebuffer(VkFramebuffer framebuffer, uint64_t timelineValue)
+{
+	push(VK_OBJECT_TYPE_FRAMEBUFFER, framebuffer, timelineValue);
+}
+
+void DeletionQueue::enqueueRenderPass(VkRenderPass renderPass, uint64_t timelineValue)
+{
+	push(VK_OBJECT_TYPE_RENDER_PASS, renderPass, timelineValue);
+}
+
+void DeletionQueue::enqueuePipeline(VkPipeline pipeline, uint64_t timelineValue)
+{
+	push(VK_OBJECT_TYPE_PIPELINE, pipeline, timelineValue);
+}
+
+void DeletionQueue::enqueuePipelineLayout(VkPipelineLayout pipelineLayout, uint64_t timelineValue)
+{
+	push(VK_OBJECT_TYPE_PIPELINE_LAYOUT, pipelineLayout, timelineValue);
+}
+
+void DeletionQueue::enqueueDescriptorPool(VkDescriptorPool descriptorPool, uint64_t timelineValue)
+{
+	push(VK_OBJECT_TYPE_DESCRIPTOR_POOL, descriptorPool, timelineValue);
+}
+
+void DeletionQueue::enqueueSwapchain(VkSwapchainKHR swapchain, uint64_t timelineValue)
+{
+	push(VK_OBJECT_TYPE_SWAPCHAIN_KHR, swapchain, timelineValue);
+}
+
+void DeletionQueue::enqueueCommandBuffers(VkCommandPool commandPool, const std::vector<VkCommandBuffer>& commandBuffers, uint64_t timelineValue)
+{
+	for (VkCommandBuffer commandBuffer : commandBuffers)
+	{
+		push(VK_OBJECT_TYPE_COMMAND_BUFFER, commandBuffer, timelineValue, (uint64_t) commandPool);
+	}
+}
+
+void DeletionQueue::flush()
+{
+	if (m_entries.empty())
+	{
+		return;
+	}
+
+	uint64_t completedValue = m_pTimeline->getCompletedValue();
+
+	size_t nKept = 0;
+	for (size_t i = 0; i < m_entries.size(); ++i)
+	{
+		if (m_entries[i].timelineValue <= completedValue)
+		{
+			destroyEntry(m_entries[i]);
+		}
+		else
+		{
+			m_entries[nKept++] = m_entries[i];
+		}
+	}
+	m_entries.resize(nKept);
+}
+
+void DeletionQueue::destroyEntry(const Entry& entry)
+{
+	switch (entry.type)
+	{
+		case VK_OBJECT_TYPE_BUFFER:
+			vkDestroyBuffer(m_logicalDevice, fromHandle<VkBuffer>(entry.handle), nullptr);
+			break;
+
+		case VK_OBJECT_TYPE_DEVICE_MEMORY:
+			vkFreeMemory(m_logicalDevice, fromHandle<VkDeviceMemory>(entry.handle), nullptr);
+			break;
+
+		case VK_OBJECT_TYPE_IMAGE:
+			vkDestroyImage(m_logicalDevice, fromHandle<VkImage>(entry.handle), nullptr);
+			break;
+
+		case VK_OBJECT_TYPE_IMAGE_VIEW:
+			vkDestroyImageView(m_logicalDevice, fromHandle<VkImageView>(entry.handle), nullptr);
+			break;
+
+		case VK_OBJECT_TYPE_SAMPLER:
+			vkDestroySampler(m_logicalDevice, fromHandle<VkSampler>(entry.handle), nullptr);
+			break;
+
+		case VK_OBJECT_TYPE_FRAMEBUFFER:
+			vkDestroyFramebuffer(m_logicalDevice, fromHandle<VkFramebuffer>(entry.handle), nullptr);
+			break;
+
+		case VK_OBJECT_TYPE_RENDER_PASS:
+			vkDestroyRenderPass(m_logicalDevice, fromHandle<VkRenderPass>(entry.handle), nullptr);
+			break;
+
+		case VK_OBJECT_TYPE_PIPELINE:
+			vkDestroyPipeline(m_logicalDevice, fromHandle<VkPipeline>(entry.handle), nullptr);
+			break;
+
+		case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+			vkDestroyPipelineLayout(m_logicalDevice, fromHandle<VkPipelineLayout>(entry.handle), nullptr);
+			break;
+
+		case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+			vkDestroyDescriptorPool(m_logicalDevice, fromHandle<VkDescriptorPool>(entry.handle), nullptr);
+			break;
+
+		case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+			vkDestroySwapchainKHR(m_logicalDevice, fromHandle<VkSwapchainKHR>(entry.handle), nullptr);
+			break;
+
+		case VK_OBJECT_TYPE_COMMAND_BUFFER:
+		{
+			VkCommandBuffer commandBuffer = fromHandle<VkCommandBuffer>(entry.handle);
+			vkFreeCommandBuffers(m_logicalDevice, fromHandle<VkCommandPool>(entry.parent), 1, &commandBuffer);
+			break;
+		}
+
+		default:
+			__android_log_print(ANDROID_LOG_ERROR, "Vulkan", "object type [%d] can not be deleted", entry.type);
+	}
+}
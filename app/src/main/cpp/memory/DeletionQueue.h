@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../vulkan_wrapper.h"
+#include "../sync/GpuTimeline.h"
+
+#include <vector>
+
+/*
+ * Vulkan objects that may still be used by submitted work are handed over
+ * together with the GPU timeline value of the last submission using them and
+ * destroyed by flush() once the timeline has passed that value.
+ */
+class DeletionQueue
+{
+public:
+	DeletionQueue();
+
+	void create(VkDevice logicalDevice, GpuTimeline* pTimeline);
+
+	// Destroys everything still queued, the device must be idle.
+	void destroy();
+
+	// A function per type, on 32 bit targets the handles are all uint64_t
+	void enqueueBuffer(VkBuffer buffer, uint64_t timelineValue);
+	void enqueueMemory(VkDeviceMemory memory, uint64_t timelineValue);
+	void enqueueImage(VkImage image, uint64_t timelineValue);
+	void enqueueImageView(VkImageView imageView, uint64_t timelineValue);
+	void enqueueSampler(VkSampler sampler, uint64_t timelineValue);
+	void enqueueFramebuffer(VkFramebuffer framebuffer, uint64_t timelineValue);
+	void enqueueRenderPass(VkRenderPass renderPass, uint64_t timelineValue);
+	void enqueuePipeline(VkPipeline pipeline, uint64_t timelineValue);
+	void enqueuePipelineLayout(VkPipelineLayout pipelineLayout, uint64_t timelineValue);
+	void enqueueDescriptorPool(VkDescriptorPool descriptorPool, uint64_t timelineValue);
+	void enqueueSwapchain(VkSwapchainKHR swapchain, uint64_t timelineValue);
+	void enqueueCommandBuffers(VkCommandPool commandPool, const std::vector<VkCommandBuffer>& commandBuffers, uint64_t timelineValue);
+
+	// Destroys every object whose last use has completed.
+	void flush();
+
+	size_t size() const
+	{
+		return m_entries.size();
+	}
+
+private:
+	struct Entry
+	{
+		VkObjectType type;
+		uint64_t handle;
+
+		// command pool of a command buffer
+		uint64_t parent;
+
+		uint64_t timelineValue;
+	};
+
+	template<typename T>
+	void push(VkObjectType type, T object, uint64_t timelineValue, uint64_t parent = 0);
+
+	void destroyEntry(const Entry& entry);
+
+private:
+	VkDevice m_logicalDevice;
+	GpuTimeline* m_pTimeline;
+
+	std::vector<Entry> m_entries;
+};
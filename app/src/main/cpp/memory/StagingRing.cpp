@@ -0,0 +1,244 @@
+#include "StagingRing.h"
+
+#include <cstring>
+#include <algorithm>
+
+// Keeps every copy source offset valid for buffer -> image copies as well.
+const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+StagingRing::StagingRing() :
+		m_logicalDevice(VK_NULL_HANDLE),
+		m_queue(VK_NULL_HANDLE),
+		m_commandPool(VK_NULL_HANDLE),
+		m_pTimeline(nullptr),
+		m_buffer(VK_NULL_HANDLE),
+		m_memory(VK_NULL_HANDLE),
+		m_data(nullptr),
+		m_size(0),
+		m_head(0),
+		m_used(0),
+		m_currentBatch({VK_NULL_HANDLE, 0, 0}),
+		m_isRecording(false)
+{
+}
+
+void StagingRing::create(VkDevice logicalDevice, uint32_t queueFamilyIndex, VkQueue queue, GpuTimeline* pTimeline, VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize size)
+{
+	m_logicalDevice = logicalDevice;
+	m_queue = queue;
+	m_pTimeline = pTimeline;
+	m_buffer = buffer;
+	m_memory = memory;
+	m_size = size & ~(STAGING_ALIGNMENT - 1);
+	m_head = 0;
+	m_used = 0;
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	CALL_VK(vkCreateCommandPool(m_logicalDevice, &commandPoolCreateInfo, nullptr, &m_commandPool));
+
+	void* data;
+	CALL_VK(vkMapMemory(m_logicalDevice, m_memory, 0, VK_WHOLE_SIZE, 0, &data));
+	m_data = static_cast<char*>(data);
+}
+
+void StagingRing::destroy()
+{
+	flush();
+	while (!m_submittedBatches.empty())
+	{
+		waitOldestBatch();
+	}
+	m_freeBatches.clear();
+
+	vkDestroyCommandPool(m_logicalDevice, m_commandPool, nullptr);
+
+	vkUnmapMemory(m_logicalDevice, m_memory);
+	vkDestroyBuffer(m_logicalDevice, m_buffer, nullptr);
+	vkFreeMemory(m_logicalDevice, m_memory, nullptr);
+
+	m_data = nullptr;
+}
+
+void StagingRing::upload(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+	const char* src = static_cast<const char*>(data);
+
+	while (size > 0)
+	{
+		VkDeviceSize offset;
+		VkDeviceSize chunk = reserve(size, &offset);
+
+		memcpy(m_data + offset, src, (size_t) chunk);
+
+		VkBufferCopy copyRegion = {};
+		copyRegion.srcOffset = offset;
+		copyRegion.dstOffset = dstOffset;
+		copyRegion.size = chunk;
+		vkCmdCopyBuffer(m_currentBatch.commandBuffer, m_buffer, dstBuffer, 1, &copyRegion);
+
+		src += chunk;
+		dstOffset += chunk;
+		size -= chunk;
+	}
+}
+
+uint64_t StagingRing::flush()
+{
+	if (!m_isRecording)
+	{
+		return 0;
+	}
+
+	// Make the copies visible to everything submitted after this batch
+	VkMemoryBarrier memoryBarrier = {};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+	vkCmdPipelineBarrier(m_currentBatch.commandBuffer,
+	                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+	                     0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+	CALL_VK(vkEndCommandBuffer(m_currentBatch.commandBuffer));
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &m_currentBatch.commandBuffer;
+
+	m_currentBatch.timelineValue = m_pTimeline->submit(m_queue, submitInfo);
+
+	m_submittedBatches.push_back(m_currentBatch);
+	m_isRecording = false;
+
+	return m_currentBatch.timelineValue;
+}
+
+void StagingRing::reclaim()
+{
+	while (!m_submittedBatches.empty())
+	{
+		Batch& batch = m_submittedBatches.front();
+		if (!m_pTimeline->isComplete(batch.timelineValue))
+		{
+			break;
+		}
+
+		m_used -= batch.size;
+
+		m_freeBatches.push_back(batch);
+		m_submittedBatches.pop_front();
+	}
+}
+
+VkDeviceSize StagingRing::reserve(VkDeviceSize size, VkDeviceSize* offset)
+{
+	for (;;)
+	{
+		if (!m_isRecording)
+		{
+			beginBatch();
+		}
+
+		VkDeviceSize contiguous = 0;
+		if (m_used == 0)
+		{
+			m_head = 0;
+			contiguous = m_size;
+		}
+		else if (m_used < m_size)
+		{
+			VkDeviceSize tail = (m_head + m_size - m_used) % m_size;
+			if (m_head >= tail)
+			{
+				VkDeviceSize endSpace = m_size - m_head;
+				if (endSpace < size && tail > endSpace)
+				{
+					// The start of the ring has more room, the end becomes padding of this batch
+					m_used += endSpace;
+					m_currentBatch.size += endSpace;
+					m_head = 0;
+					contiguous = tail;
+				}
+				else
+				{
+					contiguous = endSpace;
+				}
+			}
+			else
+			{
+				contiguous = tail - m_head;
+			}
+		}
+
+		if (contiguous > 0)
+		{
+			VkDeviceSize chunk = std::min(size, contiguous);
+			VkDeviceSize allocated = std::min(alignUp(chunk, STAGING_ALIGNMENT), contiguous);
+
+			*offset = m_head;
+			m_head = (m_head + allocated) % m_size;
+			m_used += allocated;
+			m_currentBatch.size += allocated;
+
+			return chunk;
+		}
+
+		// Ring is full: hand the pending copies to the GPU and wait for the oldest batch
+		if (m_currentBatch.size > 0)
+		{
+			flush();
+		}
+		waitOldestBatch();
+	}
+}
+
+void StagingRing::beginBatch()
+{
+	reclaim();
+
+	if (m_freeBatches.empty())
+	{
+		Batch batch = {};
+
+		VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+		commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		commandBufferAllocateInfo.commandPool = m_commandPool;
+		commandBufferAllocateInfo.commandBufferCount = 1;
+		CALL_VK(vkAllocateCommandBuffers(m_logicalDevice, &commandBufferAllocateInfo, &batch.commandBuffer));
+
+		m_freeBatches.push_back(batch);
+	}
+
+	m_currentBatch = m_freeBatches.back();
+	m_freeBatches.pop_back();
+	m_currentBatch.size = 0;
+
+	VkCommandBufferBeginInfo commandBufferBeginInfo = {};
+	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	CALL_VK(vkBeginCommandBuffer(m_currentBatch.commandBuffer, &commandBufferBeginInfo));
+	m_isRecording = true;
+}
+
+void StagingRing::waitOldestBatch()
+{
+	if (m_submittedBatches.empty())
+	{
+		return;
+	}
+
+	m_pTimeline->wait(m_submittedBatches.front().timelineValue);
+	reclaim();
+}
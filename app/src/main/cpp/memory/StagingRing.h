@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../vulkan_wrapper.h"
+#include "../sync/GpuTimeline.h"
+
+#include <vector>
+#include <deque>
+
+/*
+ * One persistently mapped, host visible buffer that every host -> device upload
+ * sub-allocates from. Copies are recorded into batches; a batch keeps its part of
+ * the ring alive until the GPU timeline has passed the value of its submission.
+ * Uploads bigger than the free space (or the whole ring) are split into several copies.
+ */
+class StagingRing
+{
+public:
+	StagingRing();
+
+	// Takes ownership of buffer / memory, which must be HOST_VISIBLE | HOST_COHERENT.
+	void create(VkDevice logicalDevice, uint32_t queueFamilyIndex, VkQueue queue, GpuTimeline* pTimeline, VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize size);
+	void destroy();
+
+	void upload(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+	// Submits the copies recorded so far. Later submissions on the same queue see the data.
+	// Returns the timeline value of the submission (0 when nothing was recorded).
+	uint64_t flush();
+
+	// Releases the ring space of every batch the GPU is done with.
+	void reclaim();
+
+private:
+	struct Batch
+	{
+		VkCommandBuffer commandBuffer;
+		uint64_t timelineValue;
+
+		// ring bytes owned by the batch (padding at wrap included)
+		VkDeviceSize size;
+	};
+
+	VkDeviceSize reserve(VkDeviceSize size, VkDeviceSize* offset);
+
+	void beginBatch();
+	void waitOldestBatch();
+
+private:
+	VkDevice m_logicalDevice;
+	VkQueue m_queue;
+	VkCommandPool m_commandPool;
+	GpuTimeline* m_pTimeline;
+
+	VkBuffer m_buffer;
+	VkDeviceMemory m_memory;
+	char* m_data;
+
+	VkDeviceSize m_size;
+	VkDeviceSize m_head;
+	VkDeviceSize m_used;
+
+	Batch m_currentBatch;
+	bool m_isRecording;
+
+	std::deque<Batch> m_submittedBatches;
+	std::vector<Batch> m_freeBatches;
+};
@@ -0,0 +1,132 @@
+#include "LayoutCache.h"
+
+#include "../util/Hash.h"
+
+#include <algorithm>
+
+static bool operator==(const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+{
+	return a.binding == b.binding &&
+	       a.descriptorType == b.descriptorType &&
+	       a.descriptorCount == b.descriptorCount &&
+	       a.stageFlags == b.stageFlags &&
+	       a.pImmutableSamplers == b.pImmutableSamplers;
+}
+
+static bool operator==(const VkPushConstantRange& a, const VkPushConstantRange& b)
+{
+	return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+}
+
+LayoutCache::LayoutCache() :
+		m_logicalDevice(VK_NULL_HANDLE)
+{
+}
+
+void LayoutCache::create(VkDevice logicalDevice)
+{
+	m_logicalDevice = logicalDevice;
+}
+
+void LayoutCache::destroy()
+{
+	for (auto& bucket : m_pipelineLayouts)
+	{
+		for (const PipelineLayoutEntry& entry : bucket.second)
+		{
+			vkDestroyPipelineLayout(m_logicalDevice, entry.layout, nullptr);
+		}
+	}
+	m_pipelineLayouts.clear();
+
+	for (auto& bucket : m_setLayouts)
+	{
+		for (const SetLayoutEntry& entry : bucket.second)
+		{
+			vkDestroyDescriptorSetLayout(m_logicalDevice, entry.layout, nullptr);
+		}
+	}
+	m_setLayouts.clear();
+}
+
+VkDescriptorSetLayout LayoutCache::getSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings)
+{
+	std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+	{
+		return a.binding < b.binding;
+	});
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	uint64_t hash = HASH_SEED;
+	for (const VkDescriptorSetLayoutBinding& binding : bindings)
+	{
+		hashCombine(hash, binding.binding);
+		hashCombine(hash, binding.descriptorType);
+		hashCombine(hash, binding.descriptorCount);
+		hashCombine(hash, binding.stageFlags);
+		hashCombine(hash, binding.pImmutableSamplers);
+	}
+
+	std::vector<SetLayoutEntry>& bucket = m_setLayouts[hash];
+	for (const SetLayoutEntry& entry : bucket)
+	{
+		if (entry.bindings == bindings)
+		{
+			return entry.layout;
+		}
+	}
+
+	VkDescriptorSetLayoutCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	createInfo.bindingCount = (uint32_t) bindings.size();
+	createInfo.pBindings = bindings.data();
+
+	SetLayoutEntry entry;
+	entry.bindings = bindings;
+	CALL_VK(vkCreateDescriptorSetLayout(m_logicalDevice, &createInfo, nullptr, &entry.layout));
+
+	bucket.push_back(entry);
+	return entry.layout;
+}
+
+VkPipelineLayout LayoutCache::getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	uint64_t hash = HASH_SEED;
+	for (VkDescriptorSetLayout setLayout : setLayouts)
+	{
+		hashCombine(hash, setLayout);
+	}
+	for (const VkPushConstantRange& range : pushConstantRanges)
+	{
+		hashCombine(hash, range.stageFlags);
+		hashCombine(hash, range.offset);
+		hashCombine(hash, range.size);
+	}
+
+	std::vector<PipelineLayoutEntry>& bucket = m_pipelineLayouts[hash];
+	for (const PipelineLayoutEntry& entry : bucket)
+	{
+		if (entry.setLayouts == setLayouts && entry.pushConstantRanges == pushConstantRanges)
+		{
+			return entry.layout;
+		}
+	}
+
+	VkPipelineLayoutCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	createInfo.setLayoutCount = (uint32_t) setLayouts.size();
+	createInfo.pSetLayouts = setLayouts.data();
+	createInfo.pushConstantRangeCount = (uint32_t) pushConstantRanges.size();
+	createInfo.pPushConstantRanges = pushConstantRanges.data();
+
+	PipelineLayoutEntry entry;
+	entry.setLayouts = setLayouts;
+	entry.pushConstantRanges = pushConstantRanges;
+	CALL_VK(vkCreatePipelineLayout(m_logicalDevice, &createInfo, nullptr, &entry.layout));
+
+	bucket.push_back(entry);
+	return entry.layout;
+}
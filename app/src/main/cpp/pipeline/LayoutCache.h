@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../vulkan_wrapper.h"
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Descriptor set layouts and pipeline layouts, created once per distinct
+ * description and shared by every pipeline asking for the same one. Equal
+ * layouts are the same handle, so sets allocated for one pipeline can be bound
+ * with any other using that layout.
+ *
+ * Everything lives until destroy(). The getters may be called from any thread,
+ * pipelines are compiled on workers.
+ */
+class LayoutCache
+{
+public:
+	LayoutCache();
+
+	void create(VkDevice logicalDevice);
+	void destroy();
+
+	// Bindings in any order
+	VkDescriptorSetLayout getSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings);
+	VkPipelineLayout getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
+
+private:
+	struct SetLayoutEntry
+	{
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		VkDescriptorSetLayout layout;
+	};
+
+	struct PipelineLayoutEntry
+	{
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		std::vector<VkPushConstantRange> pushConstantRanges;
+		VkPipelineLayout layout;
+	};
+
+private:
+	VkDevice m_logicalDevice;
+	std::mutex m_mutex;
+
+	// Colliding entries share a bucket
+	std::unordered_map<uint64_t, std::vector<SetLayoutEntry>> m_setLayouts;
+	std::unordered_map<uint64_t, std::vector<PipelineLayoutEntry>> m_pipelineLayouts;
+};
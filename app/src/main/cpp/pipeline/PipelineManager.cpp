@@ -0,0 +1,518 @@
+#include "PipelineManager.h"
+
+#include "ShaderReflection.h"
+#include "../util/Hash.h"
+
+#include <android/log.h>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+// vkGetPipelineCacheData header, VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+const size_t CACHE_HEADER_SIZE = 16 + VK_UUID_SIZE;
+
+PipelineKey::PipelineKey()
+{
+	memset(this, 0, sizeof(PipelineKey));
+
+	topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	polygonMode = VK_POLYGON_MODE_FILL;
+	cullMode = VK_CULL_MODE_BACK_BIT;
+	frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+	isDepthTestEnabled = VK_TRUE;
+	isDepthWriteEnabled = VK_TRUE;
+	depthCompareOp = VK_COMPARE_OP_LESS;
+
+	blendMode = BlendMode::ALPHA;
+	colorAttachmentCount = 1;
+}
+
+bool PipelineKey::operator==(const PipelineKey& other) const
+{
+	return memcmp(this, &other, sizeof(PipelineKey)) == 0;
+}
+
+void PipelineKey::setConstant(uint32_t constantId, uint32_t value)
+{
+	if (constantId >= MAX_SPECIALIZATION_CONSTANTS)
+	{
+		__android_log_assert("constantId >= MAX_SPECIALIZATION_CONSTANTS", nullptr, "%u", constantId);
+	}
+
+	specializationMask |= 1u << constantId;
+	specializationConstants[constantId] = value;
+}
+
+void PipelineKey::setConstant(uint32_t constantId, int32_t value)
+{
+	setConstant(constantId, static_cast<uint32_t>(value));
+}
+
+void PipelineKey::setConstant(uint32_t constantId, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	setConstant(constantId, bits);
+}
+
+void PipelineKey::setConstant(uint32_t constantId, bool value)
+{
+	setConstant(constantId, static_cast<uint32_t>(value ? VK_TRUE : VK_FALSE));
+}
+
+static VkPipelineColorBlendAttachmentState getBlendAttachmentState(BlendMode blendMode)
+{
+	VkPipelineColorBlendAttachmentState blendAttachment = {};
+	blendAttachment.colorWriteMask =
+			VK_COLOR_COMPONENT_R_BIT |
+			VK_COLOR_COMPONENT_G_BIT |
+			VK_COLOR_COMPONENT_B_BIT |
+			VK_COLOR_COMPONENT_A_BIT;
+	blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	switch (blendMode)
+	{
+		case BlendMode::OPAQUE:
+			blendAttachment.blendEnable = VK_FALSE;
+			break;
+
+		case BlendMode::ALPHA:
+			blendAttachment.blendEnable = VK_TRUE;
+			blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+			blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+			blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+			blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+			break;
+
+		case BlendMode::ADDITIVE:
+			blendAttachment.blendEnable = VK_TRUE;
+			blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+			blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+			blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+			blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+			break;
+	}
+
+	return blendAttachment;
+}
+
+PipelineManager::PipelineManager() :
+		m_logicalDevice(VK_NULL_HANDLE),
+		m_physicalDeviceProperties(),
+		m_pLayoutCache(nullptr),
+		m_pShaderCache(nullptr),
+		m_pJobSystem(nullptr),
+		m_pipelineCache(VK_NULL_HANDLE)
+{
+}
+
+void PipelineManager::create(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, LayoutCache* pLayoutCache, ShaderCache* pShaderCache, JobSystem* pJobSystem, const std::string& cachePath)
+{
+	m_logicalDevice = logicalDevice;
+	m_pLayoutCache = pLayoutCache;
+	m_pShaderCache = pShaderCache;
+	m_pJobSystem = pJobSystem;
+	m_cachePath = cachePath;
+
+	vkGetPhysicalDeviceProperties(physicalDevice, &m_physicalDeviceProperties);
+	m_pipelineCache = loadCache();
+}
+
+void PipelineManager::destroy()
+{
+	wait();
+	save();
+
+	for (const Entry& entry : m_entries)
+	{
+		vkDestroyPipeline(m_logicalDevice, entry.pipeline.pipeline, nullptr);
+	}
+	m_entries.clear();
+	m_pipelines.clear();
+
+	for (const std::pair<const uint32_t, Pipeline>& computePipeline : m_computePipelines)
+	{
+		vkDestroyPipeline(m_logicalDevice, computePipeline.second.pipeline, nullptr);
+	}
+	m_computePipelines.clear();
+
+	vkDestroyPipelineCache(m_logicalDevice, m_pipelineCache, nullptr);
+	m_pipelineCache = VK_NULL_HANDLE;
+}
+
+void PipelineManager::save()
+{
+	if (m_cachePath.empty() || m_pipelineCache == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	// Workers may still be adding to the cache
+	wait();
+
+	size_t dataSize = 0;
+	CALL_VK(vkGetPipelineCacheData(m_logicalDevice, m_pipelineCache, &dataSize, nullptr));
+
+	std::vector<char> data(dataSize);
+	CALL_VK(vkGetPipelineCacheData(m_logicalDevice, m_pipelineCache, &dataSize, data.data()));
+
+	// Written next to the old file and swapped in, a killed app never leaves half a cache
+	std::string tempPath = m_cachePath + ".tmp";
+	std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+	file.write(data.data(), dataSize);
+	file.close();
+
+	if (!file || std::rename(tempPath.c_str(), m_cachePath.c_str()) != 0)
+	{
+		__android_log_print(ANDROID_LOG_WARN, "Vulkan", "pipeline cache could not be saved to [%s]", m_cachePath.c_str());
+	}
+}
+
+uint32_t PipelineManager::getShaderId(const char* shaderPath)
+{
+	for (uint32_t i = 0; i < m_shaderPaths.size(); ++i)
+	{
+		if (m_shaderPaths[i] == shaderPath)
+		{
+			return i;
+		}
+	}
+
+	m_shaderPaths.push_back(shaderPath);
+	return (uint32_t) m_shaderPaths.size() - 1;
+}
+
+void PipelineManager::setSetLayoutOverride(uint32_t set, VkDescriptorSetLayout setLayout)
+{
+	if (set >= m_setLayoutOverrides.size())
+	{
+		m_setLayoutOverrides.resize(set + 1, VK_NULL_HANDLE);
+	}
+
+	m_setLayoutOverrides[set] = setLayout;
+}
+
+const Pipeline& PipelineManager::getPipeline(const PipelineKey& key, VkRenderPass renderPass)
+{
+	bool isNew;
+	Entry& entry = getEntry(key, renderPass, &isNew);
+
+	if (isNew)
+	{
+		createPipeline(entry);
+	}
+	else if (!entry.isReady.load(std::memory_order_acquire))
+	{
+		wait();
+	}
+
+	return entry.pipeline;
+}
+
+const Pipeline* PipelineManager::requestPipeline(const PipelineKey& key, VkRenderPass renderPass)
+{
+	bool isNew;
+	Entry& entry = getEntry(key, renderPass, &isNew);
+
+	if (isNew && m_pJobSystem != nullptr)
+	{
+		// A compile run inline by a thread waiting on a parallelFor would be a hitch of its own
+		m_pJobSystem->runBackground(&compileJob, &entry, &m_compileCounter);
+	}
+	else if (isNew)
+	{
+		createPipeline(entry);
+	}
+
+	return entry.isReady.load(std::memory_order_acquire) ? &entry.pipeline : nullptr;
+}
+
+const Pipeline& PipelineManager::getComputePipeline(const char* shaderPath)
+{
+	uint32_t shaderId = getShaderId(shaderPath);
+
+	std::unordered_map<uint32_t, Pipeline>::iterator it = m_computePipelines.find(shaderId);
+	if (it != m_computePipelines.end())
+	{
+		return it->second;
+	}
+
+	const ShaderModule& shaderModule = m_pShaderCache->getModule(shaderPath);
+	if (shaderModule.reflection.getStageFlags() != VK_SHADER_STAGE_COMPUTE_BIT)
+	{
+		__android_log_assert("Not a compute shader.", nullptr, "%s", shaderPath);
+	}
+
+	Pipeline& pipeline = m_computePipelines[shaderId];
+	createLayout(shaderModule.reflection, pipeline);
+
+	VkComputePipelineCreateInfo computePipelineCreateInfo = {};
+	computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	computePipelineCreateInfo.stage.module = shaderModule.module;
+	computePipelineCreateInfo.stage.pName = "main";
+	computePipelineCreateInfo.layout = pipeline.layout;
+	computePipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	computePipelineCreateInfo.basePipelineIndex = -1;
+
+	CALL_VK(vkCreateComputePipelines(m_logicalDevice, m_pipelineCache, 1, &computePipelineCreateInfo, nullptr, &pipeline.pipeline));
+
+	return pipeline;
+}
+
+void PipelineManager::wait()
+{
+	if (m_pJobSystem != nullptr)
+	{
+		m_pJobSystem->wait(m_compileCounter);
+	}
+}
+
+PipelineManager::Entry& PipelineManager::getEntry(const PipelineKey& key, VkRenderPass renderPass, bool* pIsNew)
+{
+	std::vector<Entry*>& bucket = m_pipelines[hashBytes(&key, sizeof(PipelineKey))];
+	for (Entry* pEntry : bucket)
+	{
+		if (pEntry->key == key)
+		{
+			*pIsNew = false;
+			return *pEntry;
+		}
+	}
+
+	// Constructed in place, entries are never moved
+	m_entries.emplace_back();
+	Entry& entry = m_entries.back();
+	entry.pManager = this;
+	entry.key = key;
+	entry.renderPass = renderPass;
+	entry.vertexShaderPath = m_shaderPaths[key.vertexShader];
+	entry.fragmentShaderPath = m_shaderPaths[key.fragmentShader];
+	entry.pipeline.pipeline = VK_NULL_HANDLE;
+	entry.pipeline.layout = VK_NULL_HANDLE;
+	entry.isReady.store(false, std::memory_order_relaxed);
+
+	bucket.push_back(&entry);
+
+	*pIsNew = true;
+	return entry;
+}
+
+void PipelineManager::compileJob(const Job& job)
+{
+	Entry* pEntry = static_cast<Entry*>(job.pData);
+	pEntry->pManager->createPipeline(*pEntry);
+}
+
+// Runs on workers for requested pipelines
+void PipelineManager::createPipeline(Entry& entry)
+{
+	const PipelineKey& key = entry.key;
+	Pipeline& pipeline = entry.pipeline;
+
+	const ShaderModule& vertexModule = m_pShaderCache->getModule(entry.vertexShaderPath);
+	const ShaderModule& fragmentModule = m_pShaderCache->getModule(entry.fragmentShaderPath);
+
+	ShaderReflection reflection = vertexModule.reflection;
+	reflection.merge(fragmentModule.reflection);
+
+	// Both stages get every set constant, a stage ignores ids it doesn't declare
+	std::array<VkSpecializationMapEntry, MAX_SPECIALIZATION_CONSTANTS> mapEntries;
+	uint32_t nMapEntries = 0;
+	for (uint32_t constantId = 0; constantId < MAX_SPECIALIZATION_CONSTANTS; ++constantId)
+	{
+		if ((key.specializationMask & (1u << constantId)) == 0)
+		{
+			continue;
+		}
+
+		// Catches keys meant for other shaders, the driver would silently ignore them
+		if (!reflection.hasSpecializationConstant(constantId))
+		{
+			__android_log_assert("No shader stage declares the specialization constant.", nullptr, "%s %s constant_id %u",
+					entry.vertexShaderPath.c_str(), entry.fragmentShaderPath.c_str(), constantId);
+		}
+
+		mapEntries[nMapEntries].constantID = constantId;
+		mapEntries[nMapEntries].offset = constantId * sizeof(uint32_t);
+		mapEntries[nMapEntries].size = sizeof(uint32_t);
+		++nMapEntries;
+	}
+
+	VkSpecializationInfo specializationInfo = {};
+	specializationInfo.mapEntryCount = nMapEntries;
+	specializationInfo.pMapEntries = mapEntries.data();
+	specializationInfo.dataSize = sizeof(key.specializationConstants);
+	specializationInfo.pData = key.specializationConstants;
+
+	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages = {};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = vertexModule.module;
+	shaderStages[0].pName = "main";
+	shaderStages[0].pSpecializationInfo = nMapEntries > 0 ? &specializationInfo : nullptr;
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = fragmentModule.module;
+	shaderStages[1].pName = "main";
+	shaderStages[1].pSpecializationInfo = shaderStages[0].pSpecializationInfo;
+
+	// Inputs are packed in location order in a single binding. Shaders may read
+	// only the start of a vertex, e.g. positions for depth only passes.
+	VkVertexInputBindingDescription bindingDescription = {};
+	bindingDescription.binding = 0;
+	bindingDescription.stride = key.vertexStride;
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+	uint32_t inputSize = reflection.getVertexAttributes(bindingDescription.binding, attributeDescriptions);
+	if (inputSize > key.vertexStride || (inputSize == 0) != (key.vertexStride == 0))
+	{
+		__android_log_assert("Vertex shader inputs don't match the vertex stride.", nullptr, "%s", entry.vertexShaderPath.c_str());
+	}
+
+	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
+	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputCreateInfo.vertexBindingDescriptionCount = key.vertexStride != 0 ? 1 : 0;
+	vertexInputCreateInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputCreateInfo.vertexAttributeDescriptionCount = (uint32_t) attributeDescriptions.size();
+	vertexInputCreateInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo = {};
+	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssemblyCreateInfo.topology = (VkPrimitiveTopology) key.topology;
+	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
+
+	// Set when recording, the extent is not part of the key
+	VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
+	viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportStateCreateInfo.viewportCount = 1;
+	viewportStateCreateInfo.scissorCount = 1;
+
+	// Depth bias factors as well, when enabled
+	std::array<VkDynamicState, 3> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR, VK_DYNAMIC_STATE_DEPTH_BIAS};
+	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
+	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateCreateInfo.dynamicStateCount = key.isDepthBiasEnabled ? 3 : 2;
+	dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
+
+	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo = {};
+	rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizerCreateInfo.depthClampEnable = VK_FALSE;
+	rasterizerCreateInfo.rasterizerDiscardEnable = VK_FALSE;
+	rasterizerCreateInfo.polygonMode = (VkPolygonMode) key.polygonMode;
+	rasterizerCreateInfo.lineWidth = 1.0f;
+	rasterizerCreateInfo.cullMode = key.cullMode;
+	rasterizerCreateInfo.frontFace = (VkFrontFace) key.frontFace;
+	// Factors are dynamic state, set with vkCmdSetDepthBias()
+	rasterizerCreateInfo.depthBiasEnable = key.isDepthBiasEnabled;
+
+	VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo = {};
+	multisamplingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisamplingCreateInfo.sampleShadingEnable = VK_FALSE;
+	multisamplingCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisamplingCreateInfo.minSampleShading = 1.0f;
+
+	std::vector<VkPipelineColorBlendAttachmentState> blendAttachments(key.colorAttachmentCount, getBlendAttachmentState(key.blendMode));
+
+	VkPipelineColorBlendStateCreateInfo colorBlendingCreateInfo = {};
+	colorBlendingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlendingCreateInfo.logicOpEnable = VK_FALSE;
+	colorBlendingCreateInfo.logicOp = VK_LOGIC_OP_COPY;
+	colorBlendingCreateInfo.attachmentCount = (uint32_t) blendAttachments.size();
+	colorBlendingCreateInfo.pAttachments = blendAttachments.data();
+
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {};
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.depthTestEnable = key.isDepthTestEnabled;
+	depthStencilCreateInfo.depthWriteEnable = key.isDepthWriteEnabled;
+	depthStencilCreateInfo.depthCompareOp = (VkCompareOp) key.depthCompareOp;
+	depthStencilCreateInfo.depthBoundsTestEnable = VK_FALSE;
+	depthStencilCreateInfo.stencilTestEnable = VK_FALSE;
+
+	createLayout(reflection, pipeline);
+
+	VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {};
+	graphicsPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	graphicsPipelineCreateInfo.stageCount = (uint32_t) shaderStages.size();
+	graphicsPipelineCreateInfo.pStages = shaderStages.data();
+	graphicsPipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
+	graphicsPipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
+	graphicsPipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
+	graphicsPipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
+	graphicsPipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
+	graphicsPipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
+	graphicsPipelineCreateInfo.pColorBlendState = &colorBlendingCreateInfo;
+	graphicsPipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
+	graphicsPipelineCreateInfo.layout = pipeline.layout;
+	graphicsPipelineCreateInfo.renderPass = entry.renderPass;
+	graphicsPipelineCreateInfo.subpass = key.subpass;
+	graphicsPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	graphicsPipelineCreateInfo.basePipelineIndex = -1;
+
+	CALL_VK(vkCreateGraphicsPipelines(m_logicalDevice, m_pipelineCache, 1, &graphicsPipelineCreateInfo, nullptr, &pipeline.pipeline));
+
+	entry.isReady.store(true, std::memory_order_release);
+}
+
+// Layouts are shared with every other pipeline using the same sets. Runs on
+// workers for requested pipelines.
+void PipelineManager::createLayout(const ShaderReflection& reflection, Pipeline& pipeline)
+{
+	pipeline.setLayouts.resize(reflection.getSetCount());
+	for (uint32_t set = 0; set < pipeline.setLayouts.size(); ++set)
+	{
+		bool isOverridden = set < m_setLayoutOverrides.size() && m_setLayoutOverrides[set] != VK_NULL_HANDLE;
+		pipeline.setLayouts[set] = isOverridden ? m_setLayoutOverrides[set] : m_pLayoutCache->getSetLayout(reflection.getSetLayoutBindings(set));
+	}
+	pipeline.layout = m_pLayoutCache->getPipelineLayout(pipeline.setLayouts, reflection.getPushConstantRanges());
+}
+
+VkPipelineCache PipelineManager::loadCache()
+{
+	std::vector<char> data;
+	if (!m_cachePath.empty())
+	{
+		std::ifstream file(m_cachePath, std::ios::binary);
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	// Data from another driver or GPU is dropped instead of trusting the driver to reject it
+	if (!data.empty() && !isCacheDataCompatible(data))
+	{
+		__android_log_print(ANDROID_LOG_INFO, "Vulkan", "ignoring pipeline cache from another device or driver");
+		data.clear();
+	}
+
+	VkPipelineCacheCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = data.size();
+	createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	VkPipelineCache pipelineCache;
+	CALL_VK(vkCreatePipelineCache(m_logicalDevice, &createInfo, nullptr, &pipelineCache));
+	return pipelineCache;
+}
+
+bool PipelineManager::isCacheDataCompatible(const std::vector<char>& data) const
+{
+	if (data.size() < CACHE_HEADER_SIZE)
+	{
+		return false;
+	}
+
+	// header length, header version, vendor ID, device ID, pipeline cache UUID
+	uint32_t header[4];
+	memcpy(header, data.data(), sizeof(header));
+
+	return header[0] >= CACHE_HEADER_SIZE &&
+	       header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+	       header[2] == m_physicalDeviceProperties.vendorID &&
+	       header[3] == m_physicalDeviceProperties.deviceID &&
+	       memcmp(data.data() + sizeof(header), m_physicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "../vulkan_wrapper.h"
+#include "LayoutCache.h"
+#include "ShaderCache.h"
+#include "../jobs/JobSystem.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// constant_id 0 up to this can be set per pipeline
+const uint32_t MAX_SPECIALIZATION_CONSTANTS = 4;
+
+enum class BlendMode : uint8_t
+{
+	OPAQUE,
+	ALPHA,
+	ADDITIVE
+};
+
+/*
+ * Everything that makes two graphics pipelines different, packed without
+ * padding so it is hashed and compared as raw bytes. Viewport, scissor and
+ * depth bias factors are dynamic and not part of it.
+ */
+struct PipelineKey
+{
+	// Compatibility of the render pass, from RenderGraph::getRenderPassHash()
+	uint64_t renderPassHash;
+
+	// From PipelineManager::getShaderId()
+	uint32_t vertexShader;
+	uint32_t fragmentShader;
+
+	// One vertex buffer binding, 0 for pipelines without vertex input
+	uint32_t vertexStride;
+	uint32_t subpass;
+
+	uint8_t topology;
+	uint8_t polygonMode;
+	uint8_t cullMode;
+	uint8_t frontFace;
+
+	uint8_t isDepthTestEnabled;
+	uint8_t isDepthWriteEnabled;
+	uint8_t depthCompareOp;
+	uint8_t isDepthBiasEnabled;
+
+	BlendMode blendMode;
+	uint8_t colorAttachmentCount;
+
+	// Bit per constant_id set below, the others keep the shader's default
+	uint8_t specializationMask;
+	uint8_t reserved[5];
+
+	// 32 bit each, bools as VkBool32
+	uint32_t specializationConstants[MAX_SPECIALIZATION_CONSTANTS];
+
+	// Triangle lists, back face culling, depth tested and written, alpha blending,
+	// no specialization
+	PipelineKey();
+
+	bool operator==(const PipelineKey& other) const;
+
+	// Specializes constant_id in every stage that declares it
+	void setConstant(uint32_t constantId, uint32_t value);
+	void setConstant(uint32_t constantId, int32_t value);
+	void setConstant(uint32_t constantId, float value);
+	void setConstant(uint32_t constantId, bool value);
+};
+
+static_assert(sizeof(PipelineKey) == 56, "PipelineKey must not contain padding");
+
+struct Pipeline
+{
+	VkPipeline pipeline;
+	VkPipelineLayout layout;
+	std::vector<VkDescriptorSetLayout> setLayouts;
+};
+
+/*
+ * Graphics pipelines by PipelineKey. Missing ones are created on first use
+ * through a VkPipelineCache that is loaded from and saved to the app's
+ * internal storage, so later runs skip most of the driver's compilation.
+ *
+ * Render passes are only compatible if their attachments match, which is what
+ * the key's render pass hash covers: pipelines survive swapchain recreation.
+ *
+ * requestPipeline() compiles on the job system instead and returns nullptr
+ * until the pipeline is ready, callers draw with a fallback in the meantime.
+ * Everything else is for the thread that owns the manager only.
+ *
+ * Compute pipelines have nothing but their shader to vary, they are kept by
+ * shader and always compiled right away.
+ */
+class PipelineManager
+{
+public:
+	PipelineManager();
+
+	// cachePath may be empty, the cache then only lives as long as the manager.
+	// Without a job system requested pipelines are compiled right away.
+	void create(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, LayoutCache* pLayoutCache, ShaderCache* pShaderCache, JobSystem* pJobSystem, const std::string& cachePath);
+	void destroy();
+
+	// Writes the pipeline cache to disk, also done by destroy()
+	void save();
+
+	// Shader names in the bundle
+	uint32_t getShaderId(const char* shaderPath);
+
+	// Replaces the reflected layout of a set in every pipeline, e.g. for sets
+	// whose layout needs flags reflection can't know about. Before any request.
+	void setSetLayoutOverride(uint32_t set, VkDescriptorSetLayout setLayout);
+
+	// Compiles missing pipelines (or waits for a pending one), the reference stays valid until destroy()
+	const Pipeline& getPipeline(const PipelineKey& key, VkRenderPass renderPass);
+
+	// Starts compiling a missing pipeline on a worker, nullptr until it is ready
+	const Pipeline* requestPipeline(const PipelineKey& key, VkRenderPass renderPass);
+
+	// Compiles a missing pipeline, the reference stays valid until destroy()
+	const Pipeline& getComputePipeline(const char* shaderPath);
+
+	// Blocks until no compilation is pending, e.g. before their render pass is destroyed
+	void wait();
+
+private:
+	struct Entry
+	{
+		PipelineManager* pManager;
+		PipelineKey key;
+		VkRenderPass renderPass;
+
+		// Copied, workers don't touch the manager's containers
+		std::string vertexShaderPath;
+		std::string fragmentShaderPath;
+
+		Pipeline pipeline;
+		std::atomic<bool> isReady;
+	};
+
+	Entry& getEntry(const PipelineKey& key, VkRenderPass renderPass, bool* pIsNew);
+	void createPipeline(Entry& entry);
+	void createLayout(const ShaderReflection& reflection, Pipeline& pipeline);
+	static void compileJob(const Job& job);
+	VkPipelineCache loadCache();
+	bool isCacheDataCompatible(const std::vector<char>& data) const;
+
+private:
+	VkDevice m_logicalDevice;
+	VkPhysicalDeviceProperties m_physicalDeviceProperties;
+	LayoutCache* m_pLayoutCache;
+	ShaderCache* m_pShaderCache;
+	JobSystem* m_pJobSystem;
+	JobCounter m_compileCounter;
+
+	std::string m_cachePath;
+	VkPipelineCache m_pipelineCache;
+
+	std::vector<std::string> m_shaderPaths;
+	std::vector<VkDescriptorSetLayout> m_setLayoutOverrides;
+
+	// Entries never move, buckets point into them
+	std::deque<Entry> m_entries;
+	std::unordered_map<uint64_t, std::vector<Entry*>> m_pipelines;
+
+	// By shader id, references to the values survive rehashing
+	std::unordered_map<uint32_t, Pipeline> m_computePipelines;
+};
@@ -0,0 +1,97 @@
+#include "ShaderBundle.h"
+
+#include "../FileReader.h"
+
+#include <android/log.h>
+#include <cstring>
+
+// ustar layout, pax and GNU extension entries are skipped
+const size_t TAR_BLOCK_SIZE = 512;
+const size_t TAR_NAME_OFFSET = 0;
+const size_t TAR_NAME_SIZE = 100;
+const size_t TAR_SIZE_OFFSET = 124;
+const size_t TAR_SIZE_SIZE = 12;
+const size_t TAR_TYPE_OFFSET = 156;
+const size_t TAR_MAGIC_OFFSET = 257;
+const size_t TAR_PREFIX_OFFSET = 345;
+const size_t TAR_PREFIX_SIZE = 155;
+
+bool ShaderBundle::load(const char* assetPath)
+{
+	if (!m_data.empty())
+	{
+		return true;
+	}
+
+	m_data = FileReader::readData(assetPath);
+	if (m_data.empty())
+	{
+		__android_log_print(ANDROID_LOG_ERROR, "Vulkan", "shader bundle [%s] is missing or empty", assetPath);
+		return false;
+	}
+
+	for (size_t offset = 0; offset + TAR_BLOCK_SIZE <= m_data.size();)
+	{
+		const char* pHeader = &m_data[offset];
+
+		// The archive ends with zero blocks
+		if (pHeader[TAR_NAME_OFFSET] == '\0')
+		{
+			break;
+		}
+
+		size_t dataOffset = offset + TAR_BLOCK_SIZE;
+		size_t size = parseOctal(pHeader + TAR_SIZE_OFFSET, TAR_SIZE_SIZE);
+		if (size > m_data.size() - dataOffset)
+		{
+			__android_log_print(ANDROID_LOG_ERROR, "Vulkan", "shader bundle [%s] is truncated", assetPath);
+			m_data.clear();
+			m_files.clear();
+			return false;
+		}
+
+		char type = pHeader[TAR_TYPE_OFFSET];
+		if (type == '0' || type == '\0')
+		{
+			std::string name(pHeader + TAR_NAME_OFFSET, strnlen(pHeader + TAR_NAME_OFFSET, TAR_NAME_SIZE));
+			if (memcmp(pHeader + TAR_MAGIC_OFFSET, "ustar", 5) == 0 && pHeader[TAR_PREFIX_OFFSET] != '\0')
+			{
+				name = std::string(pHeader + TAR_PREFIX_OFFSET, strnlen(pHeader + TAR_PREFIX_OFFSET, TAR_PREFIX_SIZE)) + "/" + name;
+			}
+
+			m_files[name] = {dataOffset, size};
+		}
+
+		offset = dataOffset + (size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+	}
+
+	return true;
+}
+
+bool ShaderBundle::exists(const std::string& name) const
+{
+	return m_files.find(name) != m_files.end();
+}
+
+const uint32_t* ShaderBundle::getCode(const std::string& name, size_t* pCodeSize) const
+{
+	auto it = m_files.find(name);
+	if (it == m_files.end())
+	{
+		return nullptr;
+	}
+
+	*pCodeSize = it->second.size;
+	return reinterpret_cast<const uint32_t*>(m_data.data() + it->second.offset);
+}
+
+size_t ShaderBundle::parseOctal(const char* pField, size_t fieldSize)
+{
+	size_t value = 0;
+	for (size_t i = 0; i < fieldSize && pField[i] >= '0' && pField[i] <= '7'; ++i)
+	{
+		value = value * 8 + (pField[i] - '0');
+	}
+
+	return value;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Every SPIR-V module of the app in one asset, read with a single asset
+ * manager call. The bundle is a plain tar archive written by the CMake build
+ * (cmake -E tar), the index is built from its headers while loading.
+ */
+class ShaderBundle
+{
+public:
+	// Does nothing when already loaded, false for a missing, empty or malformed archive
+	bool load(const char* assetPath);
+
+	bool exists(const std::string& name) const;
+
+	// nullptr for unknown names, the code lives as long as the bundle
+	const uint32_t* getCode(const std::string& name, size_t* pCodeSize) const;
+
+private:
+	struct File
+	{
+		size_t offset;
+		size_t size;
+	};
+
+	static size_t parseOctal(const char* pField, size_t fieldSize);
+
+private:
+	// Tar data starts at multiples of 512 bytes, aligned enough for SPIR-V words
+	std::vector<char> m_data;
+	std::unordered_map<std::string, File> m_files;
+};
@@ -0,0 +1,78 @@
+#include "ShaderCache.h"
+
+#include "../util/Hash.h"
+
+#include <android/log.h>
+#include <cstring>
+
+ShaderCache::ShaderCache() :
+		m_logicalDevice(VK_NULL_HANDLE),
+		m_pBundle(nullptr)
+{
+}
+
+void ShaderCache::create(VkDevice logicalDevice, const ShaderBundle* pBundle)
+{
+	m_logicalDevice = logicalDevice;
+	m_pBundle = pBundle;
+}
+
+void ShaderCache::destroy()
+{
+	for (const Entry& entry : m_entries)
+	{
+		vkDestroyShaderModule(m_logicalDevice, entry.module.module, nullptr);
+	}
+
+	m_names.clear();
+	m_modules.clear();
+	m_entries.clear();
+}
+
+const ShaderModule& ShaderCache::getModule(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto it = m_names.find(name);
+	if (it != m_names.end())
+	{
+		return it->second->module;
+	}
+
+	size_t codeSize = 0;
+	const uint32_t* pCode = m_pBundle->getCode(name, &codeSize);
+	if (pCode == nullptr)
+	{
+		__android_log_assert("Shader is not in the bundle.", nullptr, "%s", name.c_str());
+	}
+
+	std::vector<Entry*>& bucket = m_modules[hashBytes(pCode, codeSize)];
+	for (Entry* pEntry : bucket)
+	{
+		if (pEntry->codeSize == codeSize && memcmp(pEntry->pCode, pCode, codeSize) == 0)
+		{
+			m_names[name] = pEntry;
+			return pEntry->module;
+		}
+	}
+
+	m_entries.emplace_back();
+	Entry& entry = m_entries.back();
+	entry.pCode = pCode;
+	entry.codeSize = codeSize;
+
+	if (!entry.module.reflection.parse(pCode, codeSize))
+	{
+		__android_log_assert("Invalid SPIR-V module.", nullptr, "%s", name.c_str());
+	}
+
+	VkShaderModuleCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = codeSize;
+	createInfo.pCode = pCode;
+	CALL_VK(vkCreateShaderModule(m_logicalDevice, &createInfo, nullptr, &entry.module.module));
+
+	bucket.push_back(&entry);
+	m_names[name] = &entry;
+	return entry.module;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../vulkan_wrapper.h"
+#include "ShaderBundle.h"
+#include "ShaderReflection.h"
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ShaderModule
+{
+	VkShaderModule module;
+	ShaderReflection reflection;
+};
+
+/*
+ * Shader modules for the lifetime of the device, created from the bundle on
+ * first use and keyed by a hash of their code: names with identical code share
+ * a module, and recreated pipelines neither read nor parse anything again.
+ *
+ * getModule() may be called from any thread, pipelines are compiled on workers.
+ */
+class ShaderCache
+{
+public:
+	ShaderCache();
+
+	void create(VkDevice logicalDevice, const ShaderBundle* pBundle);
+	void destroy();
+
+	// The reference stays valid until destroy()
+	const ShaderModule& getModule(const std::string& name);
+
+private:
+	struct Entry
+	{
+		const uint32_t* pCode;
+		size_t codeSize;
+		ShaderModule module;
+	};
+
+private:
+	VkDevice m_logicalDevice;
+	const ShaderBundle* m_pBundle;
+	std::mutex m_mutex;
+
+	// Entries never move, the maps point into them
+	std::deque<Entry> m_entries;
+	std::unordered_map<uint64_t, std::vector<Entry*>> m_modules;
+	std::unordered_map<std::string, Entry*> m_names;
+};
@@ -0,0 +1,620 @@
+#include "ShaderReflection.h"
+
+#include <android/log.h>
+#include <algorithm>
+
+// The few parts of the SPIR-V specification needed to find the interface
+const uint32_t SPIRV_MAGIC = 0x07230203;
+const uint32_t SPIRV_HEADER_WORDS = 5;
+
+enum SpirvOp
+{
+	OP_ENTRY_POINT = 15,
+	OP_TYPE_BOOL = 20,
+	OP_TYPE_INT = 21,
+	OP_TYPE_FLOAT = 22,
+	OP_TYPE_VECTOR = 23,
+	OP_TYPE_MATRIX = 24,
+	OP_TYPE_IMAGE = 25,
+	OP_TYPE_SAMPLER = 26,
+	OP_TYPE_SAMPLED_IMAGE = 27,
+	OP_TYPE_ARRAY = 28,
+	OP_TYPE_RUNTIME_ARRAY = 29,
+	OP_TYPE_STRUCT = 30,
+	OP_TYPE_POINTER = 32,
+	OP_CONSTANT = 43,
+	OP_SPEC_CONSTANT = 50,
+	OP_VARIABLE = 59,
+	OP_DECORATE = 71,
+	OP_MEMBER_DECORATE = 72
+};
+
+enum SpirvDecoration
+{
+	DECORATION_SPEC_ID = 1,
+	DECORATION_BUFFER_BLOCK = 3,
+	DECORATION_ARRAY_STRIDE = 6,
+	DECORATION_MATRIX_STRIDE = 7,
+	DECORATION_BUILT_IN = 11,
+	DECORATION_LOCATION = 30,
+	DECORATION_BINDING = 33,
+	DECORATION_DESCRIPTOR_SET = 34,
+	DECORATION_OFFSET = 35
+};
+
+enum SpirvStorageClass
+{
+	STORAGE_CLASS_UNIFORM_CONSTANT = 0,
+	STORAGE_CLASS_INPUT = 1,
+	STORAGE_CLASS_UNIFORM = 2,
+	STORAGE_CLASS_PUSH_CONSTANT = 9,
+	STORAGE_CLASS_STORAGE_BUFFER = 12
+};
+
+const uint32_t IMAGE_DIM_BUFFER = 5;
+const uint32_t IMAGE_DIM_SUBPASS_DATA = 6;
+const uint32_t IMAGE_SAMPLED_STORAGE = 2;
+
+// Indexed by execution model
+const VkShaderStageFlagBits EXECUTION_MODEL_STAGES[] = {
+		VK_SHADER_STAGE_VERTEX_BIT,
+		VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,
+		VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT,
+		VK_SHADER_STAGE_GEOMETRY_BIT,
+		VK_SHADER_STAGE_FRAGMENT_BIT,
+		VK_SHADER_STAGE_COMPUTE_BIT
+};
+
+// 32 bit inputs by component count
+const VkFormat FLOAT_FORMATS[] = {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+const VkFormat SINT_FORMATS[] = {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+const VkFormat UINT_FORMATS[] = {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+
+// Result id of a type or constant with what is known about it
+struct ShaderReflection::Id
+{
+	uint32_t opcode = 0;
+	// Words after the result id, only valid while parsing
+	const uint32_t* pOperands = nullptr;
+	uint32_t nOperands = 0;
+
+	bool hasSet = false;
+	bool hasBinding = false;
+	bool hasLocation = false;
+	bool isBuiltIn = false;
+	bool isBufferBlock = false;
+
+	uint32_t set = 0;
+	uint32_t binding = 0;
+	uint32_t location = 0;
+	uint32_t arrayStride = 0;
+
+	std::vector<uint32_t> memberOffsets;
+	std::vector<uint32_t> memberMatrixStrides;
+};
+
+struct Variable
+{
+	uint32_t id;
+	uint32_t pointerTypeId;
+	uint32_t storageClass;
+};
+
+ShaderReflection::ShaderReflection() :
+		m_stageFlags(0)
+{
+}
+
+bool ShaderReflection::parse(const uint32_t* pCode, size_t codeSize)
+{
+	size_t nWords = codeSize / sizeof(uint32_t);
+	if (codeSize % sizeof(uint32_t) != 0 || nWords < SPIRV_HEADER_WORDS || pCode[0] != SPIRV_MAGIC)
+	{
+		return false;
+	}
+
+	std::vector<Id> ids(pCode[3]);
+	std::vector<Variable> variables;
+
+	for (size_t i = SPIRV_HEADER_WORDS; i < nWords;)
+	{
+		const uint32_t* pWords = &pCode[i];
+		uint32_t wordCount = pWords[0] >> 16;
+		uint32_t opcode = pWords[0] & 0xFFFF;
+
+		if (wordCount == 0 || i + wordCount > nWords)
+		{
+			return false;
+		}
+		i += wordCount;
+
+		switch (opcode)
+		{
+			case OP_ENTRY_POINT:
+				if (wordCount > 1 && pWords[1] < sizeof(EXECUTION_MODEL_STAGES) / sizeof(EXECUTION_MODEL_STAGES[0]))
+				{
+					m_stageFlags |= EXECUTION_MODEL_STAGES[pWords[1]];
+				}
+				break;
+
+			case OP_TYPE_BOOL:
+			case OP_TYPE_INT:
+			case OP_TYPE_FLOAT:
+			case OP_TYPE_VECTOR:
+			case OP_TYPE_MATRIX:
+			case OP_TYPE_IMAGE:
+			case OP_TYPE_SAMPLER:
+			case OP_TYPE_SAMPLED_IMAGE:
+			case OP_TYPE_ARRAY:
+			case OP_TYPE_RUNTIME_ARRAY:
+			case OP_TYPE_STRUCT:
+			case OP_TYPE_POINTER:
+				if (wordCount > 1 && pWords[1] < ids.size())
+				{
+					Id& type = ids[pWords[1]];
+					type.opcode = opcode;
+					type.pOperands = pWords + 2;
+					type.nOperands = wordCount - 2;
+				}
+				break;
+
+			// Array lengths, spec constants only with their default value
+			case OP_CONSTANT:
+			case OP_SPEC_CONSTANT:
+				if (wordCount > 3 && pWords[2] < ids.size())
+				{
+					Id& constant = ids[pWords[2]];
+					constant.opcode = OP_CONSTANT;
+					constant.pOperands = pWords + 3;
+					constant.nOperands = wordCount - 3;
+				}
+				break;
+
+			case OP_VARIABLE:
+				if (wordCount > 3)
+				{
+					variables.push_back({pWords[2], pWords[1], pWords[3]});
+				}
+				break;
+
+			case OP_DECORATE:
+				if (wordCount > 2 && pWords[1] < ids.size())
+				{
+					Id& target = ids[pWords[1]];
+					uint32_t value = wordCount > 3 ? pWords[3] : 0;
+
+					switch (pWords[2])
+					{
+						case DECORATION_SPEC_ID: m_specializationConstants.push_back(value); break;
+						case DECORATION_BUFFER_BLOCK: target.isBufferBlock = true; break;
+						case DECORATION_ARRAY_STRIDE: target.arrayStride = value; break;
+						case DECORATION_BUILT_IN: target.isBuiltIn = true; break;
+						case DECORATION_LOCATION: target.hasLocation = true; target.location = value; break;
+						case DECORATION_BINDING: target.hasBinding = true; target.binding = value; break;
+						case DECORATION_DESCRIPTOR_SET: target.hasSet = true; target.set = value; break;
+						default: break;
+					}
+				}
+				break;
+
+			case OP_MEMBER_DECORATE:
+				if (wordCount > 4 && pWords[1] < ids.size())
+				{
+					Id& target = ids[pWords[1]];
+					uint32_t member = pWords[2];
+
+					if (pWords[3] == DECORATION_OFFSET)
+					{
+						target.memberOffsets.resize(std::max<size_t>(target.memberOffsets.size(), member + 1), 0);
+						target.memberOffsets[member] = pWords[4];
+					}
+					else if (pWords[3] == DECORATION_MATRIX_STRIDE)
+					{
+						target.memberMatrixStrides.resize(std::max<size_t>(target.memberMatrixStrides.size(), member + 1), 0);
+						target.memberMatrixStrides[member] = pWords[4];
+					}
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	for (const Variable& variable : variables)
+	{
+		const uint32_t* pPointer = getOperand(ids, variable.pointerTypeId, OP_TYPE_POINTER, 2);
+		if (variable.id >= ids.size() || pPointer == nullptr)
+		{
+			continue;
+		}
+
+		const Id& id = ids[variable.id];
+		uint32_t typeId = pPointer[1];
+
+		switch (variable.storageClass)
+		{
+			case STORAGE_CLASS_UNIFORM_CONSTANT:
+			case STORAGE_CLASS_UNIFORM:
+			case STORAGE_CLASS_STORAGE_BUFFER:
+			{
+				ReflectedBinding binding = {};
+				binding.set = id.set;
+				binding.binding = id.binding;
+				binding.stageFlags = m_stageFlags;
+
+				if (id.hasBinding && getDescriptorType(ids, typeId, variable.storageClass, &binding.type, &binding.count))
+				{
+					addBinding(binding);
+				}
+				break;
+			}
+
+			case STORAGE_CLASS_PUSH_CONSTANT:
+			{
+				if (typeId >= ids.size() || ids[typeId].opcode != OP_TYPE_STRUCT || ids[typeId].memberOffsets.empty())
+				{
+					break;
+				}
+
+				VkPushConstantRange range = {};
+				range.stageFlags = m_stageFlags;
+				const std::vector<uint32_t>& memberOffsets = ids[typeId].memberOffsets;
+				range.offset = *std::min_element(memberOffsets.begin(), memberOffsets.end());
+				range.size = getTypeSize(ids, typeId, 0) - range.offset;
+
+				addPushConstantRange(range);
+				break;
+			}
+
+			case STORAGE_CLASS_INPUT:
+			{
+				// Vertex attributes only, other stages read the previous stage's outputs
+				if (m_stageFlags != VK_SHADER_STAGE_VERTEX_BIT || id.isBuiltIn || !id.hasLocation)
+				{
+					break;
+				}
+
+				ReflectedInput input = {};
+				input.location = id.location;
+
+				if (getInputFormat(ids, typeId, &input.format, &input.size))
+				{
+					m_inputs.push_back(input);
+				}
+				else
+				{
+					__android_log_print(ANDROID_LOG_ERROR, "Vulkan", "vertex input at location [%u] has an unsupported type", id.location);
+				}
+				break;
+			}
+
+			default:
+				break;
+		}
+	}
+
+	std::sort(m_inputs.begin(), m_inputs.end(), [](const ReflectedInput& a, const ReflectedInput& b)
+	{
+		return a.location < b.location;
+	});
+
+	sortSpecializationConstants();
+
+	return true;
+}
+
+void ShaderReflection::merge(const ShaderReflection& other)
+{
+	m_stageFlags |= other.m_stageFlags;
+
+	for (const ReflectedBinding& binding : other.m_bindings)
+	{
+		addBinding(binding);
+	}
+
+	for (const VkPushConstantRange& range : other.m_pushConstantRanges)
+	{
+		addPushConstantRange(range);
+	}
+
+	if (m_inputs.empty())
+	{
+		m_inputs = other.m_inputs;
+	}
+
+	m_specializationConstants.insert(m_specializationConstants.end(), other.m_specializationConstants.begin(), other.m_specializationConstants.end());
+	sortSpecializationConstants();
+}
+
+bool ShaderReflection::hasSpecializationConstant(uint32_t constantId) const
+{
+	return std::binary_search(m_specializationConstants.begin(), m_specializationConstants.end(), constantId);
+}
+
+void ShaderReflection::sortSpecializationConstants()
+{
+	std::sort(m_specializationConstants.begin(), m_specializationConstants.end());
+	m_specializationConstants.erase(std::unique(m_specializationConstants.begin(), m_specializationConstants.end()), m_specializationConstants.end());
+}
+
+uint32_t ShaderReflection::getSetCount() const
+{
+	uint32_t nSets = 0;
+	for (const ReflectedBinding& binding : m_bindings)
+	{
+		nSets = std::max(nSets, binding.set + 1);
+	}
+
+	return nSets;
+}
+
+std::vector<VkDescriptorSetLayoutBinding> ShaderReflection::getSetLayoutBindings(uint32_t set) const
+{
+	std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+	for (const ReflectedBinding& binding : m_bindings)
+	{
+		if (binding.set != set)
+		{
+			continue;
+		}
+
+		VkDescriptorSetLayoutBinding layoutBinding = {};
+		layoutBinding.binding = binding.binding;
+		layoutBinding.descriptorType = binding.type;
+		layoutBinding.descriptorCount = binding.count;
+		layoutBinding.stageFlags = binding.stageFlags;
+		layoutBinding.pImmutableSamplers = nullptr;
+
+		layoutBindings.push_back(layoutBinding);
+	}
+
+	return layoutBindings;
+}
+
+uint32_t ShaderReflection::getVertexAttributes(uint32_t binding, std::vector<VkVertexInputAttributeDescription>& attributes) const
+{
+	attributes.resize(m_inputs.size());
+
+	uint32_t offset = 0;
+	for (size_t i = 0; i < m_inputs.size(); ++i)
+	{
+		attributes[i].binding = binding;
+		attributes[i].location = m_inputs[i].location;
+		attributes[i].format = m_inputs[i].format;
+		attributes[i].offset = offset;
+
+		offset += m_inputs[i].size;
+	}
+
+	return offset;
+}
+
+void ShaderReflection::addBinding(const ReflectedBinding& binding)
+{
+	for (ReflectedBinding& existing : m_bindings)
+	{
+		if (existing.set == binding.set && existing.binding == binding.binding)
+		{
+			if (existing.type != binding.type)
+			{
+				__android_log_print(ANDROID_LOG_ERROR, "Vulkan", "set [%u] binding [%u] is declared with different types", binding.set, binding.binding);
+			}
+
+			existing.stageFlags |= binding.stageFlags;
+			return;
+		}
+	}
+
+	m_bindings.push_back(binding);
+	std::sort(m_bindings.begin(), m_bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b)
+	{
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	});
+}
+
+void ShaderReflection::addPushConstantRange(const VkPushConstantRange& range)
+{
+	for (VkPushConstantRange& existing : m_pushConstantRanges)
+	{
+		if (existing.offset == range.offset && existing.size == range.size)
+		{
+			existing.stageFlags |= range.stageFlags;
+			return;
+		}
+	}
+
+	m_pushConstantRanges.push_back(range);
+}
+
+bool ShaderReflection::getDescriptorType(const std::vector<Id>& ids, uint32_t typeId, uint32_t storageClass, VkDescriptorType* pType, uint32_t* pCount)
+{
+	*pCount = 1;
+
+	// Arrays of descriptors, possibly nested
+	while (typeId < ids.size() && (ids[typeId].opcode == OP_TYPE_ARRAY || ids[typeId].opcode == OP_TYPE_RUNTIME_ARRAY))
+	{
+		const Id& array = ids[typeId];
+		if (array.nOperands < 1)
+		{
+			return false;
+		}
+
+		if (array.opcode == OP_TYPE_RUNTIME_ARRAY)
+		{
+			*pCount = 0;
+		}
+		else
+		{
+			const uint32_t* pLength = array.nOperands > 1 ? getOperand(ids, array.pOperands[1], OP_CONSTANT, 1) : nullptr;
+			*pCount *= pLength != nullptr ? pLength[0] : 1;
+		}
+
+		typeId = array.pOperands[0];
+	}
+
+	if (typeId >= ids.size())
+	{
+		return false;
+	}
+
+	const Id& type = ids[typeId];
+	switch (type.opcode)
+	{
+		case OP_TYPE_STRUCT:
+			if (storageClass == STORAGE_CLASS_STORAGE_BUFFER || type.isBufferBlock)
+			{
+				*pType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				return true;
+			}
+			*pType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			return storageClass == STORAGE_CLASS_UNIFORM;
+
+		case OP_TYPE_SAMPLER:
+			*pType = VK_DESCRIPTOR_TYPE_SAMPLER;
+			return true;
+
+		case OP_TYPE_SAMPLED_IMAGE:
+			*pType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			return true;
+
+		case OP_TYPE_IMAGE:
+		{
+			// sampled type, dim, depth, arrayed, multisampled, sampled
+			if (type.nOperands < 6)
+			{
+				return false;
+			}
+
+			uint32_t dim = type.pOperands[1];
+			bool isStorage = type.pOperands[5] == IMAGE_SAMPLED_STORAGE;
+
+			if (dim == IMAGE_DIM_BUFFER)
+			{
+				*pType = isStorage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			}
+			else if (dim == IMAGE_DIM_SUBPASS_DATA)
+			{
+				*pType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			}
+			else
+			{
+				*pType = isStorage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			}
+			return true;
+		}
+
+		default:
+			return false;
+	}
+}
+
+uint32_t ShaderReflection::getTypeSize(const std::vector<Id>& ids, uint32_t typeId, uint32_t matrixStride)
+{
+	if (typeId >= ids.size())
+	{
+		return 0;
+	}
+
+	const Id& type = ids[typeId];
+	switch (type.opcode)
+	{
+		case OP_TYPE_BOOL:
+			return 4;
+
+		case OP_TYPE_INT:
+		case OP_TYPE_FLOAT:
+			return type.nOperands > 0 ? type.pOperands[0] / 8 : 0;
+
+		case OP_TYPE_VECTOR:
+			return type.nOperands > 1 ? getTypeSize(ids, type.pOperands[0], 0) * type.pOperands[1] : 0;
+
+		case OP_TYPE_MATRIX:
+		{
+			if (type.nOperands < 2)
+			{
+				return 0;
+			}
+
+			uint32_t columnSize = matrixStride != 0 ? matrixStride : getTypeSize(ids, type.pOperands[0], 0);
+			return columnSize * type.pOperands[1];
+		}
+
+		case OP_TYPE_ARRAY:
+		{
+			const uint32_t* pLength = type.nOperands > 1 ? getOperand(ids, type.pOperands[1], OP_CONSTANT, 1) : nullptr;
+			if (pLength == nullptr)
+			{
+				return 0;
+			}
+
+			uint32_t elementSize = type.arrayStride != 0 ? type.arrayStride : getTypeSize(ids, type.pOperands[0], matrixStride);
+			return elementSize * pLength[0];
+		}
+
+		case OP_TYPE_STRUCT:
+		{
+			// Members are placed by their Offset decoration, not in order
+			uint32_t size = 0;
+			for (uint32_t i = 0; i < type.nOperands && i < type.memberOffsets.size(); ++i)
+			{
+				uint32_t memberMatrixStride = i < type.memberMatrixStrides.size() ? type.memberMatrixStrides[i] : 0;
+				size = std::max(size, type.memberOffsets[i] + getTypeSize(ids, type.pOperands[i], memberMatrixStride));
+			}
+			return size;
+		}
+
+		default:
+			// Runtime arrays have no static size
+			return 0;
+	}
+}
+
+bool ShaderReflection::getInputFormat(const std::vector<Id>& ids, uint32_t typeId, VkFormat* pFormat, uint32_t* pSize)
+{
+	uint32_t nComponents = 1;
+
+	const uint32_t* pVector = getOperand(ids, typeId, OP_TYPE_VECTOR, 2);
+	if (pVector != nullptr)
+	{
+		typeId = pVector[0];
+		nComponents = pVector[1];
+	}
+
+	if (typeId >= ids.size() || nComponents < 1 || nComponents > 4)
+	{
+		return false;
+	}
+
+	const Id& component = ids[typeId];
+	if (component.nOperands < 1 || component.pOperands[0] != 32)
+	{
+		return false;
+	}
+
+	if (component.opcode == OP_TYPE_FLOAT)
+	{
+		*pFormat = FLOAT_FORMATS[nComponents - 1];
+	}
+	else if (component.opcode == OP_TYPE_INT && component.nOperands > 1)
+	{
+		*pFormat = component.pOperands[1] != 0 ? SINT_FORMATS[nComponents - 1] : UINT_FORMATS[nComponents - 1];
+	}
+	else
+	{
+		return false;
+	}
+
+	*pSize = nComponents * sizeof(uint32_t);
+	return true;
+}
+
+const uint32_t* ShaderReflection::getOperand(const std::vector<Id>& ids, uint32_t id, uint32_t opcode, uint32_t nOperands)
+{
+	if (id >= ids.size() || ids[id].opcode != opcode || ids[id].nOperands < nOperands)
+	{
+		return nullptr;
+	}
+
+	return ids[id].pOperands;
+}
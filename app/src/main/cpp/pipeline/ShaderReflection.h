@@ -0,0 +1,101 @@
+#pragma once
+
+#include "../vulkan_wrapper.h"
+
+#include <cstdint>
+#include <vector>
+
+struct ReflectedBinding
+{
+	uint32_t set;
+	uint32_t binding;
+	VkDescriptorType type;
+	// 0 for runtime sized arrays
+	uint32_t count;
+	VkShaderStageFlags stageFlags;
+};
+
+struct ReflectedInput
+{
+	uint32_t location;
+	VkFormat format;
+	uint32_t size;
+};
+
+/*
+ * Reads the interface of SPIR-V modules: descriptor bindings, push constant
+ * ranges, specialization constant ids and (for vertex shaders) the input
+ * locations. Only the few instructions that describe them are looked at,
+ * everything else is skipped.
+ *
+ * Stages of one pipeline are merged into a single reflection, the layouts are
+ * then created from it by LayoutCache.
+ */
+class ShaderReflection
+{
+public:
+	ShaderReflection();
+
+	// Returns false when the code is not a SPIR-V module
+	bool parse(const uint32_t* pCode, size_t codeSize);
+
+	// Bindings used by several stages get the union of their stage flags
+	void merge(const ShaderReflection& other);
+
+	// Stages parsed into this reflection, several once merged
+	VkShaderStageFlags getStageFlags() const
+	{
+		return m_stageFlags;
+	}
+
+	// One past the highest set number used
+	uint32_t getSetCount() const;
+	std::vector<VkDescriptorSetLayoutBinding> getSetLayoutBindings(uint32_t set) const;
+
+	const std::vector<ReflectedBinding>& getBindings() const
+	{
+		return m_bindings;
+	}
+
+	const std::vector<VkPushConstantRange>& getPushConstantRanges() const
+	{
+		return m_pushConstantRanges;
+	}
+
+	// Sorted by location
+	const std::vector<ReflectedInput>& getInputs() const
+	{
+		return m_inputs;
+	}
+
+	// Attributes of a single vertex buffer binding with the inputs packed in location order
+	uint32_t getVertexAttributes(uint32_t binding, std::vector<VkVertexInputAttributeDescription>& attributes) const;
+
+	// constant_id of the specialization constants, sorted
+	const std::vector<uint32_t>& getSpecializationConstants() const
+	{
+		return m_specializationConstants;
+	}
+
+	bool hasSpecializationConstant(uint32_t constantId) const;
+
+private:
+	struct Id;
+
+	void addBinding(const ReflectedBinding& binding);
+	void addPushConstantRange(const VkPushConstantRange& range);
+	void sortSpecializationConstants();
+
+	static bool getDescriptorType(const std::vector<Id>& ids, uint32_t typeId, uint32_t storageClass, VkDescriptorType* pType, uint32_t* pCount);
+	static uint32_t getTypeSize(const std::vector<Id>& ids, uint32_t typeId, uint32_t matrixStride);
+	static bool getInputFormat(const std::vector<Id>& ids, uint32_t typeId, VkFormat* pFormat, uint32_t* pSize);
+	static const uint32_t* getOperand(const std::vector<Id>& ids, uint32_t id, uint32_t opcode, uint32_t nOperands);
+
+private:
+	VkShaderStageFlags m_stageFlags;
+
+	std::vector<ReflectedBinding> m_bindings;
+	std::vector<VkPushConstantRange> m_pushConstantRanges;
+	std::vector<ReflectedInput> m_inputs;
+	std::vector<uint32_t> m_specializationConstants;
+};
@@ -0,0 +1,266 @@
+#include "TransformHierarchy.h"
+
+#include "../jobs/JobSystem.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Nodes per job, smaller ranges aren't worth the scheduling
+const uint32_t NODES_PER_JOB = 256;
+
+const uint32_t NO_PARENT = UINT32_MAX;
+
+// Reorders the elements of values so that values[i] = old values[order[i]]
+template<typename T>
+static void permute(std::vector<T>& values, const std::vector<uint32_t>& order)
+{
+	std::vector<T> sorted(values.size());
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		sorted[i] = values[order[i]];
+	}
+	values.swap(sorted);
+}
+
+TransformHierarchy::TransformHierarchy() :
+		m_needsSort(false)
+{
+}
+
+TransformId TransformHierarchy::create(TransformId parent)
+{
+	TransformId id = (TransformId) m_indexOf.size();
+	uint32_t index = (uint32_t) m_parent.size();
+
+	m_translationX.push_back(0.0f);
+	m_translationY.push_back(0.0f);
+	m_translationZ.push_back(0.0f);
+
+	m_rotationX.push_back(0.0f);
+	m_rotationY.push_back(0.0f);
+	m_rotationZ.push_back(0.0f);
+	m_rotationW.push_back(1.0f);
+
+	m_scaleX.push_back(1.0f);
+	m_scaleY.push_back(1.0f);
+	m_scaleZ.push_back(1.0f);
+
+	if (parent == INVALID_ID)
+	{
+		m_parent.push_back(NO_PARENT);
+		m_depth.push_back(0);
+	}
+	else
+	{
+		uint32_t parentIndex = m_indexOf[parent];
+		m_parent.push_back(parentIndex);
+		m_depth.push_back(m_depth[parentIndex] + 1);
+	}
+
+	m_indexOf.push_back(index);
+	m_idOf.push_back(id);
+
+	m_isLocalDirty.push_back(1);
+	m_hasWorldChanged.push_back(0);
+	m_local.push_back(glm::mat4(1.0f));
+	m_world.push_back(glm::mat4(1.0f));
+
+	m_needsSort = true;
+	return id;
+}
+
+void TransformHierarchy::setTranslation(TransformId id, const glm::vec3& translation)
+{
+	uint32_t index = m_indexOf[id];
+	m_translationX[index] = translation.x;
+	m_translationY[index] = translation.y;
+	m_translationZ[index] = translation.z;
+	m_isLocalDirty[index] = 1;
+}
+
+void TransformHierarchy::setRotation(TransformId id, const glm::quat& rotation)
+{
+	uint32_t index = m_indexOf[id];
+	m_rotationX[index] = rotation.x;
+	m_rotationY[index] = rotation.y;
+	m_rotationZ[index] = rotation.z;
+	m_rotationW[index] = rotation.w;
+	m_isLocalDirty[index] = 1;
+}
+
+void TransformHierarchy::setScale(TransformId id, const glm::vec3& scale)
+{
+	uint32_t index = m_indexOf[id];
+	m_scaleX[index] = scale.x;
+	m_scaleY[index] = scale.y;
+	m_scaleZ[index] = scale.z;
+	m_isLocalDirty[index] = 1;
+}
+
+void TransformHierarchy::update(JobSystem* pJobSystem)
+{
+	if (m_needsSort)
+	{
+		sortByDepth();
+	}
+
+	uint32_t nNodes = getCount();
+	if (nNodes == 0)
+	{
+		return;
+	}
+
+	std::memset(m_hasWorldChanged.data(), 0, m_hasWorldChanged.size());
+
+	if (pJobSystem != nullptr && nNodes > NODES_PER_JOB)
+	{
+		pJobSystem->parallelFor(nNodes, NODES_PER_JOB, [this](uint32_t begin, uint32_t end)
+		{
+			updateLocal(begin, end);
+		});
+
+		// A level only reads the world matrices of the levels before it
+		for (size_t level = 0; level + 1 < m_levelStarts.size(); ++level)
+		{
+			uint32_t levelStart = m_levelStarts[level];
+			pJobSystem->parallelFor(m_levelStarts[level + 1] - levelStart, NODES_PER_JOB, [this, levelStart](uint32_t begin, uint32_t end)
+			{
+				updateWorld(levelStart + begin, levelStart + end);
+			});
+		}
+	}
+	else
+	{
+		updateLocal(0, nNodes);
+		updateWorld(0, nNodes);
+	}
+
+	std::memset(m_isLocalDirty.data(), 0, m_isLocalDirty.size());
+}
+
+void TransformHierarchy::sortByDepth()
+{
+	uint32_t nNodes = getCount();
+
+	std::vector<uint32_t> order(nNodes);
+	for (uint32_t i = 0; i < nNodes; ++i)
+	{
+		order[i] = i;
+	}
+
+	// Stable, so already sorted hierarchies keep their order
+	std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+	{
+		return m_depth[a] < m_depth[b];
+	});
+
+	std::vector<uint32_t> newIndexOf(nNodes);
+	for (uint32_t i = 0; i < nNodes; ++i)
+	{
+		newIndexOf[order[i]] = i;
+	}
+
+	permute(m_translationX, order);
+	permute(m_translationY, order);
+	permute(m_translationZ, order);
+	permute(m_rotationX, order);
+	permute(m_rotationY, order);
+	permute(m_rotationZ, order);
+	permute(m_rotationW, order);
+	permute(m_scaleX, order);
+	permute(m_scaleY, order);
+	permute(m_scaleZ, order);
+	permute(m_parent, order);
+	permute(m_depth, order);
+	permute(m_idOf, order);
+	permute(m_isLocalDirty, order);
+	permute(m_local, order);
+	permute(m_world, order);
+
+	for (uint32_t i = 0; i < nNodes; ++i)
+	{
+		if (m_parent[i] != NO_PARENT)
+		{
+			m_parent[i] = newIndexOf[m_parent[i]];
+		}
+		m_indexOf[m_idOf[i]] = i;
+	}
+
+	m_levelStarts.clear();
+	for (uint32_t i = 0; i < nNodes; ++i)
+	{
+		if (i == 0 || m_depth[i] != m_depth[i - 1])
+		{
+			m_levelStarts.push_back(i);
+		}
+	}
+	m_levelStarts.push_back(nNodes);
+
+	m_needsSort = false;
+}
+
+void TransformHierarchy::updateLocal(uint32_t begin, uint32_t end)
+{
+	const float* tx = m_translationX.data();
+	const float* ty = m_translationY.data();
+	const float* tz = m_translationZ.data();
+	const float* qx = m_rotationX.data();
+	const float* qy = m_rotationY.data();
+	const float* qz = m_rotationZ.data();
+	const float* qw = m_rotationW.data();
+	const float* sx = m_scaleX.data();
+	const float* sy = m_scaleY.data();
+	const float* sz = m_scaleZ.data();
+
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		if (!m_isLocalDirty[i])
+		{
+			continue;
+		}
+
+		// T * R * S, rotation matrix columns scaled by the scale components
+		float xx = qx[i] * qx[i], yy = qy[i] * qy[i], zz = qz[i] * qz[i];
+		float xy = qx[i] * qy[i], xz = qx[i] * qz[i], yz = qy[i] * qz[i];
+		float wx = qw[i] * qx[i], wy = qw[i] * qy[i], wz = qw[i] * qz[i];
+
+		float* m = &m_local[i][0][0];
+
+		m[0] = (1.0f - 2.0f * (yy + zz)) * sx[i];
+		m[1] = 2.0f * (xy + wz) * sx[i];
+		m[2] = 2.0f * (xz - wy) * sx[i];
+		m[3] = 0.0f;
+
+		m[4] = 2.0f * (xy - wz) * sy[i];
+		m[5] = (1.0f - 2.0f * (xx + zz)) * sy[i];
+		m[6] = 2.0f * (yz + wx) * sy[i];
+		m[7] = 0.0f;
+
+		m[8] = 2.0f * (xz + wy) * sz[i];
+		m[9] = 2.0f * (yz - wx) * sz[i];
+		m[10] = (1.0f - 2.0f * (xx + yy)) * sz[i];
+		m[11] = 0.0f;
+
+		m[12] = tx[i];
+		m[13] = ty[i];
+		m[14] = tz[i];
+		m[15] = 1.0f;
+	}
+}
+
+void TransformHierarchy::updateWorld(uint32_t begin, uint32_t end)
+{
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		uint32_t parent = m_parent[i];
+		bool hasParentChanged = parent != NO_PARENT && m_hasWorldChanged[parent];
+
+		if (!m_isLocalDirty[i] && !hasParentChanged)
+		{
+			continue;
+		}
+
+		m_world[i] = parent == NO_PARENT ? m_local[i] : m_world[parent] * m_local[i];
+		m_hasWorldChanged[i] = 1;
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+typedef uint32_t TransformId;
+
+/*
+ * Scene transforms in structure of arrays form.
+ *
+ * Local translation / rotation / scale are stored component by component and
+ * nodes are kept sorted by depth, so every parent comes before its children and
+ * each depth level is a contiguous range that only reads the levels above it.
+ * update() is then a handful of linear passes the compiler can vectorize and
+ * the job system can split. Only nodes whose local transform changed, or whose
+ * parent moved, are recomputed.
+ */
+class TransformHierarchy
+{
+public:
+	static const TransformId INVALID_ID = UINT32_MAX;
+
+	TransformHierarchy();
+
+	TransformId create(TransformId parent = INVALID_ID);
+
+	void setTranslation(TransformId id, const glm::vec3& translation);
+	void setRotation(TransformId id, const glm::quat& rotation);
+	void setScale(TransformId id, const glm::vec3& scale);
+
+	// Valid after update()
+	const glm::mat4& getWorld(TransformId id) const
+	{
+		return m_world[m_indexOf[id]];
+	}
+
+	uint32_t getCount() const
+	{
+		return (uint32_t) m_parent.size();
+	}
+
+	// Recomputes the changed world matrices, over the workers when given a job system.
+	void update(JobSystem* pJobSystem = nullptr);
+
+private:
+	void sortByDepth();
+
+	void updateLocal(uint32_t begin, uint32_t end);
+	void updateWorld(uint32_t begin, uint32_t end);
+
+private:
+	// LOCAL TRS, indexed by sorted position
+	std::vector<float> m_translationX;
+	std::vector<float> m_translationY;
+	std::vector<float> m_translationZ;
+
+	std::vector<float> m_rotationX;
+	std::vector<float> m_rotationY;
+	std::vector<float> m_rotationZ;
+	std::vector<float> m_rotationW;
+
+	std::vector<float> m_scaleX;
+	std::vector<float> m_scaleY;
+	std::vector<float> m_scaleZ;
+
+	// HIERARCHY
+	std::vector<uint32_t> m_parent;
+	std::vector<uint32_t> m_depth;
+
+	// First node of each depth level, plus the end of the last one
+	std::vector<uint32_t> m_levelStarts;
+	bool m_needsSort;
+
+	// Stable ids to sorted positions and back
+	std::vector<uint32_t> m_indexOf;
+	std::vector<TransformId> m_idOf;
+
+	// DIRTY FLAGS
+	std::vector<uint8_t> m_isLocalDirty;
+	std::vector<uint8_t> m_hasWorldChanged;
+
+	std::vector<glm::mat4> m_local;
+	std::vector<glm::mat4> m_world;
+};
@@ -0,0 +1,140 @@
+#include "CascadedShadows.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// Pixels closer than this use the first cascade
+const float SHADOW_NEAR = 0.1f;
+
+// Blend of logarithmic (1) and uniform (0) splits, logarithmic ones match the
+// perspective's texel density but leave the first cascade tiny
+const float SPLIT_LAMBDA = 0.75f;
+
+// Frames between renders of a cascade with moved casters
+const std::array<uint32_t, SHADOW_CASCADE_COUNT> UPDATE_INTERVALS = {1, 2, 4};
+
+// Extra radius of a cascade, room for the texel snapping and for the camera to
+// move before the map has to follow
+const std::array<float, SHADOW_CASCADE_COUNT> FIT_SLACK = {0.05f, 0.1f, 0.15f};
+
+// Bounding radii are rounded up to this, otherwise rounding errors resize the map
+const float RADIUS_STEP = 1.0f / 16.0f;
+
+// Cosine of the angle the sun may turn before every map is rendered again
+const float SUN_TOLERANCE = 0.99999f;
+
+CascadedShadows::CascadedShadows(uint32_t mapSize, float shadowDistance) :
+		m_mapSize(mapSize),
+		m_shadowDistance(shadowDistance),
+		m_cascades(),
+		m_casterVersion(0)
+{
+	invalidate();
+}
+
+void CascadedShadows::invalidate()
+{
+	for (Cascade& cascade : m_cascades)
+	{
+		cascade.isValid = false;
+		cascade.isScheduled = false;
+	}
+}
+
+void CascadedShadows::update(const FrameState& frameState)
+{
+	if (frameState.models != m_casterModels)
+	{
+		m_casterModels = frameState.models;
+		++m_casterVersion;
+	}
+
+	// The same rotation for every cascade, they only differ in their snapped center
+	glm::vec3 lightDirection = glm::normalize(frameState.sun.direction);
+	glm::vec3 up = std::abs(lightDirection.z) < 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+	glm::mat4 viewToLight = lightView * glm::inverse(frameState.view);
+
+	// View space rays through the corners of the screen, scaled to a depth of 1.
+	// Works for any perspective projection, reverse-Z and infinite ones included.
+	glm::mat4 inverseProjection = glm::inverse(frameState.projection);
+	std::array<glm::vec3, 4> cornerRays;
+	for (uint32_t i = 0; i < cornerRays.size(); ++i)
+	{
+		glm::vec4 point = inverseProjection * glm::vec4((i & 1) != 0 ? 1.0f : -1.0f, (i & 2) != 0 ? 1.0f : -1.0f, 0.5f, 1.0f);
+		glm::vec3 ray = glm::vec3(point) / point.w;
+		cornerRays[i] = ray / -ray.z;
+	}
+
+	bool isDistantScheduled = false;
+	for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		Cascade& cascade = m_cascades[i];
+		++cascade.framesSinceUpdate;
+
+		float nearDepth = getSplitDepth(i);
+		float farDepth = getSplitDepth(i + 1);
+
+		// Bounding sphere of the slice's corners. Computed in view space, it is
+		// the same however the camera is turned.
+		glm::vec3 center(0.0f);
+		for (const glm::vec3& ray : cornerRays)
+		{
+			center += ray * nearDepth + ray * farDepth;
+		}
+		center /= 2.0f * cornerRays.size();
+
+		float radius = 0.0f;
+		for (const glm::vec3& ray : cornerRays)
+		{
+			radius = std::max(radius, std::max(glm::length(ray * nearDepth - center), glm::length(ray * farDepth - center)));
+		}
+		radius = std::ceil(radius / RADIUS_STEP) * RADIUS_STEP;
+
+		glm::vec3 lightCenter = glm::vec3(viewToLight * glm::vec4(center, 1.0f));
+
+		glm::vec3 offset = glm::abs(lightCenter - cascade.center);
+		bool isCovered = cascade.isValid &&
+		                 glm::dot(lightDirection, cascade.lightDirection) >= SUN_TOLERANCE &&
+		                 std::max(offset.x, std::max(offset.y, offset.z)) + radius <= cascade.radius;
+		bool hasMovedCasters = cascade.casterVersion != m_casterVersion;
+		bool isDue = cascade.framesSinceUpdate >= UPDATE_INTERVALS[i] && (i == 0 || !isDistantScheduled);
+
+		cascade.isScheduled = !isCovered || (hasMovedCasters && isDue);
+		if (!cascade.isScheduled)
+		{
+			continue;
+		}
+		isDistantScheduled |= i > 0;
+
+		// Snapped to whole texels, the map's contents only move in steps of a texel
+		float fittedRadius = radius * (1.0f + FIT_SLACK[i]);
+		float texelSize = 2.0f * fittedRadius / m_mapSize;
+		lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+		lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+		// Casters up to the shadow distance towards the sun still cast into the slice
+		glm::mat4 projection = glm::ortho(lightCenter.x - fittedRadius, lightCenter.x + fittedRadius,
+		                                  lightCenter.y - fittedRadius, lightCenter.y + fittedRadius,
+		                                  -lightCenter.z - fittedRadius - m_shadowDistance, -lightCenter.z + fittedRadius);
+
+		cascade.center = lightCenter;
+		cascade.radius = fittedRadius;
+		cascade.lightDirection = lightDirection;
+		cascade.viewProjection = projection * lightView;
+		cascade.isValid = true;
+		cascade.framesSinceUpdate = 0;
+		cascade.casterVersion = m_casterVersion;
+	}
+}
+
+float CascadedShadows::getSplitDepth(uint32_t split) const
+{
+	float ratio = (float) split / SHADOW_CASCADE_COUNT;
+	float logarithmic = SHADOW_NEAR * std::pow(m_shadowDistance / SHADOW_NEAR, ratio);
+	float uniform = SHADOW_NEAR + (m_shadowDistance - SHADOW_NEAR) * ratio;
+
+	return uniform + (logarithmic - uniform) * SPLIT_LAMBDA;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../FrameState.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// SHADOW_CASCADE_COUNT in clusters.glsl
+const uint32_t SHADOW_CASCADE_COUNT = 3;
+
+/*
+ * Cascaded shadow maps of the sun, fitted to slices of the camera's view and
+ * kept from one frame to the next.
+ *
+ * A cascade covers the bounding sphere of its slice, which keeps its size while
+ * the camera turns, and moves in whole texels of its map in light space. Cached
+ * maps then neither shimmer nor have to be rendered again while the slice stays
+ * inside them, distant cascades are fitted with some slack for that.
+ *
+ * update() schedules a map for rendering when its slice left it or the sun
+ * turned. Moved casters are picked up every few frames instead, the farther the
+ * cascade the less often, and by at most one distant cascade per frame.
+ */
+class CascadedShadows
+{
+public:
+	CascadedShadows(uint32_t mapSize = 1024, float shadowDistance = 10.0f);
+
+	// Every map is rendered again, e.g. after they were recreated
+	void invalidate();
+
+	// Once per frame before recording, with the frame's camera, sun and casters
+	void update(const FrameState& frameState);
+
+	uint32_t getMapSize() const
+	{
+		return m_mapSize;
+	}
+
+	bool isScheduled(uint32_t cascade) const
+	{
+		return m_cascades[cascade].isScheduled;
+	}
+
+	// World to clip space of what the map holds, the one it is rendered with when scheduled
+	const glm::mat4& getViewProjection(uint32_t cascade) const
+	{
+		return m_cascades[cascade].viewProjection;
+	}
+
+private:
+	struct Cascade
+	{
+		// In light space, snapped to texels
+		glm::vec3 center;
+		float radius;
+		glm::vec3 lightDirection;
+		glm::mat4 viewProjection;
+
+		bool isValid;
+		bool isScheduled;
+		uint32_t framesSinceUpdate;
+		uint32_t casterVersion;
+	};
+
+	// View space depth cascade split starts at, split SHADOW_CASCADE_COUNT is the end of the last
+	float getSplitDepth(uint32_t split) const;
+
+private:
+	uint32_t m_mapSize;
+	float m_shadowDistance;
+
+	std::array<Cascade, SHADOW_CASCADE_COUNT> m_cascades;
+
+	// Changes whenever a caster moved
+	uint32_t m_casterVersion;
+	std::vector<glm::mat4> m_casterModels;
+};
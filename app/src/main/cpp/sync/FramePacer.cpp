@@ -0,0 +1,94 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+
+// Slack kept between the predicted frame start and the actual availability
+const float SAFETY_MARGIN_SECONDS = 0.001f;
+
+// Anything closer than this is started right away, poll timeouts are in ms
+const float MIN_SLEEP_SECONDS = 0.0005f;
+
+// Present timing feedback arrives a few frames late, react slower to it
+const float BLOCKED_GAIN = 0.5f;
+const float PRESENT_MARGIN_GAIN = 0.1f;
+
+const float INTERVAL_SMOOTHING = 0.1f;
+
+const float DEFAULT_REFRESH_SECONDS = 1.0f / 60.0f;
+
+FramePacer::FramePacer() :
+		m_isEnabled(false),
+		m_hasPresentTiming(false),
+		m_refreshSeconds(0.0f),
+		m_measuredIntervalSeconds(0.0f),
+		m_delaySeconds(0.0f),
+		m_lastSubmit(std::chrono::steady_clock::now())
+{
+}
+
+void FramePacer::setEnabled(bool isEnabled)
+{
+	m_isEnabled = isEnabled;
+	m_delaySeconds = 0.0f;
+}
+
+void FramePacer::setRefreshDuration(float refreshSeconds)
+{
+	m_refreshSeconds = refreshSeconds;
+}
+
+float FramePacer::getTimeUntilFrame() const
+{
+	if (!m_isEnabled)
+	{
+		return 0.0f;
+	}
+
+	std::chrono::duration<float> sinceSubmit = std::chrono::steady_clock::now() - m_lastSubmit;
+	float timeUntilFrame = m_delaySeconds - sinceSubmit.count();
+
+	return timeUntilFrame < MIN_SLEEP_SECONDS ? 0.0f : timeUntilFrame;
+}
+
+float FramePacer::getFrameInterval() const
+{
+	return m_refreshSeconds > 0.0f ? m_refreshSeconds : DEFAULT_REFRESH_SECONDS;
+}
+
+void FramePacer::onFrameBlocked(float blockedSeconds)
+{
+	// The present margin is the better signal when the swapchain provides it
+	if (!m_hasPresentTiming)
+	{
+		adjustDelay(blockedSeconds - SAFETY_MARGIN_SECONDS, BLOCKED_GAIN);
+	}
+}
+
+void FramePacer::onPresentMargin(float presentMarginSeconds)
+{
+	m_hasPresentTiming = true;
+	adjustDelay(presentMarginSeconds - SAFETY_MARGIN_SECONDS, PRESENT_MARGIN_GAIN);
+}
+
+void FramePacer::onFrameSubmitted()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	std::chrono::duration<float> interval = now - m_lastSubmit;
+	m_lastSubmit = now;
+
+	m_measuredIntervalSeconds += (interval.count() - m_measuredIntervalSeconds) * INTERVAL_SMOOTHING;
+}
+
+void FramePacer::adjustDelay(float slackSeconds, float gain)
+{
+	if (!m_isEnabled)
+	{
+		return;
+	}
+
+	// Never sleep a whole frame, that would just skip a refresh
+	float frameSeconds = m_refreshSeconds > 0.0f ? m_refreshSeconds : m_measuredIntervalSeconds;
+	float maxDelay = frameSeconds * 0.9f;
+
+	m_delaySeconds = std::max(0.0f, std::min(m_delaySeconds + slackSeconds * gain, maxDelay));
+}
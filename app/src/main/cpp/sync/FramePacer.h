@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+
+/*
+ * Low latency pacing: instead of starting a frame right away and blocking on the
+ * GPU / swapchain inside draw(), the main loop sleeps (while still handling
+ * events) until just before the point the previous frames are predicted to be
+ * out of the way. Input and simulation then happen as late as possible.
+ *
+ * The sleep after each submission is learned from feedback: the present margin
+ * of VK_GOOGLE_display_timing when the swapchain reports it, otherwise the time
+ * draw() was still blocked. Both are driven towards a small safety margin.
+ */
+class FramePacer
+{
+public:
+	FramePacer();
+
+	void setEnabled(bool isEnabled);
+	bool isEnabled() const
+	{
+		return m_isEnabled;
+	}
+
+	// Display refresh from VK_GOOGLE_display_timing, 0 when unknown
+	void setRefreshDuration(float refreshSeconds);
+
+	// Seconds until the next frame should start, 0 when it is due (or pacing is off)
+	float getTimeUntilFrame() const;
+
+	// Display refresh, or a 60 Hz guess while it is unknown
+	float getFrameInterval() const;
+
+	// Time draw() blocked on the GPU timeline and on image acquisition
+	void onFrameBlocked(float blockedSeconds);
+	void onPresentMargin(float presentMarginSeconds);
+
+	void onFrameSubmitted();
+
+private:
+	void adjustDelay(float slackSeconds, float gain);
+
+private:
+	bool m_isEnabled;
+	bool m_hasPresentTiming;
+
+	float m_refreshSeconds;
+	float m_measuredIntervalSeconds;
+
+	// Sleep between a submission and the start of the next frame
+	float m_delaySeconds;
+
+	std::chrono::steady_clock::time_point m_lastSubmit;
+};
@@ -0,0 +1,94 @@
+#include "FramesInFlightController.h"
+
+#include <algorithm>
+
+// Frames averaged before each decision
+const uint32_t WINDOW_FRAMES = 60;
+
+// Windows after which a measurement no longer blocks a change
+const uint32_t MEASUREMENT_LIFETIME = 20;
+
+// Share of the frame spent waiting on the GPU
+const float LOWER_WAIT_RATIO = 0.02f;
+const float RAISE_WAIT_RATIO = 0.15f;
+
+FramesInFlightController::FramesInFlightController(uint32_t framesInFlight, bool isAdaptive) :
+		m_framesInFlight(framesInFlight),
+		m_isAdaptive(isAdaptive),
+		m_minFramesInFlight(1),
+		m_maxFramesInFlight(framesInFlight),
+		m_waitSum(0.0f),
+		m_frameSum(0.0f),
+		m_nFrames(0),
+		m_window(0),
+		m_measurements(framesInFlight + 1, {0.0f, 0})
+{
+}
+
+void FramesInFlightController::setFramesInFlight(uint32_t framesInFlight, bool isAdaptive)
+{
+	m_framesInFlight = std::max(m_minFramesInFlight, std::min(framesInFlight, m_maxFramesInFlight));
+	m_isAdaptive = isAdaptive;
+
+	m_waitSum = 0.0f;
+	m_frameSum = 0.0f;
+	m_nFrames = 0;
+}
+
+void FramesInFlightController::setLimits(uint32_t minFramesInFlight, uint32_t maxFramesInFlight)
+{
+	m_minFramesInFlight = std::max(1u, minFramesInFlight);
+	m_maxFramesInFlight = std::max(m_minFramesInFlight, maxFramesInFlight);
+
+	m_measurements.assign(m_maxFramesInFlight + 1, {0.0f, 0});
+	setFramesInFlight(m_framesInFlight, m_isAdaptive);
+}
+
+void FramesInFlightController::update(float waitSeconds, float frameSeconds)
+{
+	if (!m_isAdaptive)
+	{
+		return;
+	}
+
+	m_waitSum += waitSeconds;
+	m_frameSum += frameSeconds;
+	if (++m_nFrames < WINDOW_FRAMES || m_frameSum <= 0.0f)
+	{
+		return;
+	}
+
+	float waitRatio = m_waitSum / m_frameSum;
+
+	m_waitSum = 0.0f;
+	m_frameSum = 0.0f;
+	m_nFrames = 0;
+	++m_window;
+
+	m_measurements[m_framesInFlight] = {waitRatio, m_window};
+
+	if (waitRatio < LOWER_WAIT_RATIO && m_framesInFlight > m_minFramesInFlight)
+	{
+		// Don't go back to a count that recently made the CPU stall
+		uint32_t lower = m_framesInFlight - 1;
+		if (!isRecentlyMeasured(lower) || m_measurements[lower].waitRatio < RAISE_WAIT_RATIO)
+		{
+			m_framesInFlight = lower;
+		}
+	}
+	else if (waitRatio > RAISE_WAIT_RATIO && m_framesInFlight < m_maxFramesInFlight)
+	{
+		// GPU bound frames wait no matter the count, only raise if it helped before
+		uint32_t higher = m_framesInFlight + 1;
+		if (!isRecentlyMeasured(higher) || m_measurements[higher].waitRatio < waitRatio * 0.5f)
+		{
+			m_framesInFlight = higher;
+		}
+	}
+}
+
+bool FramesInFlightController::isRecentlyMeasured(uint32_t framesInFlight) const
+{
+	const Measurement& measurement = m_measurements[framesInFlight];
+	return measurement.window != 0 && m_window - measurement.window < MEASUREMENT_LIFETIME;
+}
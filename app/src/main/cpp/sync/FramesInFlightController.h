@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Number of frames the CPU may run ahead of the GPU.
+ *
+ * In adaptive mode the count follows the time draw() spends blocked on the GPU:
+ * when the CPU (almost) never waits the GPU keeps up and a frame less in flight
+ * only removes latency; when it waits a lot a frame more lets CPU and GPU work
+ * overlap, unless that count was already tried recently and did not help.
+ */
+class FramesInFlightController
+{
+public:
+	FramesInFlightController(uint32_t framesInFlight = 2, bool isAdaptive = true);
+
+	void setFramesInFlight(uint32_t framesInFlight, bool isAdaptive);
+	void setLimits(uint32_t minFramesInFlight, uint32_t maxFramesInFlight);
+
+	uint32_t getFramesInFlight() const
+	{
+		return m_framesInFlight;
+	}
+
+	// Once per frame: time blocked waiting for the GPU and the whole frame interval.
+	void update(float waitSeconds, float frameSeconds);
+
+private:
+	struct Measurement
+	{
+		float waitRatio;
+		uint32_t window;
+	};
+
+	bool isRecentlyMeasured(uint32_t framesInFlight) const;
+
+private:
+	uint32_t m_framesInFlight;
+	bool m_isAdaptive;
+
+	uint32_t m_minFramesInFlight;
+	uint32_t m_maxFramesInFlight;
+
+	float m_waitSum;
+	float m_frameSum;
+	uint32_t m_nFrames;
+	uint32_t m_window;
+
+	// last wait ratio seen with each frame count
+	std::vector<Measurement> m_measurements;
+};
@@ -0,0 +1,109 @@
+#include "GpuFrameTimer.h"
+
+GpuFrameTimer::GpuFrameTimer() :
+		m_logicalDevice(VK_NULL_HANDLE),
+		m_queryPool(VK_NULL_HANDLE),
+		m_tickPeriod(0.0f),
+		m_timestampMask(0),
+		m_lastEnd(0)
+{
+}
+
+void GpuFrameTimer::create(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t frameSlots)
+{
+	m_logicalDevice = logicalDevice;
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	uint32_t validBits = queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+	if (validBits == 0)
+	{
+		return;
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	m_tickPeriod = properties.limits.timestampPeriod * 1e-9f;
+	m_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = 2 * frameSlots;
+
+	CALL_VK(vkCreateQueryPool(m_logicalDevice, &queryPoolCreateInfo, nullptr, &m_queryPool));
+
+	m_isWritten.assign(frameSlots, false);
+	m_lastEnd = 0;
+}
+
+void GpuFrameTimer::destroy()
+{
+	if (m_queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(m_logicalDevice, m_queryPool, nullptr);
+		m_queryPool = VK_NULL_HANDLE;
+	}
+}
+
+void GpuFrameTimer::begin(VkCommandBuffer commandBuffer, uint32_t frameSlot)
+{
+	if (m_queryPool == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkCmdResetQueryPool(commandBuffer, m_queryPool, 2 * frameSlot, 2);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, 2 * frameSlot);
+}
+
+void GpuFrameTimer::end(VkCommandBuffer commandBuffer, uint32_t frameSlot)
+{
+	if (m_queryPool == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, 2 * frameSlot + 1);
+	m_isWritten[frameSlot] = true;
+}
+
+bool GpuFrameTimer::read(uint32_t frameSlot, float* pSeconds)
+{
+	if (m_queryPool == VK_NULL_HANDLE || !m_isWritten[frameSlot])
+	{
+		return false;
+	}
+	m_isWritten[frameSlot] = false;
+
+	uint64_t timestamps[2];
+	VkResult result = vkGetQueryPoolResults(m_logicalDevice, m_queryPool, 2 * frameSlot, 2, sizeof(timestamps), timestamps,
+	                                        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	uint64_t start = timestamps[0] & m_timestampMask;
+	uint64_t end = timestamps[1] & m_timestampMask;
+
+	// The top of pipe timestamp is written as soon as the command buffer starts,
+	// possibly while the previous frame is still running. Counters that wrapped
+	// in between are rare enough to drop the frame.
+	if (start < m_lastEnd && m_lastEnd <= end)
+	{
+		start = m_lastEnd;
+	}
+	m_lastEnd = end;
+
+	if (end < start)
+	{
+		return false;
+	}
+
+	*pSeconds = (end - start) * m_tickPeriod;
+	return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../vulkan_wrapper.h"
+
+#include <vector>
+
+/*
+ * GPU time of whole frames from timestamp queries, two per frame slot.
+ *
+ * A slot's results are read back once its frame is known to be complete, right
+ * before the slot is recorded again, so reading never stalls. Time the frame
+ * spent queued behind the previous one is not counted.
+ */
+class GpuFrameTimer
+{
+public:
+	GpuFrameTimer();
+
+	// Does nothing when the queue family has no timestamps, isSupported() is then false
+	void create(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t frameSlots);
+	void destroy();
+
+	bool isSupported() const
+	{
+		return m_queryPool != VK_NULL_HANDLE;
+	}
+
+	// First and last commands of the slot's command buffer, outside render passes
+	void begin(VkCommandBuffer commandBuffer, uint32_t frameSlot);
+	void end(VkCommandBuffer commandBuffer, uint32_t frameSlot);
+
+	// The slot's last frame has to be complete. False when it wasn't measured.
+	bool read(uint32_t frameSlot, float* pSeconds);
+
+private:
+	VkDevice m_logicalDevice;
+	VkQueryPool m_queryPool;
+
+	// Seconds per tick and the bits of a timestamp that are valid
+	float m_tickPeriod;
+	uint64_t m_timestampMask;
+
+	std::vector<bool> m_isWritten;
+	// End of the last frame read, frames are read in submission order
+	uint64_t m_lastEnd;
+};
@@ -0,0 +1,208 @@
+#include "GpuTimeline.h"
+
+GpuTimeline::GpuTimeline() :
+		m_logicalDevice(VK_NULL_HANDLE),
+		m_useTimelineSemaphore(false),
+		m_lastSubmittedValue(0),
+		m_completedValue(0),
+		m_semaphore(VK_NULL_HANDLE)
+{
+}
+
+void GpuTimeline::create(VkDevice logicalDevice, bool useTimelineSemaphore)
+{
+	m_logicalDevice = logicalDevice;
+	m_lastSubmittedValue = 0;
+	m_completedValue = 0;
+
+#ifdef VK_KHR_timeline_semaphore
+	m_useTimelineSemaphore = useTimelineSemaphore;
+	if (m_useTimelineSemaphore)
+	{
+		m_pfnGetSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR) vkGetDeviceProcAddr(m_logicalDevice, "vkGetSemaphoreCounterValueKHR");
+		m_pfnWaitSemaphores = (PFN_vkWaitSemaphoresKHR) vkGetDeviceProcAddr(m_logicalDevice, "vkWaitSemaphoresKHR");
+
+		if (m_pfnGetSemaphoreCounterValue == nullptr || m_pfnWaitSemaphores == nullptr)
+		{
+			m_useTimelineSemaphore = false;
+		}
+	}
+
+	if (m_useTimelineSemaphore)
+	{
+		VkSemaphoreTypeCreateInfoKHR semaphoreTypeCreateInfo = {};
+		semaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+		semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+		semaphoreTypeCreateInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+
+		CALL_VK(vkCreateSemaphore(m_logicalDevice, &semaphoreCreateInfo, nullptr, &m_semaphore));
+	}
+#else
+	m_useTimelineSemaphore = false;
+#endif // VK_KHR_timeline_semaphore
+
+	__android_log_print(ANDROID_LOG_INFO, "Vulkan", "GPU timeline backed by %s", m_useTimelineSemaphore ? "timeline semaphore" : "fences");
+}
+
+void GpuTimeline::destroy()
+{
+	if (m_semaphore != VK_NULL_HANDLE)
+	{
+		vkDestroySemaphore(m_logicalDevice, m_semaphore, nullptr);
+		m_semaphore = VK_NULL_HANDLE;
+	}
+
+	for (PendingFence& pendingFence : m_pendingFences)
+	{
+		vkDestroyFence(m_logicalDevice, pendingFence.fence, nullptr);
+	}
+	m_pendingFences.clear();
+
+	for (VkFence fence : m_freeFences)
+	{
+		vkDestroyFence(m_logicalDevice, fence, nullptr);
+	}
+	m_freeFences.clear();
+}
+
+uint64_t GpuTimeline::submit(VkQueue queue, const VkSubmitInfo& submitInfo)
+{
+	uint64_t value = m_lastSubmittedValue + 1;
+
+#ifdef VK_KHR_timeline_semaphore
+	if (m_useTimelineSemaphore)
+	{
+		std::vector<VkSemaphore> signalSemaphores(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+		signalSemaphores.push_back(m_semaphore);
+
+		// Values of the binary semaphores are ignored
+		std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+		signalValues.back() = value;
+
+		VkTimelineSemaphoreSubmitInfoKHR timelineSubmitInfo = {};
+		timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		timelineSubmitInfo.pNext = submitInfo.pNext;
+		timelineSubmitInfo.signalSemaphoreValueCount = (uint32_t) signalValues.size();
+		timelineSubmitInfo.pSignalSemaphoreValues = signalValues.data();
+
+		VkSubmitInfo timelineSubmit = submitInfo;
+		timelineSubmit.pNext = &timelineSubmitInfo;
+		timelineSubmit.signalSemaphoreCount = (uint32_t) signalSemaphores.size();
+		timelineSubmit.pSignalSemaphores = signalSemaphores.data();
+
+		CALL_VK(vkQueueSubmit(queue, 1, &timelineSubmit, VK_NULL_HANDLE));
+
+		m_lastSubmittedValue = value;
+		return value;
+	}
+#endif // VK_KHR_timeline_semaphore
+
+	VkFence fence;
+	if (m_freeFences.empty())
+	{
+		VkFenceCreateInfo fenceCreateInfo = {};
+		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		CALL_VK(vkCreateFence(m_logicalDevice, &fenceCreateInfo, nullptr, &fence));
+	}
+	else
+	{
+		fence = m_freeFences.back();
+		m_freeFences.pop_back();
+	}
+
+	CALL_VK(vkQueueSubmit(queue, 1, &submitInfo, fence));
+	m_pendingFences.push_back({value, fence});
+
+	m_lastSubmittedValue = value;
+	return value;
+}
+
+uint64_t GpuTimeline::getCompletedValue()
+{
+#ifdef VK_KHR_timeline_semaphore
+	if (m_useTimelineSemaphore)
+	{
+		m_pfnGetSemaphoreCounterValue(m_logicalDevice, m_semaphore, &m_completedValue);
+		return m_completedValue;
+	}
+#endif // VK_KHR_timeline_semaphore
+
+	pollFences();
+	return m_completedValue;
+}
+
+bool GpuTimeline::isComplete(uint64_t value)
+{
+	// Cached value first, the query costs a driver call
+	return value <= m_completedValue || value <= getCompletedValue();
+}
+
+void GpuTimeline::wait(uint64_t value)
+{
+	if (value > m_lastSubmittedValue)
+	{
+		__android_log_assert("Waiting on a value that was never submitted.", nullptr, nullptr);
+	}
+
+	if (isComplete(value))
+	{
+		return;
+	}
+
+#ifdef VK_KHR_timeline_semaphore
+	if (m_useTimelineSemaphore)
+	{
+		VkSemaphoreWaitInfoKHR waitInfo = {};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &m_semaphore;
+		waitInfo.pValues = &value;
+
+		CALL_VK(m_pfnWaitSemaphores(m_logicalDevice, &waitInfo, UINT64_MAX));
+		m_completedValue = value;
+		return;
+	}
+#endif // VK_KHR_timeline_semaphore
+
+	for (PendingFence& pendingFence : m_pendingFences)
+	{
+		if (pendingFence.value >= value)
+		{
+			vkWaitForFences(m_logicalDevice, 1, &pendingFence.fence, VK_TRUE, UINT64_MAX);
+			break;
+		}
+	}
+
+	// All earlier work on the queue is complete once this fence has signaled
+	while (!m_pendingFences.empty() && m_pendingFences.front().value <= value)
+	{
+		vkResetFences(m_logicalDevice, 1, &m_pendingFences.front().fence);
+		m_freeFences.push_back(m_pendingFences.front().fence);
+		m_pendingFences.pop_front();
+	}
+	m_completedValue = value;
+
+	pollFences();
+}
+
+void GpuTimeline::pollFences()
+{
+	while (!m_pendingFences.empty())
+	{
+		PendingFence& pendingFence = m_pendingFences.front();
+		if (vkGetFenceStatus(m_logicalDevice, pendingFence.fence) != VK_SUCCESS)
+		{
+			break;
+		}
+
+		m_completedValue = pendingFence.value;
+
+		vkResetFences(m_logicalDevice, 1, &pendingFence.fence);
+		m_freeFences.push_back(pendingFence.fence);
+		m_pendingFences.pop_front();
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../vulkan_wrapper.h"
+
+#include <vector>
+#include <deque>
+
+/*
+ * Single monotonically increasing counter of GPU progress. Every queue submission
+ * goes through submit() and gets the next value; anything that has to outlive the
+ * GPU work (frame slots, staging memory, deferred deletes) keys off that value.
+ *
+ * Backed by a VK_KHR_timeline_semaphore when the device has it, otherwise by one
+ * fence per submission.
+ */
+class GpuTimeline
+{
+public:
+	GpuTimeline();
+
+	void create(VkDevice logicalDevice, bool useTimelineSemaphore);
+	void destroy();
+
+	// Signals the next value once the submitted work is complete and returns it.
+	uint64_t submit(VkQueue queue, const VkSubmitInfo& submitInfo);
+
+	uint64_t getCompletedValue();
+	uint64_t getLastSubmittedValue() const
+	{
+		return m_lastSubmittedValue;
+	}
+
+	bool isComplete(uint64_t value);
+	void wait(uint64_t value);
+
+	bool isTimelineSemaphore() const
+	{
+		return m_useTimelineSemaphore;
+	}
+
+private:
+	struct PendingFence
+	{
+		uint64_t value;
+		VkFence fence;
+	};
+
+	void pollFences();
+
+private:
+	VkDevice m_logicalDevice;
+	bool m_useTimelineSemaphore;
+
+	uint64_t m_lastSubmittedValue;
+	uint64_t m_completedValue;
+
+	// TIMELINE
+	VkSemaphore m_semaphore;
+#ifdef VK_KHR_timeline_semaphore
+	PFN_vkGetSemaphoreCounterValueKHR m_pfnGetSemaphoreCounterValue;
+	PFN_vkWaitSemaphoresKHR m_pfnWaitSemaphores;
+#endif // VK_KHR_timeline_semaphore
+
+	// FENCES
+	std::deque<PendingFence> m_pendingFences;
+	std::vector<VkFence> m_freeFences;
+};
@@ -0,0 +1,82 @@
+#include "RenderScaleController.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Scales are multiples of this
+const float SCALE_STEP = 0.05f;
+
+// Measurements at a new scale only arrive once the frames in flight and the
+// frame slots recorded before the change are through
+const uint32_t SETTLE_FRAMES = 8;
+
+// Weight of a new measurement in the average
+const float AVERAGE_WEIGHT = 0.1f;
+
+// Share of the budget below which the scale goes up again. With GPU time
+// roughly following the pixel count a step up costs about 10%, this leaves
+// room for it.
+const float RAISE_RATIO = 0.8f;
+
+RenderScaleController::RenderScaleController(float budgetSeconds, float minScale, bool isAdaptive) :
+		m_budget(budgetSeconds),
+		m_minScale(std::max(SCALE_STEP, std::min(minScale, 1.0f))),
+		m_isAdaptive(isAdaptive),
+		m_scale(1.0f),
+		m_averageTime(0.0f),
+		m_nFrames(0)
+{
+}
+
+void RenderScaleController::setBudget(float budgetSeconds)
+{
+	m_budget = budgetSeconds;
+	m_nFrames = 0;
+}
+
+void RenderScaleController::setAdaptive(bool isAdaptive)
+{
+	m_isAdaptive = isAdaptive;
+	if (!m_isAdaptive)
+	{
+		setScale(1.0f);
+	}
+}
+
+void RenderScaleController::update(float gpuSeconds)
+{
+	if (!m_isAdaptive)
+	{
+		return;
+	}
+
+	m_averageTime = m_nFrames == 0 ? gpuSeconds : m_averageTime + (gpuSeconds - m_averageTime) * AVERAGE_WEIGHT;
+	if (++m_nFrames < SETTLE_FRAMES)
+	{
+		return;
+	}
+
+	if (m_averageTime > m_budget)
+	{
+		// Pixels scale with the square, fixed costs make this drop a bit short
+		// and the next decision takes the rest
+		float scale = m_scale * std::sqrt(m_budget / m_averageTime);
+		setScale(std::min(std::floor(scale / SCALE_STEP) * SCALE_STEP, m_scale - SCALE_STEP));
+	}
+	else if (m_averageTime < m_budget * RAISE_RATIO)
+	{
+		setScale(m_scale + SCALE_STEP);
+	}
+}
+
+void RenderScaleController::setScale(float scale)
+{
+	scale = std::max(m_minScale, std::min(scale, 1.0f));
+	if (std::abs(scale - m_scale) < SCALE_STEP * 0.5f)
+	{
+		return;
+	}
+
+	m_scale = scale;
+	m_nFrames = 0;
+}
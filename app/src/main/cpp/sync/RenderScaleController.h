@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Share of the swapchain resolution the scene is rendered at, per axis.
+ *
+ * In adaptive mode the scale follows the GPU time of the frames against a
+ * budget: over it the scale drops at once by as much as the pixel count has
+ * to shrink, well under it the scale climbs back a step at a time. Scales are
+ * multiples of a step and every change waits for measurements of frames
+ * rendered at the new scale, so the render area settles instead of changing
+ * every frame.
+ */
+class RenderScaleController
+{
+public:
+	RenderScaleController(float budgetSeconds = 0.014f, float minScale = 0.5f, bool isAdaptive = true);
+
+	void setBudget(float budgetSeconds);
+	void setAdaptive(bool isAdaptive);
+
+	float getScale() const
+	{
+		return m_scale;
+	}
+
+	// For every measured frame, in order
+	void update(float gpuSeconds);
+
+private:
+	void setScale(float scale);
+
+private:
+	float m_budget;
+	float m_minScale;
+	bool m_isAdaptive;
+
+	float m_scale;
+
+	float m_averageTime;
+	uint32_t m_nFrames;
+};
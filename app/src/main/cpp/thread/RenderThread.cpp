@@ -0,0 +1,114 @@
+#include "RenderThread.h"
+
+#include "../VulkanMain.h"
+
+static int64_t nowNanos()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+RenderThread::RenderThread(VulkanMain* pVulkanMain) :
+		m_pVulkanMain(pVulkanMain),
+		m_isRunning(false),
+		m_nPublished(0),
+		m_nConsumed(0),
+		m_nextFrameNanos(0)
+{
+}
+
+RenderThread::~RenderThread()
+{
+	stop();
+}
+
+void RenderThread::start()
+{
+	if (isRunning())
+	{
+		return;
+	}
+
+	m_nextFrameNanos.store(nowNanos());
+	m_isRunning.store(true);
+	m_thread = std::thread(&RenderThread::run, this);
+}
+
+void RenderThread::stop()
+{
+	if (!isRunning())
+	{
+		return;
+	}
+
+	m_isRunning.store(false);
+	{
+		std::lock_guard<std::mutex> lock(m_stateMutex);
+		m_stateCondition.notify_one();
+	}
+	m_thread.join();
+}
+
+bool RenderThread::needsFrameState() const
+{
+	return m_nConsumed.load(std::memory_order_acquire) == m_nPublished.load(std::memory_order_relaxed) &&
+	       getTimeUntilNextFrame() <= 0.0f;
+}
+
+float RenderThread::getTimeUntilNextFrame() const
+{
+	return (m_nextFrameNanos.load(std::memory_order_relaxed) - nowNanos()) * 1e-9f;
+}
+
+void RenderThread::publishFrameState()
+{
+	m_frameStates.publish();
+	m_nPublished.fetch_add(1, std::memory_order_release);
+
+	// Taken so the render thread can't miss the notification between its check and its wait
+	std::lock_guard<std::mutex> lock(m_stateMutex);
+	m_stateCondition.notify_one();
+}
+
+void RenderThread::waitForFrameState(bool canTimeOut)
+{
+	auto isWakeUp = [this]()
+	{
+		return m_nPublished.load(std::memory_order_relaxed) != m_nConsumed.load(std::memory_order_relaxed) || !isRunning();
+	};
+
+	std::unique_lock<std::mutex> lock(m_stateMutex);
+	if (!canTimeOut)
+	{
+		m_stateCondition.wait(lock, isWakeUp);
+		return;
+	}
+
+	int64_t deadlineNanos = m_nextFrameNanos.load(std::memory_order_relaxed) + (int64_t) (m_pVulkanMain->getFrameInterval() * 1e9f);
+	m_stateCondition.wait_for(lock, std::chrono::nanoseconds(deadlineNanos - nowNanos()), isWakeUp);
+}
+
+void RenderThread::run()
+{
+	bool hasFrameState = false;
+	while (isRunning())
+	{
+		// A late simulation doesn't stop presentation, the previous state is drawn again
+		waitForFrameState(hasFrameState);
+
+		if (m_frameStates.acquire())
+		{
+			m_nConsumed.fetch_add(1, std::memory_order_release);
+			hasFrameState = true;
+		}
+		else if (!hasFrameState)
+		{
+			continue;
+		}
+
+		m_pVulkanMain->draw(m_frameStates.getFront());
+
+		// Frame pacing: the simulation produces the next state right before this point
+		float timeUntilNextFrame = m_pVulkanMain->getTimeUntilNextFrame();
+		m_nextFrameNanos.store(nowNanos() + (int64_t) (timeUntilNextFrame * 1e9f), std::memory_order_relaxed);
+	}
+}
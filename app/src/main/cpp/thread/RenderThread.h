@@ -0,0 +1,68 @@
+#pragma once
+
+#include "TripleBuffer.h"
+#include "../FrameState.h"
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+class VulkanMain;
+
+/*
+ * Owns the Vulkan queue while running: draws every FrameState the simulation
+ * publishes. The android_main thread keeps handling events and simulating, so a
+ * slow event never delays a frame and a GPU stall never delays input handling.
+ * When no new state arrives within a frame interval of when it was due, the
+ * last one is drawn again.
+ */
+class RenderThread
+{
+public:
+	RenderThread(VulkanMain* pVulkanMain);
+	~RenderThread();
+
+	void start();
+	void stop();
+
+	bool isRunning() const
+	{
+		return m_isRunning.load(std::memory_order_relaxed);
+	}
+
+	// SIMULATION SIDE
+	// True once the last published state was picked up and the next frame is due.
+	bool needsFrameState() const;
+	float getTimeUntilNextFrame() const;
+
+	FrameState& getFrameState()
+	{
+		return m_frameStates.getBack();
+	}
+
+	void publishFrameState();
+
+private:
+	void run();
+	// Gives up a frame interval after the state was due when canTimeOut is set
+	void waitForFrameState(bool canTimeOut);
+
+private:
+	VulkanMain* m_pVulkanMain;
+
+	std::thread m_thread;
+	std::atomic<bool> m_isRunning;
+
+	TripleBuffer<FrameState> m_frameStates;
+	std::atomic<uint64_t> m_nPublished;
+	std::atomic<uint64_t> m_nConsumed;
+
+	// Signalled on publish and stop
+	std::mutex m_stateMutex;
+	std::condition_variable m_stateCondition;
+
+	// steady_clock time the next frame starts at, set by the render thread
+	std::atomic<int64_t> m_nextFrameNanos;
+};
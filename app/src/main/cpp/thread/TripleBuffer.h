@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Lock free single producer / single consumer handoff of the latest value.
+ * The producer writes into its back slot and publishes it by swapping it with
+ * the middle slot; the consumer swaps its front slot with the middle one when
+ * that holds something newer. Neither side ever waits on the other.
+ */
+template<typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() :
+			m_back(0),
+			m_front(1),
+			m_middle(2)
+	{
+	}
+
+	// PRODUCER
+	T& getBack()
+	{
+		return m_slots[m_back];
+	}
+
+	void publish()
+	{
+		m_back = m_middle.exchange(m_back | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// CONSUMER
+	// Returns true when a newer value was swapped into the front slot.
+	bool acquire()
+	{
+		if ((m_middle.load(std::memory_order_relaxed) & FRESH_BIT) == 0)
+		{
+			return false;
+		}
+
+		m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+
+	const T& getFront() const
+	{
+		return m_slots[m_front];
+	}
+
+private:
+	static const uint32_t FRESH_BIT = 4;
+	static const uint32_t INDEX_MASK = 3;
+
+	T m_slots[3];
+
+	uint32_t m_back;
+	uint32_t m_front;
+	std::atomic<uint32_t> m_middle;
+};
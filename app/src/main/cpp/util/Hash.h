@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// FNV-1a, enough to key caches of small Vulkan state structs.
+const uint64_t HASH_SEED = 14695981039346656037ull;
+
+inline uint64_t hashBytes(const void* pData, size_t size, uint64_t hash = HASH_SEED)
+{
+	const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= pBytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+// Only for values without padding: scalars, enums and handles
+template<typename T>
+inline void hashCombine(uint64_t& hash, const T& value)
+{
+	hash = hashBytes(&value, sizeof(value), hash);
+}
@@ -8,4 +8,14 @@
 #define VK_USE_PLATFORM_ANDROID_KHR
 #include <vulkan/vulkan.h>
 
+#include <android/log.h>
+#include <cassert>
+
+#define CALL_VK(result)                                               \
+    if (VK_SUCCESS != (result)) {                                     \
+        __android_log_print(ANDROID_LOG_ERROR, "Test ",             \
+        "Vulkan error. File[%s], line[%d]", __FILE__, __LINE__);    \
+        assert(false);                                              \
+        }
+
 #endif //VULKAN_ANDROID_VULKAN_WRAPPER_H
@@ -0,0 +1,98 @@
+// Lights binned into view space froxels: CLUSTER_X x CLUSTER_Y screen tiles,
+// cut into CLUSTER_Z slices whose depth grows exponentially. Written by
+// cluster_lights.comp, looked up by every shader that lights pixels.
+// Included after the #version line, bindings are in the set given below.
+
+// Cluster grid in VulkanMain.h
+const uint CLUSTER_X = 16u;
+const uint CLUSTER_Y = 8u;
+const uint CLUSTER_Z = 24u;
+const uint CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+const uint MAX_LIGHTS_PER_CLUSTER = 64u;
+
+// View space depth range of the slices. Closer pixels use the first slice,
+// farther ones the last, which then misses lights beyond CLUSTER_FAR.
+const float CLUSTER_NEAR = 0.1;
+const float CLUSTER_FAR = 100.0;
+
+// SHADOW_CASCADE_COUNT in CascadedShadows.h
+const uint SHADOW_CASCADE_COUNT = 3u;
+
+// Set 0 is the bindless table when that is enabled
+#define LIGHT_SET 1
+
+// Writers define it empty before including this
+#ifndef CLUSTER_ACCESS
+#define CLUSTER_ACCESS readonly
+#endif
+
+const vec3 AMBIENT = vec3(0.1);
+
+struct PointLight
+{
+	vec4 positionRadius;
+	vec4 color;
+};
+
+// LightBufferObject in VulkanMain.h, lights are in view space. The shadow
+// matrices take view space to a cascade's texture coordinates and depth.
+layout(std430, set = LIGHT_SET, binding = 3) readonly buffer LightBuffer
+{
+	mat4 inverseProjection;
+	mat4 shadowMatrices[SHADOW_CASCADE_COUNT];
+	vec4 sunDirection;
+	vec4 sunColor;
+	vec2 viewportSize;
+	uint lightCount;
+	PointLight lights[];
+} lightBuffer;
+
+// Light indexes of cluster i start at i * MAX_LIGHTS_PER_CLUSTER
+layout(std430, set = LIGHT_SET, binding = 4) CLUSTER_ACCESS buffer ClusterBuffer
+{
+	uint lightCounts[CLUSTER_COUNT];
+	uint lightIndexes[CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER];
+} clusters;
+
+float getSliceDepth(uint slice)
+{
+	return CLUSTER_NEAR * pow(CLUSTER_FAR / CLUSTER_NEAR, float(slice) / float(CLUSTER_Z));
+}
+
+uint getClusterIndex(uvec3 cluster)
+{
+	return (cluster.z * CLUSTER_Y + cluster.y) * CLUSTER_X + cluster.x;
+}
+
+// viewDepth is positive, the camera looks down -z
+uint getClusterIndex(vec2 fragCoord, float viewDepth)
+{
+	uvec2 tile = uvec2(fragCoord / lightBuffer.viewportSize * vec2(CLUSTER_X, CLUSTER_Y));
+
+	// Inverse of getSliceDepth()
+	float slice = log(max(viewDepth, CLUSTER_NEAR) / CLUSTER_NEAR) * float(CLUSTER_Z) / log(CLUSTER_FAR / CLUSTER_NEAR);
+
+	return getClusterIndex(min(uvec3(tile, uint(slice)), uvec3(CLUSTER_X, CLUSTER_Y, CLUSTER_Z) - 1u));
+}
+
+// Diffuse light at a view space position, only from the lights of its cluster
+vec3 getClusteredLighting(vec2 fragCoord, vec3 position, vec3 normal)
+{
+	uint cluster = getClusterIndex(fragCoord, -position.z);
+	uint firstIndex = cluster * MAX_LIGHTS_PER_CLUSTER;
+	uint lightCount = clusters.lightCounts[cluster];
+
+	vec3 lighting = AMBIENT;
+	for (uint i = 0u; i < lightCount; ++i)
+	{
+		PointLight light = lightBuffer.lights[clusters.lightIndexes[firstIndex + i]];
+
+		vec3 toLight = light.positionRadius.xyz - position;
+		float lightDistance = length(toLight);
+		float attenuation = clamp(1.0 - lightDistance / light.positionRadius.w, 0.0, 1.0);
+
+		lighting += light.color.rgb * max(dot(normal, toLight / max(lightDistance, 1e-4)), 0.0) * attenuation * attenuation;
+	}
+
+	return lighting;
+}
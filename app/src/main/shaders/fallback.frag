@@ -0,0 +1,23 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Drawn with while triangle.frag is still compiling: unlit, no lights or shadow
+// maps, so it compiles quickly and needs nothing but the object data of set 0
+
+// FALLBACK_IS_TARGET_SRGB in VulkanMain.cpp. The vertex colors are sRGB values,
+// sRGB targets get them decoded here to encode them again.
+layout(constant_id = 0) const bool IS_TARGET_SRGB = false;
+
+layout(location = 0) in vec3 fragmentColor;
+
+layout(location = 0) out vec4 outColor;
+
+vec3 srgbToLinear(vec3 color)
+{
+	return mix(color / 12.92, pow((color + 0.055) / 1.055, vec3(2.4)), greaterThan(color, vec3(0.04045)));
+}
+
+void main()
+{
+	outColor = vec4(IS_TARGET_SRGB ? srgbToLinear(fragmentColor) : fragmentColor, 1.0);
+}
@@ -0,0 +1,26 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// First subpass of the deferred path, lighting.frag reads the outputs back as
+// input attachments
+
+layout(location = 0) in vec3 fragmentColor;
+layout(location = 1) in vec3 viewPosition;
+
+// sRGB color, alpha marks the pixels something was drawn to
+layout(location = 0) out vec4 outAlbedo;
+// View space, mapped to [0, 1]
+layout(location = 1) out vec4 outNormal;
+
+void main()
+{
+	// No vertex normals, the geometry is flat. Always facing the camera.
+	vec3 normal = normalize(cross(dFdx(viewPosition), dFdy(viewPosition)));
+	if (dot(normal, viewPosition) > 0.0)
+	{
+		normal = -normal;
+	}
+
+	outAlbedo = vec4(fragmentColor, 1.0);
+	outNormal = vec4(normal * 0.5 + 0.5, 0.0);
+}
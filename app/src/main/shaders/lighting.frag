@@ -0,0 +1,47 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// LIGHTING_IS_TARGET_SRGB in VulkanMain.cpp. Lighting is done in linear space,
+// other targets get the result encoded here.
+layout(constant_id = 0) const bool IS_TARGET_SRGB = false;
+
+#include "clusters.glsl"
+#include "shadows.glsl"
+
+// Written by gbuffer.frag in the previous subpass, read at the same pixel
+layout(input_attachment_index = 0, set = LIGHT_SET, binding = 0) uniform subpassInput gbufferAlbedo;
+layout(input_attachment_index = 1, set = LIGHT_SET, binding = 1) uniform subpassInput gbufferNormal;
+layout(input_attachment_index = 2, set = LIGHT_SET, binding = 2) uniform subpassInput gbufferDepth;
+
+layout(location = 0) out vec4 outColor;
+
+vec3 srgbToLinear(vec3 color)
+{
+	return mix(color / 12.92, pow((color + 0.055) / 1.055, vec3(2.4)), greaterThan(color, vec3(0.04045)));
+}
+
+vec3 linearToSrgb(vec3 color)
+{
+	return mix(color * 12.92, 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055, greaterThan(color, vec3(0.0031308)));
+}
+
+void main()
+{
+	vec4 albedo = subpassLoad(gbufferAlbedo);
+	if (albedo.a == 0.0)
+	{
+		outColor = vec4(0.0, 0.0, 0.0, 1.0);
+		return;
+	}
+
+	vec3 normal = normalize(subpassLoad(gbufferNormal).xyz * 2.0 - 1.0);
+
+	vec2 ndc = gl_FragCoord.xy / lightBuffer.viewportSize * 2.0 - 1.0;
+	vec4 position = lightBuffer.inverseProjection * vec4(ndc, subpassLoad(gbufferDepth).r, 1.0);
+	position.xyz /= position.w;
+
+	vec3 lighting = getClusteredLighting(gl_FragCoord.xy, position.xyz, normal) + getSunLighting(position.xyz, normal);
+
+	vec3 color = srgbToLinear(albedo.rgb) * lighting;
+	outColor = vec4(IS_TARGET_SRGB ? color : linearToSrgb(color), 1.0);
+}
@@ -0,0 +1,8 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Nothing to write, the shadow passes have only a depth attachment
+
+void main()
+{
+}
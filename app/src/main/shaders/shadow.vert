@@ -0,0 +1,17 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Depth only, from the sun
+
+layout(push_constant) uniform PushConstants
+{
+	mat4 modelViewProjection;
+} pushConstants;
+
+// Vertex in VulkanMain.h, the color is not read
+layout(location = 0) in vec3 vInPosition;
+
+void main()
+{
+	gl_Position = pushConstants.modelViewProjection * vec4(vInPosition, 1.0);
+}
@@ -0,0 +1,49 @@
+// Sun light with cascaded shadow maps, rendered by shadow.vert and kept by
+// CascadedShadows. Included after clusters.glsl.
+
+// Depth compared against the map, with linear filtering a 2x2 PCF
+layout(set = LIGHT_SET, binding = 5) uniform sampler2DShadow shadowMaps[SHADOW_CASCADE_COUNT];
+
+bool isInCascade(vec3 shadowCoord)
+{
+	return all(greaterThan(shadowCoord, vec3(0.0))) && all(lessThan(shadowCoord, vec3(1.0)));
+}
+
+// The first cascade holding the position decides, beyond the last one nothing is shadowed.
+// Indexes are constant, dynamically indexed sampler arrays are an optional feature.
+float getSunVisibility(vec3 position)
+{
+	vec4 viewPosition = vec4(position, 1.0);
+
+	vec3 shadowCoord = (lightBuffer.shadowMatrices[0] * viewPosition).xyz;
+	if (isInCascade(shadowCoord))
+	{
+		return texture(shadowMaps[0], shadowCoord);
+	}
+
+	shadowCoord = (lightBuffer.shadowMatrices[1] * viewPosition).xyz;
+	if (isInCascade(shadowCoord))
+	{
+		return texture(shadowMaps[1], shadowCoord);
+	}
+
+	shadowCoord = (lightBuffer.shadowMatrices[2] * viewPosition).xyz;
+	if (isInCascade(shadowCoord))
+	{
+		return texture(shadowMaps[2], shadowCoord);
+	}
+
+	return 1.0;
+}
+
+// Diffuse sun light at a view space position
+vec3 getSunLighting(vec3 position, vec3 normal)
+{
+	float diffuse = max(dot(normal, lightBuffer.sunDirection.xyz), 0.0);
+	if (diffuse == 0.0)
+	{
+		return vec3(0.0);
+	}
+
+	return lightBuffer.sunColor.rgb * diffuse * getSunVisibility(position);
+}
@@ -0,0 +1,37 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// TRIANGLE_IS_TARGET_SRGB in VulkanMain.cpp. The vertex colors are sRGB values,
+// lighting is done in linear space and other targets get the result encoded here.
+layout(constant_id = 0) const bool IS_TARGET_SRGB = false;
+
+#include "clusters.glsl"
+#include "shadows.glsl"
+
+layout(location = 0) in vec3 fragmentColor;
+layout(location = 1) in vec3 viewPosition;
+
+layout(location = 0) out vec4 outColor;
+
+vec3 srgbToLinear(vec3 color)
+{
+	return mix(color / 12.92, pow((color + 0.055) / 1.055, vec3(2.4)), greaterThan(color, vec3(0.04045)));
+}
+
+vec3 linearToSrgb(vec3 color)
+{
+	return mix(color * 12.92, 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055, greaterThan(color, vec3(0.0031308)));
+}
+
+void main()
+{
+	// No vertex normals, the geometry is flat. Always facing the camera.
+	vec3 normal = normalize(cross(dFdx(viewPosition), dFdy(viewPosition)));
+	if (dot(normal, viewPosition) > 0.0)
+	{
+		normal = -normal;
+	}
+
+	vec3 color = srgbToLinear(fragmentColor) * (getClusteredLighting(gl_FragCoord.xy, viewPosition, normal) + getSunLighting(viewPosition, normal));
+	outColor = vec4(IS_TARGET_SRGB ? color : linearToSrgb(color), 1.0);
+}
@@ -0,0 +1,27 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// UniformBufferObject in VulkanMain.h
+layout(binding = 0) uniform UniformBufferObject
+{
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+} ubo;
+
+// Vertex in VulkanMain.h
+layout(location = 0) in vec3 vInPosition;
+layout(location = 1) in vec3 vInColor;
+
+layout(location = 0) out vec3 fragmentColor;
+// Lit in view space, the fragment shaders derive the normal from it
+layout(location = 1) out vec3 viewPosition;
+
+void main()
+{
+	vec4 position = ubo.view * ubo.model * vec4(vInPosition, 1.0);
+
+	gl_Position = ubo.projection * position;
+	fragmentColor = vInColor;
+	viewPosition = position.xyz;
+}
@@ -0,0 +1,41 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Same interface as triangle.vert, object data comes from the bindless table
+
+struct ObjectData
+{
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+};
+
+// BindlessTable::BUFFER_BINDING, every storage buffer of the renderer
+layout(std430, set = 0, binding = 0) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+} buffers[];
+
+// DrawConstants in VulkanMain.cpp
+layout(push_constant) uniform DrawConstants
+{
+	uint bufferIndex;
+	uint objectIndex;
+} draw;
+
+layout(location = 0) in vec3 vInPosition;
+layout(location = 1) in vec3 vInColor;
+
+layout(location = 0) out vec3 fragmentColor;
+layout(location = 1) out vec3 viewPosition;
+
+void main()
+{
+	// Push constants are dynamically uniform, no nonuniformEXT needed
+	ObjectData object = buffers[draw.bufferIndex].objects[draw.objectIndex];
+	vec4 position = object.view * object.model * vec4(vInPosition, 1.0);
+
+	gl_Position = object.projection * position;
+	fragmentColor = vInColor;
+	viewPosition = position.xyz;
+}
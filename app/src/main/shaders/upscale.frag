@@ -0,0 +1,32 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// UPSCALE_IS_TARGET_SRGB in VulkanMain.cpp. The scene is stored as sRGB and
+// filtered in linear space, other targets get the result encoded here.
+layout(constant_id = 0) const bool IS_TARGET_SRGB = false;
+
+// Set 0 is the bindless table when that is enabled
+layout(set = 1, binding = 0) uniform sampler2D sceneColor;
+
+// UpscaleConstants in VulkanMain.cpp. The scene only covers the top left of
+// its image, the coordinates stay half a texel inside that part.
+layout(push_constant) uniform PushConstants
+{
+	vec2 uvPerPixel;
+	vec2 maxUv;
+} pushConstants;
+
+layout(location = 0) out vec4 outColor;
+
+vec3 linearToSrgb(vec3 color)
+{
+	return mix(color * 12.92, 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055, greaterThan(color, vec3(0.0031308)));
+}
+
+void main()
+{
+	vec2 uv = min(gl_FragCoord.xy * pushConstants.uvPerPixel, pushConstants.maxUv);
+	vec3 color = texture(sceneColor, uv).rgb;
+
+	outColor = vec4(IS_TARGET_SRGB ? color : linearToSrgb(color), 1.0);
+}
@@ -0,0 +1,336 @@
+#include "jobs/JobSystem.h"
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+/*
+ * Meant to run under ThreadSanitizer: the jobs write plain memory that is read
+ * after a counter or a dependency is done, any missing ordering is a report.
+ */
+
+static std::atomic<uint32_t> g_nFailures(0);
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			g_nFailures.fetch_add(1); \
+		} \
+	} while (false)
+
+const uint32_t N_WORKERS = 4;
+
+struct ChainData
+{
+	std::vector<uint32_t> first;
+	std::vector<uint32_t> second;
+	std::vector<uint32_t> third;
+};
+
+static void writeFirst(const Job& job)
+{
+	ChainData* pData = static_cast<ChainData*>(job.pData);
+	for (uint32_t i = job.begin; i < job.end; ++i)
+	{
+		pData->first[i] = i + 1;
+	}
+}
+
+static void writeSecond(const Job& job)
+{
+	// Every first job is done once a second one starts
+	ChainData* pData = static_cast<ChainData*>(job.pData);
+	for (uint32_t i = job.begin; i < job.end; ++i)
+	{
+		uint32_t mirrored = (uint32_t) pData->first.size() - 1 - i;
+		pData->second[i] = pData->first[mirrored] * 2;
+	}
+}
+
+static void writeThird(const Job& job)
+{
+	ChainData* pData = static_cast<ChainData*>(job.pData);
+	for (uint32_t i = job.begin; i < job.end; ++i)
+	{
+		uint32_t mirrored = (uint32_t) pData->second.size() - 1 - i;
+		pData->third[i] = pData->second[mirrored] + 1;
+	}
+}
+
+// Three groups, each one started by the previous counter
+static void runChain(JobSystem& jobSystem, uint32_t count, uint32_t batchSize)
+{
+	ChainData data;
+	data.first.resize(count);
+	data.second.resize(count);
+	data.third.resize(count);
+
+	JobCounter firstCounter;
+	JobCounter secondCounter;
+	JobCounter thirdCounter;
+
+	// Most of the later jobs are still waiting on a counter when submitted
+	for (uint32_t begin = 0; begin < count; begin += batchSize)
+	{
+		jobSystem.run(&writeFirst, &data, begin, std::min(count, begin + batchSize), &firstCounter);
+	}
+	for (uint32_t begin = 0; begin < count; begin += batchSize)
+	{
+		jobSystem.run(&writeSecond, &data, begin, std::min(count, begin + batchSize), &secondCounter, &firstCounter);
+	}
+	for (uint32_t begin = 0; begin < count; begin += batchSize)
+	{
+		jobSystem.run(&writeThird, &data, begin, std::min(count, begin + batchSize), &thirdCounter, &secondCounter);
+	}
+
+	jobSystem.wait(thirdCounter);
+	CHECK(firstCounter.isDone());
+	CHECK(secondCounter.isDone());
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		CHECK(data.third[i] == (i + 1) * 2 + 1);
+	}
+
+	// Every counter has to be waited on before it goes away
+	jobSystem.wait(secondCounter);
+	jobSystem.wait(firstCounter);
+}
+
+static void testDependencies(JobSystem& jobSystem)
+{
+	for (uint32_t iteration = 0; iteration < 200; ++iteration)
+	{
+		runChain(jobSystem, 512, 1 + iteration % 32);
+	}
+}
+
+static void testNestedParallelFor(JobSystem& jobSystem)
+{
+	const uint32_t N_OUTER = 64;
+	const uint32_t N_INNER = 256;
+
+	for (uint32_t iteration = 0; iteration < 20; ++iteration)
+	{
+		std::vector<uint32_t> values(N_OUTER * N_INNER, 0);
+		std::vector<uint32_t> sums(N_OUTER, 0);
+
+		jobSystem.parallelFor(N_OUTER, 4, [&](uint32_t outerBegin, uint32_t outerEnd)
+		{
+			for (uint32_t outer = outerBegin; outer < outerEnd; ++outer)
+			{
+				uint32_t* pRow = &values[outer * N_INNER];
+				jobSystem.parallelFor(N_INNER, 16, [&](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t inner = begin; inner < end; ++inner)
+					{
+						pRow[inner] = outer + inner;
+					}
+				});
+
+				// The inner writes are visible once parallelFor returned
+				uint32_t sum = 0;
+				for (uint32_t inner = 0; inner < N_INNER; ++inner)
+				{
+					sum += pRow[inner];
+				}
+				sums[outer] = sum;
+			}
+		});
+
+		for (uint32_t outer = 0; outer < N_OUTER; ++outer)
+		{
+			CHECK(sums[outer] == outer * N_INNER + N_INNER * (N_INNER - 1) / 2);
+		}
+	}
+}
+
+static void testSubmitters(JobSystem& jobSystem)
+{
+	// Threads outside the system, like android_main and the render thread
+	const uint32_t N_SUBMITTERS = 4;
+
+	std::vector<std::thread> submitters;
+	for (uint32_t submitter = 0; submitter < N_SUBMITTERS; ++submitter)
+	{
+		submitters.emplace_back([&jobSystem, submitter]()
+		{
+			for (uint32_t iteration = 0; iteration < 100; ++iteration)
+			{
+				std::vector<uint32_t> values(256, 0);
+				jobSystem.parallelFor((uint32_t) values.size(), 8, [&](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t i = begin; i < end; ++i)
+					{
+						values[i] = i * submitter;
+					}
+				});
+
+				for (uint32_t i = 0; i < values.size(); ++i)
+				{
+					CHECK(values[i] == i * submitter);
+				}
+
+				runChain(jobSystem, 128, 8);
+			}
+		});
+	}
+
+	for (std::thread& submitter : submitters)
+	{
+		submitter.join();
+	}
+}
+
+struct OverflowData
+{
+	JobSystem* pJobSystem;
+	uint32_t count;
+	std::vector<uint32_t> values;
+	std::atomic<uint32_t> nRuns;
+};
+
+static void writeOverflowValue(const Job& job)
+{
+	OverflowData* pData = static_cast<OverflowData*>(job.pData);
+
+	// Slow enough for the deque to fill up faster than thieves empty it
+	uint32_t value = job.begin;
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		value = value * 1664525 + 1013904223;
+	}
+
+	pData->values[job.begin] = value;
+	pData->nRuns.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void spawnOverflowJobs(const Job& job)
+{
+	// On a worker, every job goes to its own deque until it is full
+	OverflowData* pData = static_cast<OverflowData*>(job.pData);
+
+	JobCounter counter;
+	for (uint32_t i = 0; i < pData->count; ++i)
+	{
+		pData->pJobSystem->run(&writeOverflowValue, pData, i, i + 1, &counter);
+	}
+	pData->pJobSystem->wait(counter);
+}
+
+static void testDequeOverflow(JobSystem& jobSystem)
+{
+	for (uint32_t iteration = 0; iteration < 10; ++iteration)
+	{
+		// More than a deque holds, fewer than the job ring
+		OverflowData data;
+		data.pJobSystem = &jobSystem;
+		data.count = 3000;
+		data.values.resize(data.count, 0);
+		data.nRuns.store(0);
+
+		// Background jobs only run on workers, that makes sure the spawner is one
+		JobCounter counter;
+		jobSystem.runBackground(&spawnOverflowJobs, &data, &counter);
+		jobSystem.wait(counter);
+
+		CHECK(data.nRuns.load() == data.count);
+		for (uint32_t i = 0; i < data.count; ++i)
+		{
+			uint32_t value = i;
+			for (uint32_t j = 0; j < 256; ++j)
+			{
+				value = value * 1664525 + 1013904223;
+			}
+			CHECK(data.values[i] == value);
+		}
+	}
+}
+
+struct BackgroundData
+{
+	std::thread::id threadId;
+	std::atomic<bool> isReleased;
+};
+
+static void blockUntilReleased(const Job& job)
+{
+	BackgroundData* pData = static_cast<BackgroundData*>(job.pData);
+	pData->threadId = std::this_thread::get_id();
+	while (!pData->isReleased.load())
+	{
+		std::this_thread::yield();
+	}
+}
+
+static void testBackgroundJobs(JobSystem& jobSystem)
+{
+	// One fewer than the workers, a short job always finds a free one
+	std::vector<BackgroundData> data(N_WORKERS - 1);
+	JobCounter backgroundCounter;
+	for (BackgroundData& backgroundData : data)
+	{
+		backgroundData.isReleased.store(false);
+		jobSystem.runBackground(&blockUntilReleased, &backgroundData, &backgroundCounter);
+	}
+
+	// Would never return if the waiting thread picked up a blocking job
+	for (uint32_t iteration = 0; iteration < 50; ++iteration)
+	{
+		std::vector<uint32_t> values(1024, 0);
+		jobSystem.parallelFor((uint32_t) values.size(), 16, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				values[i] = i;
+			}
+		});
+
+		for (uint32_t i = 0; i < values.size(); ++i)
+		{
+			CHECK(values[i] == i);
+		}
+	}
+
+	for (BackgroundData& backgroundData : data)
+	{
+		backgroundData.isReleased.store(true);
+	}
+	jobSystem.wait(backgroundCounter);
+
+	for (BackgroundData& backgroundData : data)
+	{
+		CHECK(backgroundData.threadId != std::this_thread::get_id());
+	}
+}
+
+int main()
+{
+	JobSystemSettings settings;
+	settings.nWorkers = N_WORKERS;
+
+	JobSystem jobSystem;
+	jobSystem.start(settings);
+
+	testDependencies(jobSystem);
+	testNestedParallelFor(jobSystem);
+	testSubmitters(jobSystem);
+	testDequeOverflow(jobSystem);
+	testBackgroundJobs(jobSystem);
+
+	jobSystem.stop();
+
+	uint32_t nFailures = g_nFailures.load();
+	if (nFailures != 0)
+	{
+		fprintf(stderr, "%u checks failed\n", nFailures);
+		return 1;
+	}
+
+	printf("JobSystem stress test passed\n");
+	return 0;
+}